@@ -0,0 +1 @@
+include(ext/googlebenchmark.cmake)
@@ -0,0 +1,417 @@
+#include <benchmark/benchmark.h>
+#include <laplacian-pyramid/cpu_level.hpp>
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <laplacian-pyramid/pyramid_service.hpp>
+#include <laplacian-pyramid/thread_pool.hpp>
+#include "expand_engine.hpp"
+#include "fixed_expand_engine.hpp"
+#include "fixed_reduce_engine.hpp"
+#include "pyramid_geometry.hpp"
+#include "pyramid_types.hpp"
+#include "reduce_cascade.hpp"
+#include "reduce_engine.hpp"
+#include "stage_timer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * Every benchmark gets the arguments {side, levels, channels, depth, threads}. The image is a square of the side
+ * with the channels and the depth, filled with noise. One thread runs without executor. REDUCE and EXPAND are
+ * measured for the step between level 0 and level 1 of the given side.
+ * The gaussians benchmarks reduce a CV_32F image to all levels, once level by level and once cascaded in tiles, see
+ * #laplacian::ReduceCascade. Run them under a tool reading the hardware counters, like "perf stat -e LLC-load-misses",
+ * to compare the memory traffic of both.
+ * The CPU level benchmarks run REDUCE and EXPAND with the kernels of every #laplacian::CpuLevel, which is the sixth
+ * argument. Levels the CPU does not support are skipped.
+ * The pipeline benchmark streams frames through a #laplacian::PyramidService with the threads as workers, every frame
+ * encoded and then decoded, and reports the frames per second and the percentiles of the latency of a frame.
+ *
+ * Run with --benchmark_out=<file> --benchmark_out_format=json for machine readable results.
+ */
+namespace laplacian::benchmark {
+
+    const int SIDES[] = {256, 512, 1024, 2048, 4096, 8192};
+    const int CHANNELS[] = {1, 3};
+    const int DEPTHS[] = {CV_32F, CV_8U};
+    const int DEFAULT_LEVELS = 5;
+    // The geometry of a single REDUCE or EXPAND step, which holds level 0 and level 1.
+    const uint8_t STEP_COMPRESSIONS = 2;
+    const int SWEEP_SIDE = 2048;
+    const int SWEEP_LEVELS[] = {2, 4, 6, 8};
+    const int MIN_ROWS_PER_BAND = 16;
+    const int PIPELINE_SIDES[] = {512, 2048};
+    const int GAUSSIANS_SIDES[] = {2048, 4096, 6144};
+    const int FRAMES_IN_FLIGHT_PER_WORKER = 2;
+    const int CPU_LEVEL_SIDE = 2048;
+    const CpuLevel CPU_LEVELS[] = {CpuLevel::SCALAR, CpuLevel::BASELINE, CpuLevel::SSE4, CpuLevel::AVX2,
+                                   CpuLevel::AVX512};
+
+    struct Arguments {
+        int side;
+        uint8_t levels;
+        int type;
+        std::shared_ptr<Executor> executor;
+
+        explicit Arguments(const ::benchmark::State& state);
+    };
+
+    cv::Mat noise(cv::Size size, int type);
+    cv::Mat kernel();
+    void forEachRowBand(const std::shared_ptr<Executor>& executor, int rows, const std::function<void(int, int)>& body);
+    void reportThroughput(::benchmark::State& state, const cv::Mat& image);
+    void sweep(::benchmark::internal::Benchmark* benchmark);
+    void pipelineSweep(::benchmark::internal::Benchmark* benchmark);
+    void gaussiansSweep(::benchmark::internal::Benchmark* benchmark);
+    void cpuLevelSweep(::benchmark::internal::Benchmark* benchmark);
+    void atCpuLevel(::benchmark::State& state, void (*body)(::benchmark::State&));
+    std::vector<cv::Mat> gaussians(const Arguments& arguments);
+    void reportLatency(::benchmark::State& state, std::vector<double>& latencies);
+}
+
+static void encode(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    const cv::Mat image = laplacian::benchmark::noise({arguments.side, arguments.side}, arguments.type);
+
+    for (auto _ : state) {
+        laplacian::LaplacianPyramid pyramid{image, arguments.levels, 0.0f, arguments.executor};
+        ::benchmark::DoNotOptimize(pyramid);
+    }
+    laplacian::benchmark::reportThroughput(state, image);
+}
+
+static void decode(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    const cv::Mat image = laplacian::benchmark::noise({arguments.side, arguments.side}, arguments.type);
+    const laplacian::LaplacianPyramid pyramid{image, arguments.levels, 0.0f, arguments.executor};
+
+    for (auto _ : state) {
+        cv::Mat decoded = pyramid.decode();
+        ::benchmark::DoNotOptimize(decoded.data);
+    }
+    laplacian::benchmark::reportThroughput(state, image);
+}
+
+static void reduce(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    const laplacian::PyramidGeometry geometry{{arguments.side, arguments.side},
+                                              laplacian::benchmark::STEP_COMPRESSIONS};
+    const cv::Mat image = laplacian::benchmark::noise(geometry.scaledSize(), arguments.type);
+    const cv::Mat kernel = laplacian::benchmark::kernel();
+    cv::Mat reduced(geometry.levelSize(1), laplacian::types::planeType(image.type()));
+
+    const laplacian::ReduceEngine engine{kernel};
+    const laplacian::FixedPointReduceEngine fixedPointEngine{kernel};
+    const bool fixedPoint = laplacian::types::isFixedPoint(image.type());
+
+    for (auto _ : state) {
+        laplacian::benchmark::forEachRowBand(arguments.executor, reduced.rows, [&](int begin, int end) {
+            if (fixedPoint) {
+                fixedPointEngine.apply(image, reduced, begin, end);
+            } else {
+                engine.apply(image, reduced, begin, end);
+            }
+        });
+        ::benchmark::DoNotOptimize(reduced.data);
+    }
+    laplacian::benchmark::reportThroughput(state, image);
+}
+
+static void expand(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    const laplacian::PyramidGeometry geometry{{arguments.side, arguments.side},
+                                              laplacian::benchmark::STEP_COMPRESSIONS};
+    const cv::Mat image = laplacian::benchmark::noise(geometry.scaledSize(), arguments.type);
+    const cv::Mat kernel = laplacian::benchmark::kernel();
+
+    // Expands a reduced plane back to the size of the image, the way the decoding does.
+    const int planeType = laplacian::types::planeType(arguments.type);
+    const cv::Mat source = laplacian::benchmark::noise(geometry.levelSize(1), planeType);
+    cv::Mat expanded(image.size(), planeType);
+
+    const laplacian::ExpandEngine engine{kernel};
+    const laplacian::FixedPointExpandEngine fixedPointEngine{kernel};
+    const bool fixedPoint = laplacian::types::isFixedPoint(image.type());
+
+    for (auto _ : state) {
+        laplacian::benchmark::forEachRowBand(arguments.executor, expanded.rows, [&](int begin, int end) {
+            if (fixedPoint) {
+                fixedPointEngine.apply(source, expanded, begin, end);
+            } else {
+                engine.apply(source, expanded, begin, end);
+            }
+        });
+        ::benchmark::DoNotOptimize(expanded.data);
+    }
+    laplacian::benchmark::reportThroughput(state, image);
+}
+
+static void reduceAtCpuLevel(::benchmark::State& state) {
+    laplacian::benchmark::atCpuLevel(state, reduce);
+}
+
+static void expandAtCpuLevel(::benchmark::State& state) {
+    laplacian::benchmark::atCpuLevel(state, expand);
+}
+
+static void gaussiansLevelByLevel(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    std::vector<cv::Mat> gaussians = laplacian::benchmark::gaussians(arguments);
+    const laplacian::ReduceEngine engine{laplacian::benchmark::kernel()};
+
+    for (auto _ : state) {
+        for (size_t level = 1; level < gaussians.size(); level++) {
+            engine.apply(gaussians.at(level - 1), gaussians.at(level), 0, gaussians.at(level).rows);
+        }
+        ::benchmark::DoNotOptimize(gaussians.back().data);
+    }
+    laplacian::benchmark::reportThroughput(state, gaussians.front());
+}
+
+static void gaussiansCascaded(::benchmark::State& state) {
+
+    const laplacian::benchmark::Arguments arguments{state};
+    std::vector<cv::Mat> gaussians = laplacian::benchmark::gaussians(arguments);
+    const laplacian::ReduceCascade cascade{laplacian::benchmark::kernel()};
+    std::vector<laplacian::StageTimer> timers(gaussians.size() - 1,
+                                              laplacian::StageTimer{nullptr, laplacian::Stage::REDUCE, 0});
+
+    for (auto _ : state) {
+        cascade.apply(gaussians, timers);
+        ::benchmark::DoNotOptimize(gaussians.back().data);
+    }
+    laplacian::benchmark::reportThroughput(state, gaussians.front());
+}
+
+static void pipeline(::benchmark::State& state) {
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        Clock::time_point submitted;
+        std::future<laplacian::LaplacianPyramid> encoded;
+        std::future<cv::Mat> decoded;
+    };
+
+    const laplacian::benchmark::Arguments arguments{state};
+    const cv::Mat image = laplacian::benchmark::noise({arguments.side, arguments.side}, arguments.type);
+    const int workers = static_cast<int>(state.range(4));
+    const size_t inFlight = static_cast<size_t>(workers * laplacian::benchmark::FRAMES_IN_FLIGHT_PER_WORKER);
+
+    laplacian::PyramidService service{workers};
+    std::deque<Frame> frames;
+    std::vector<double> latencies;
+
+    // Finishes the oldest frame, submitting its decoding if the encoding was not handed on yet.
+    const auto finish = [&]() {
+
+        Frame& frame = frames.front();
+        if (!frame.decoded.valid()) {
+            frame.decoded = service.submitDecode(frame.encoded.get());
+        }
+        cv::Mat decoded = frame.decoded.get();
+        ::benchmark::DoNotOptimize(decoded.data);
+        latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frame.submitted).count());
+        frames.pop_front();
+    };
+
+    for (auto _ : state) {
+
+        frames.push_back({Clock::now(), service.submitEncode(image, arguments.levels), {}});
+
+        // Encoded frames are handed on to the decoding as soon as they are ready, so the stages overlap.
+        for (Frame& frame : frames) {
+            if (!frame.decoded.valid() &&
+                frame.encoded.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                frame.decoded = service.submitDecode(frame.encoded.get());
+            }
+        }
+
+        while (frames.size() > inFlight) {
+            finish();
+        }
+    }
+
+    while (!frames.empty()) {
+        finish();
+    }
+
+    state.counters["frames/s"] = ::benchmark::Counter(1.0, ::benchmark::Counter::kIsIterationInvariantRate);
+    laplacian::benchmark::reportLatency(state, latencies);
+    laplacian::benchmark::reportThroughput(state, image);
+}
+
+BENCHMARK(encode)->Apply(laplacian::benchmark::sweep);
+BENCHMARK(decode)->Apply(laplacian::benchmark::sweep);
+BENCHMARK(reduce)->Apply(laplacian::benchmark::sweep);
+BENCHMARK(expand)->Apply(laplacian::benchmark::sweep);
+BENCHMARK(reduceAtCpuLevel)->Apply(laplacian::benchmark::cpuLevelSweep);
+BENCHMARK(expandAtCpuLevel)->Apply(laplacian::benchmark::cpuLevelSweep);
+BENCHMARK(gaussiansLevelByLevel)->Apply(laplacian::benchmark::gaussiansSweep);
+BENCHMARK(gaussiansCascaded)->Apply(laplacian::benchmark::gaussiansSweep);
+BENCHMARK(pipeline)->Apply(laplacian::benchmark::pipelineSweep);
+
+BENCHMARK_MAIN();
+
+laplacian::benchmark::Arguments::Arguments(const ::benchmark::State& state) :
+        side(static_cast<int>(state.range(0))),
+        levels(static_cast<uint8_t>(state.range(1))),
+        type(CV_MAKETYPE(static_cast<int>(state.range(3)), static_cast<int>(state.range(2)))),
+        executor(state.range(4) > 1 ? std::make_shared<ThreadPool>(static_cast<int>(state.range(4))) : nullptr) {
+}
+
+cv::Mat laplacian::benchmark::noise(cv::Size size, int type) {
+
+    cv::Mat image(size, type);
+    cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+    return image;
+}
+
+cv::Mat laplacian::benchmark::kernel() {
+
+    const float zeroAndFour = 0.25f - DEFAULT_A / 2.0f;
+    return (cv::Mat_<float>(5, 1) << zeroAndFour, 0.25f, DEFAULT_A, 0.25f, zeroAndFour);
+}
+
+void laplacian::benchmark::forEachRowBand(const std::shared_ptr<Executor>& executor,
+                                          int rows,
+                                          const std::function<void(int, int)>& body) {
+
+    const int bands = executor ? std::min(executor->concurrency(), rows / MIN_ROWS_PER_BAND) : 1;
+
+    if (bands <= 1) {
+        body(0, rows);
+        return;
+    }
+
+    executor->parallelFor(bands, [rows, bands, &body](int band) {
+        body(rows * band / bands, rows * (band + 1) / bands);
+    });
+}
+
+void laplacian::benchmark::reportThroughput(::benchmark::State& state, const cv::Mat& image) {
+
+    state.counters["MPix/s"] = ::benchmark::Counter(static_cast<double>(image.total()) * 1e-6,
+                                                    ::benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void laplacian::benchmark::sweep(::benchmark::internal::Benchmark* benchmark) {
+
+    benchmark->ArgNames({"side", "levels", "channels", "depth", "threads"})
+             ->Unit(::benchmark::kMillisecond)
+             ->UseRealTime();
+
+    std::vector<int> threads = {1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    for (const int side : SIDES) {
+        for (const int channels : CHANNELS) {
+            for (const int depth : DEPTHS) {
+                for (const int count : threads) {
+                    benchmark->Args({side, DEFAULT_LEVELS, channels, depth, count});
+                }
+            }
+        }
+    }
+
+    for (const int levels : SWEEP_LEVELS) {
+        if (levels != DEFAULT_LEVELS) {
+            benchmark->Args({SWEEP_SIDE, levels, 1, CV_32F, 1});
+        }
+    }
+}
+
+void laplacian::benchmark::pipelineSweep(::benchmark::internal::Benchmark* benchmark) {
+
+    benchmark->ArgNames({"side", "levels", "channels", "depth", "threads"})
+             ->Unit(::benchmark::kMillisecond)
+             ->UseRealTime();
+
+    std::vector<int> threads = {1, static_cast<int>(std::max(1u, std::thread::hardware_concurrency()))};
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+
+    for (const int side : PIPELINE_SIDES) {
+        for (const int count : threads) {
+            benchmark->Args({side, DEFAULT_LEVELS, 3, CV_8U, count});
+        }
+    }
+}
+
+void laplacian::benchmark::gaussiansSweep(::benchmark::internal::Benchmark* benchmark) {
+
+    benchmark->ArgNames({"side", "levels", "channels", "depth", "threads"})
+             ->Unit(::benchmark::kMillisecond)
+             ->UseRealTime();
+
+    for (const int side : GAUSSIANS_SIDES) {
+        for (const int channels : CHANNELS) {
+            benchmark->Args({side, DEFAULT_LEVELS, channels, CV_32F, 1});
+        }
+    }
+}
+
+void laplacian::benchmark::cpuLevelSweep(::benchmark::internal::Benchmark* benchmark) {
+
+    benchmark->ArgNames({"side", "levels", "channels", "depth", "threads", "cpu"})
+             ->Unit(::benchmark::kMillisecond)
+             ->UseRealTime();
+
+    for (const int channels : CHANNELS) {
+        for (const CpuLevel level : CPU_LEVELS) {
+            benchmark->Args({CPU_LEVEL_SIDE, DEFAULT_LEVELS, channels, CV_32F, 1, static_cast<int>(level)});
+        }
+    }
+}
+
+void laplacian::benchmark::atCpuLevel(::benchmark::State& state, void (*body)(::benchmark::State&)) {
+
+    const auto level = static_cast<CpuLevel>(state.range(5));
+    if (level > supportedCpuLevel()) {
+        state.SkipWithError("The CPU does not support the level!");
+        return;
+    }
+
+    // The engines take the kernels of the level when they are created, which is inside the body.
+    const CpuLevel previous = cpuLevel();
+    setCpuLevel(level);
+    body(state);
+    setCpuLevel(previous);
+}
+
+std::vector<cv::Mat> laplacian::benchmark::gaussians(const Arguments& arguments) {
+
+    const PyramidGeometry geometry{{arguments.side, arguments.side}, arguments.levels};
+    std::vector<cv::Mat> gaussians;
+    gaussians.push_back(noise(geometry.scaledSize(), arguments.type));
+    for (uint8_t level = 1; level < geometry.levels(); level++) {
+        gaussians.emplace_back(geometry.levelSize(level), arguments.type);
+    }
+    return gaussians;
+}
+
+void laplacian::benchmark::reportLatency(::benchmark::State& state, std::vector<double>& latencies) {
+
+    if (latencies.empty()) {
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](double share) {
+        return latencies.at(static_cast<size_t>(share * static_cast<double>(latencies.size() - 1)));
+    };
+
+    state.counters["p50 ms"] = percentile(0.50);
+    state.counters["p95 ms"] = percentile(0.95);
+    state.counters["p99 ms"] = percentile(0.99);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "macro_definition.hpp"
+
+namespace laplacian {
+
+    /**
+     *
+     * The instruction sets the kernels of the pyramid are built for: REDUCE, EXPAND, the addition and subtraction
+     * of the expansion and the quantization of floating point planes. Every level gives bitwise equal results.
+     *
+     * The library holds the kernels of every level and selects the highest level the CPU supports once, when it is
+     * loaded. The environment variable "LAPLACIAN_PYRAMID_CPU" limits the selection to the given level: "scalar",
+     * "baseline", "sse4", "avx2" or "avx512".
+     */
+    enum class CpuLevel {
+        /**
+         * Plain C++ loops without vector instructions.
+         */
+        SCALAR,
+        /**
+         * The vector instructions the library is compiled for, SSE2 on x86-64 and NEON on ARM.
+         */
+        BASELINE,
+        /**
+         * SSE4.2, x86 only.
+         */
+        SSE4,
+        /**
+         * AVX2 with FMA and F16C, x86 only.
+         */
+        AVX2,
+        /**
+         * AVX-512 F, CD, BW, DQ and VL, x86 only.
+         */
+        AVX512
+    };
+
+    /**
+     *
+     * Gets the highest level the CPU supports and the library is built for.
+     *
+     * @return The level.
+     */
+    EXPORT_LAPLACIAN_PYRAMID CpuLevel supportedCpuLevel();
+
+    /**
+     *
+     * Gets the level the kernels are running with.
+     *
+     * @return The level.
+     */
+    EXPORT_LAPLACIAN_PYRAMID CpuLevel cpuLevel();
+
+    /**
+     *
+     * Runs the kernels with the given level from now on, e.g. to compare the levels. Pyramids which are encoded or
+     * decoded meanwhile may use either level. If the level is not supported, see #supportedCpuLevel,
+     * a #laplacian::LaplacianPyramidException is thrown.
+     *
+     * @param level The level.
+     */
+    EXPORT_LAPLACIAN_PYRAMID void setCpuLevel(CpuLevel level);
+}
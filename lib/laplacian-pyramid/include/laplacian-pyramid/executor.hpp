@@ -0,0 +1,37 @@
+#pragma once
+
+#include "macro_definition.hpp"
+
+#include <functional>
+
+namespace laplacian {
+
+    /**
+     *
+     * Runs independent tasks of the pyramid, for example the row bands of a level, concurrently.
+     * Implement this interface to run the pyramid on an existing thread pool.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID Executor {
+    public:
+        virtual ~Executor() = default;
+
+        /**
+         *
+         * Runs the given task for every index in [0, count) and returns as soon as all of them have finished.
+         * The calling thread may run some of the tasks itself. A task may call parallelFor again.
+         * If a task throws, the first exception is rethrown after all tasks have finished.
+         *
+         * @param count The amount of tasks.
+         * @param task The task which gets the index of the current task.
+         */
+        virtual void parallelFor(int count, const std::function<void(int)>& task) = 0;
+
+        /**
+         *
+         * Gets the amount of tasks which can run at the same time.
+         *
+         * @return The concurrency of the executor.
+         */
+        [[nodiscard]] virtual int concurrency() const = 0;
+    };
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "executor.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    class PyramidGeometry;
+
+    /**
+     *
+     * Keeps the laplacian pyramid of a stream of frames up to date by recomputing only what changed.
+     *
+     * The encoder keeps the gaussian images of the last frame. A changed region of a level changes the reduced
+     * pixels whose 5 taps reach into it and the expanded pixels whose 3 source pixels reach into it. So every
+     * changed rectangle grows by the support of the kernel and shrinks by the decimation on its way up the
+     * pyramid, and only these windows of the gaussians and laplacian planes are recomputed. The planes are the same
+     * as the ones of a #laplacian::LaplacianPyramid of the frame.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID IncrementalEncoder {
+    public:
+
+        /**
+         *
+         * Creates an encoder and encodes the first frame. The frames have the same requirements as the images of
+         * #laplacian::LaplacianPyramid.
+         *
+         * @param frame The first frame.
+         * @param compressions The compression levels.
+         * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         */
+        explicit IncrementalEncoder(const cv::Mat& frame,
+                                    uint8_t compressions = DEFAULT_COMPRESSIONS,
+                                    float quantization = DEFAULT_QUANTIZATION,
+                                    std::shared_ptr<Executor> executor = nullptr);
+
+        ~IncrementalEncoder();
+
+        IncrementalEncoder(const IncrementalEncoder&) = delete;
+        IncrementalEncoder& operator=(const IncrementalEncoder&) = delete;
+
+        /**
+         *
+         * Encodes the next frame. The changed regions are found by comparing the frame with the last one in tiles.
+         * If the frame does not have the size and the type of the first frame,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param frame The next frame.
+         */
+        void update(const cv::Mat& frame);
+
+        /**
+         *
+         * Encodes the next frame, which only differs from the last one inside the given rectangles.
+         * Changes outside the rectangles are ignored. If the frame does not have the size and the type of the first
+         * frame, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param frame The next frame.
+         * @param dirty The rectangles of the frame which changed.
+         */
+        void update(const cv::Mat& frame, const std::vector<cv::Rect>& dirty);
+
+        /**
+         *
+         * Gets the pyramid of the last frame. Its planes are updated in place by the next frame.
+         *
+         * @return The pyramid.
+         */
+        [[nodiscard]] const LaplacianPyramid& pyramid() const;
+
+    private:
+        /**
+         * The width and height of the tiles in which frames are compared.
+         */
+        static constexpr int COMPARE_TILE_SIZE = 32;
+
+        std::shared_ptr<const PyramidGeometry> _geometry;
+        LaplacianPyramid _pyramid;
+        std::vector<cv::Mat> _gaussians;
+
+        /**
+         *
+         * Recomputes a window of the gaussian image of the given level from the level below.
+         *
+         * @param level The level of the gaussian image, at least 1.
+         * @param window The window to recompute.
+         */
+        void reduceWindow(uint8_t level, const cv::Rect& window);
+
+        /**
+         *
+         * Recomputes and quantizes a window of the laplacian plane of the given level.
+         *
+         * @param level The level of the plane.
+         * @param window The window to recompute.
+         */
+        void planeWindow(uint8_t level, const cv::Rect& window);
+
+        /**
+         *
+         * Gets the window of the reduced level whose pixels have taps inside the given window.
+         *
+         * @param window The window of the level below.
+         * @param size The size of the reduced level.
+         *
+         * @return The window of the reduced level, which may be empty.
+         */
+        [[nodiscard]] static cv::Rect reducedWindow(const cv::Rect& window, cv::Size size);
+
+        /**
+         *
+         * Gets the window of the expanded level whose pixels have source pixels inside the given window.
+         *
+         * @param window The window of the level above.
+         * @param sourceSize The size of the level above.
+         * @param size The size of the expanded level.
+         *
+         * @return The window of the expanded level.
+         */
+        [[nodiscard]] static cv::Rect expandedWindow(const cv::Rect& window, cv::Size sourceSize, cv::Size size);
+    };
+}
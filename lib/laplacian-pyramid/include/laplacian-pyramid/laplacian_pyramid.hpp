@@ -1,8 +1,18 @@
 #pragma once
 
 #include "macro_definition.hpp"
+#include "executor.hpp"
+#include "precision.hpp"
+#include "profiler.hpp"
+#include "pyramid_workspace.hpp"
+#include "scaling.hpp"
 
 #include <opencv2/opencv.hpp>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
 #include <vector>
 
 namespace laplacian {
@@ -10,42 +20,240 @@ namespace laplacian {
     const uint8_t DEFAULT_COMPRESSIONS = 5;
     const float DEFAULT_QUANTIZATION = 0.0f;
     const float DEFAULT_A = 1.0f;
+    const int DEFAULT_TILE_SIZE = 256;
+    const uint8_t MAX_8U_COMPRESSIONS = 9;
 
     class EXPORT_LAPLACIAN_PYRAMID LaplacianPyramidException : public std::exception {
     public:
         explicit LaplacianPyramidException(const std::string& message = "");
     };
 
+    class PyramidGeometry;
+    class SparsePlane;
+    class TiledStorage;
+
     class EXPORT_LAPLACIAN_PYRAMID LaplacianPyramid {
     public:
 
         /**
          *
          * Creates a laplacian pyramid for the given image with the expected compression levels and quantization.
-         * The image has to be single channeled and CV_32F encoded.
+         * The image has to be CV_32F, CV_8U or CV_16U encoded with one to four channels. Multi channeled images are
+         * encoded with interleaved channels in one pass, every channel of the laplacian planes is the plane of that
+         * channel.
+         * CV_8U and CV_16U images are encoded in fixed point arithmetic into CV_16S and CV_32S laplacian planes
+         * without converting them to floating point. Their decoding gives the type of the image again and is lossless
+         * as long as no quantization is applied. The fixed point arithmetic needs a kernel "w" of multiples of 1/16.
+         * The outer taps of the default kernel are negative, so the range of the planes grows with every level. Every
+         * CV_16S plane of a CV_8U image holds up to #laplacian::MAX_8U_COMPRESSIONS compressions, more compressions
+         * throw a #laplacian::LaplacianPyramidException. The CV_32S planes of CV_16U images are not bounded.
          * The default quantization is zero, which means no quantization is applied and the full laplacian planes
-         * are being used.
+         * are being used. Otherwise the top level and the level below are quantized with the quantization as step
+         * and every finer level with twice the step of the level above. Integer planes use integer steps.
+         * Quantized levels below the top level which are mostly zero are held as blocks of their non-zero values, and
+         * the decoding only adds the expansion to the rows of blocks with non-zero values.
+         * If an executor is given, every level of the encoding and the decoding is split into row bands which run
+         * on the executor. The result is the same as without an executor.
+         * If a profiler is given, every stage of the encoding and the decoding is measured per level, see
+         * #laplacian::Profiler.
          *
          * @param image The image to encode.
          * @param compressions The compression levels.
          * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         * @param profiler The profiler receiving the measurements of the stages, or nullptr to measure nothing.
          */
         explicit LaplacianPyramid(const cv::Mat& image,
                                   uint8_t compressions = DEFAULT_COMPRESSIONS,
-                                  float quantization = DEFAULT_QUANTIZATION);
+                                  float quantization = DEFAULT_QUANTIZATION,
+                                  std::shared_ptr<Executor> executor = nullptr,
+                                  std::shared_ptr<Profiler> profiler = nullptr);
+
+        /**
+         *
+         * Creates a laplacian pyramid for the given image like the constructor above, but brings the image to a
+         * valid size with the given scaling. The constructor above crops the image. With #laplacian::Scaling::PAD
+         * the image is reflected at its right and bottom border instead, and #decode gives an image of exactly the
+         * size of the given image.
+         *
+         * @param image The image to encode.
+         * @param compressions The compression levels.
+         * @param scaling Whether the image is cropped or padded to a valid size.
+         * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         * @param profiler The profiler receiving the measurements of the stages, or nullptr to measure nothing.
+         */
+        LaplacianPyramid(const cv::Mat& image,
+                         uint8_t compressions,
+                         Scaling scaling,
+                         float quantization = DEFAULT_QUANTIZATION,
+                         std::shared_ptr<Executor> executor = nullptr,
+                         std::shared_ptr<Profiler> profiler = nullptr);
+
+        /**
+         *
+         * Creates a laplacian pyramid for the given image like the constructors above, but uses the memory of the
+         * given workspace instead of allocating the images. The compression levels and the scaling are the ones of
+         * the workspace.
+         * The laplacian planes share the memory of the workspace, see #laplacian::PyramidWorkspace.
+         *
+         * @param image The image to encode. It has to have the size and the type the workspace is made for.
+         * @param workspace The workspace holding the images.
+         * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         * @param profiler The profiler receiving the measurements of the stages, or nullptr to measure nothing.
+         */
+        LaplacianPyramid(const cv::Mat& image,
+                         PyramidWorkspace& workspace,
+                         float quantization = DEFAULT_QUANTIZATION,
+                         std::shared_ptr<Executor> executor = nullptr,
+                         std::shared_ptr<Profiler> profiler = nullptr);
 
         /**
          *
-         * Decodes the pyramid into the original image.
+         * Encodes the given image into this pyramid using the memory of the given workspace.
+         * The quantization and the executor of the pyramid are kept. Once the workspace has been used for an
+         * encoding, this does not allocate any image memory.
+         *
+         * @param image The image to encode. It has to have the size and the type the workspace is made for.
+         * @param workspace The workspace holding the images.
+         */
+        void encode(const cv::Mat& image, PyramidWorkspace& workspace);
+
+        /**
+         *
+         * Decodes the pyramid into the original image. A pyramid of a padded image decodes to the size of the image,
+         * a pyramid of a cropped image to the cropped size, see #imageSize.
          *
          * @return The image resulting from the decoding process.
          *
          */
         [[nodiscard]] cv::Mat decode() const;
 
+        /**
+         *
+         * Decodes the pyramid into the original image using the memory of the given workspace.
+         * This does not allocate any image memory. The workspace has to be made for the size and the type of the
+         * pyramid.
+         *
+         * @param workspace The workspace holding the reconstructed images.
+         *
+         * @return The image resulting from the decoding process. It shares the memory of the workspace and is
+         *         overwritten by the next decoding into the same workspace.
+         */
+        [[nodiscard]] cv::Mat decode(PyramidWorkspace& workspace) const;
+
+        /**
+         *
+         * Decodes the pyramid progressively into the reconstruction of the given level, which is the gaussian image
+         * of that level up to the quantization. The laplacian planes of the finer levels are not touched.
+         * The reconstruction has the type of the image. The reconstruction of level 0 has the size of #decode.
+         * If the pyramid does not have the level,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param level The level to reconstruct, 0 for the original image.
+         *
+         * @return The reconstruction of the given level.
+         */
+        [[nodiscard]] cv::Mat decode(uint8_t level) const;
+
+        /**
+         *
+         * Decodes a region of the reconstruction of the given level. Every level only expands the window of the
+         * level above which the window below needs, the region plus the margin of the kernel. So the effort is
+         * proportional to the region and not to the image. The result is the region of #decode(uint8_t).
+         * If the region does not lie inside the level or the pyramid does not have the level,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param region The region in the coordinates of the given level.
+         * @param level The level to reconstruct, 0 for the original image.
+         *
+         * @return The region of the reconstruction, with the type of the image.
+         */
+        [[nodiscard]] cv::Mat decode(const cv::Rect& region, uint8_t level = 0) const;
+
+        /**
+         *
+         * Writes the pyramid to the given stream in a self describing binary format.
+         * The format holds the kernel, the quantization and every laplacian plane with its size and type.
+         * Quantized planes and the planes of integer images are entropy coded, see #laplacian::LaplacianPyramid
+         * for the quantization. Unquantized floating point planes are stored raw.
+         * If the stream fails, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param stream The stream to write to.
+         */
+        void serialize(std::ostream& stream) const;
+
+        /**
+         *
+         * Reads a pyramid written by #serialize. If the stream does not hold a valid pyramid,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param stream The stream to read from.
+         * @param executor The executor running the row bands of the decoding, or nullptr to run on the calling thread.
+         *
+         * @return The pyramid with the planes of the stream.
+         */
+        [[nodiscard]] static LaplacianPyramid deserialize(std::istream& stream,
+                                                          std::shared_ptr<Executor> executor = nullptr);
+
+        /**
+         *
+         * Writes the pyramid to the given file in a tiled format which can be opened by #open.
+         * Every level is split into square tiles of the given size which are stored raw, so a level or a tile
+         * can be read without reading the rest of the file. If the file cannot be written,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param path The path of the file.
+         * @param tileSize The width and height of the tiles.
+         */
+        void save(const std::string& path, int tileSize = DEFAULT_TILE_SIZE) const;
+
+        /**
+         *
+         * Opens a pyramid written by #save by mapping the file into memory. Opening only reads the header, the
+         * levels are read from the mapping when they are accessed, see #at. If the file does not hold a valid
+         * pyramid, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param path The path of the file.
+         * @param executor The executor running the row bands of the decoding, or nullptr to run on the calling thread.
+         *
+         * @return The pyramid backed by the file.
+         */
+        [[nodiscard]] static LaplacianPyramid open(const std::string& path,
+                                                   std::shared_ptr<Executor> executor = nullptr);
+
+        /**
+         *
+         * Creates a laplacian pyramid for the given image like the constructors above, but only computes a level
+         * when it is accessed, see #at. Creating the pyramid only validates and scales the image. The first access
+         * of a level reduces the gaussians up to the level above it, which are kept for the other levels, and builds
+         * and quantizes its laplacian plane. So a consumer of the fine levels never reduces the coarse levels and a
+         * consumer of the top level never builds a laplacian plane. The computed levels are kept, copies of the
+         * pyramid share them, and the levels may be accessed by several threads at once. #decode computes every
+         * level.
+         * The image is kept, not copied, so it must not be written as long as levels may be computed.
+         *
+         * @param image The image to encode.
+         * @param compressions The compression levels.
+         * @param scaling Whether the image is cropped or padded to a valid size.
+         * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         *
+         * @return The pyramid computing its levels on demand.
+         */
+        [[nodiscard]] static LaplacianPyramid lazy(const cv::Mat& image,
+                                                   uint8_t compressions = DEFAULT_COMPRESSIONS,
+                                                   Scaling scaling = Scaling::CROP,
+                                                   float quantization = DEFAULT_QUANTIZATION,
+                                                   std::shared_ptr<Executor> executor = nullptr);
+
         /**
          *
          * Gets an encoded laplacian image at the expected level.
+         * For an opened pyramid the level is read from the file on every call and only its tiles are touched. A level
+         * held as blocks of its non-zero values is made dense on every call. A level of a lazy pyramid is computed
+         * once, see #lazy.
          *
          * @param level The compression level of the expected laplacian image.
          *
@@ -53,9 +261,26 @@ namespace laplacian {
          */
         [[nodiscard]] cv::Mat at(uint8_t level) const;
 
+        /**
+         *
+         * Gets a region of the encoded laplacian image at the expected level.
+         * For an opened pyramid only the tiles overlapping the region are read. A region inside a single tile shares
+         * the read only memory of the file, which stays valid as long as the pyramid or a copy of it exists.
+         * For a level held as blocks of its non-zero values only the blocks overlapping the region are read.
+         * If the region does not lie inside the level, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param level The compression level of the expected laplacian image.
+         * @param region The region of the laplacian image.
+         *
+         * @return The region of the laplacian image at the given level.
+         */
+        [[nodiscard]] cv::Mat at(uint8_t level, const cv::Rect& region) const;
+
         /**
          *
          * Gets a reference to the encoded image at the expected level.
+         * For an opened pyramid the level is read from the file into memory once. A level held as blocks of its
+         * non-zero values is made dense once and stays dense. A level of a lazy pyramid is computed once.
          *
          * @param level The compression level of the expected laplacian image.
          *
@@ -91,93 +316,316 @@ namespace laplacian {
          */
         [[nodiscard]] uint8_t levels() const;
 
+        /**
+         *
+         * Gets the size of the decoded image. This is the size of the encoded image if it was padded, and the size
+         * of level 0 if it was cropped.
+         *
+         * @return The size of the decoded image.
+         */
+        [[nodiscard]] cv::Size imageSize() const;
+
+        /**
+         *
+         * Gets the size of the tiles of an opened pyramid.
+         *
+         * @return The width and height of the tiles, or zero if the pyramid is not backed by a file.
+         */
+        [[nodiscard]] int tileSize() const;
+
+        /**
+         *
+         * Sets the profiler receiving the measurements of the following encodings and decodings, e.g. of a
+         * deserialized or opened pyramid. Copies of the pyramid share the profiler.
+         *
+         * @param profiler The profiler, or nullptr to stop measuring.
+         */
+        void setProfiler(std::shared_ptr<Profiler> profiler);
+
+        /**
+         *
+         * Gets the profiler of the pyramid.
+         *
+         * @return The profiler, or nullptr if the pyramid is not measured.
+         */
+        [[nodiscard]] std::shared_ptr<Profiler> profiler() const;
+
+        /**
+         *
+         * Sets the precision the laplacian planes of floating point images are held in, and converts the planes of
+         * the pyramid. Following encodings convert their planes as well. The planes of integer images are kept.
+         * The decoding adds the half precision planes without converting them first, so it does not allocate more
+         * than with full precision. #serialize and #save write full precision planes, so deserialized and opened
+         * pyramids start with full precision.
+         *
+         * @param precision The precision of the planes below the top level.
+         */
+        void setPrecision(Precision precision);
+
+        /**
+         *
+         * Gets the precision the laplacian planes of floating point images are held in.
+         *
+         * @return The precision of the planes below the top level.
+         */
+        [[nodiscard]] Precision precision() const;
+
+        /**
+         *
+         * Gets the width of the quantization bins of every level. They follow the quantization, see
+         * #laplacian::LaplacianPyramid::LaplacianPyramid, unless the pyramid was quantized per level by a
+         * #laplacian::RateController. The steps are written by #serialize and #save and read back with the pyramid.
+         *
+         * @return The steps, one per level, zero for levels which are not quantized.
+         */
+        [[nodiscard]] std::vector<float> quantizationSteps() const;
+
     private:
+        struct LazyLevels;
+
+        friend class IncrementalEncoder;
+        friend class PyramidBatch;
+        friend class PyramidBlender;
+        friend class RateController;
+        friend class StripEncoder;
+
+        /**
+         * Levels with less rows than twice this amount are not split into row bands.
+         */
+        static const int MIN_ROWS_PER_BAND = 16;
+
+        /**
+         * Quantized levels with non-zero values in up to this share of their blocks are held as sparse planes.
+         */
+        static constexpr double MAX_SPARSE_OCCUPANCY = 0.5;
+
+        static constexpr char MAGIC[4] = {'L', 'P', 'Y', 'R'};
+        static const uint8_t FORMAT_VERSION = 2;
+
         std::vector<cv::Mat> _laplacianPlanesQuantized;
+        cv::Size _imageSize;
         cv::Mat _kernel;
+        float _quantization;
+
+        /**
+         * The quantization steps of the levels if they do not follow the quantization, otherwise empty.
+         */
+        std::vector<float> _steps;
+
+        std::shared_ptr<Executor> _executor;
+        std::shared_ptr<Profiler> _profiler;
+        Precision _precision;
+
+        /**
+         * The file of an opened pyramid. Levels which are not in memory are read from it.
+         */
+        std::shared_ptr<const TiledStorage> _storage;
+
+        /**
+         * The levels held as blocks of their non-zero values, nullptr for dense levels. The dense plane of a sparse
+         * level is empty.
+         */
+        std::vector<std::shared_ptr<const SparsePlane>> _sparsePlanes;
+
+        /**
+         * The scaled image and the levels computed so far of a lazy pyramid. Levels which are not in memory are
+         * computed from it, see #lazy.
+         */
+        std::shared_ptr<LazyLevels> _lazy;
 
         /**
          *
-         * Validates the given image and applies a valid scaling to perform the fast formulas.
-         * The resulting image shares the same memory with the given image.
-         * If the image cannot be scaled down by the expected compressions, a #laplacian::LaplacianPyramidException is thrown.
+         * Creates a pyramid of the given laplacian planes.
          *
-         * @param image The image to validate and scale.
-         * @param compressions The compressions or levels of the pyramid.
+         * @param planes The laplacian planes.
+         * @param imageSize The size of the decoded image, see #imageSize.
+         * @param kernel The kernel the planes were encoded with, see #kernel.
+         * @param quantization The quantization the planes were encoded with.
+         * @param executor The executor running the row bands, or nullptr to run on the calling thread.
+         */
+        LaplacianPyramid(std::vector<cv::Mat> planes,
+                         cv::Size imageSize,
+                         cv::Mat kernel,
+                         float quantization,
+                         std::shared_ptr<Executor> executor);
+
+        /**
          *
-         * @return The scaled image.
+         * Encodes the given image into the laplacian planes of this pyramid.
+         * The gaussians and planes are allocated if they do not have the sizes of the geometry, otherwise their
+         * memory is reused.
+         *
+         * @param image The image to encode.
+         * @param geometry The geometry of the image.
+         * @param gaussians The gaussian images, one per level.
+         * @param planes The laplacian planes, one per level.
+         * @param sparse Whether quantized levels may be held as sparse planes, see #storePlanes.
          */
-        [[nodiscard]] cv::Mat applyValidScaling(const cv::Mat& image, uint8_t compressions) const;
+        void encode(const cv::Mat& image,
+                    const PyramidGeometry& geometry,
+                    std::vector<cv::Mat>& gaussians,
+                    std::vector<cv::Mat>& planes,
+                    bool sparse);
 
         /**
          *
-         * Removes the last column of the given image.
-         * The resulting image shares the same memory with the original image.
+         * Reconstructs the image from the laplacian planes.
+         * The reconstructed images are allocated if they do not have the sizes of the planes, otherwise their memory
+         * is reused.
          *
-         * @param image The original image.
+         * @param reconstructed The reconstructed images, one per level.
          *
-         * @return The image without the last column.
+         * @return The reconstructed image of level 0.
          */
-        [[nodiscard]] cv::Mat removeLastColumn(const cv::Mat& image) const;
+        [[nodiscard]] cv::Mat reconstruct(std::vector<cv::Mat>& reconstructed) const;
 
         /**
          *
-         * Removes the last row of the given image.
-         * The resulting image shares the same memory with the original image.
+         * Computes the laplacian image at the given level of a lazy pyramid, or gets it if it was computed before.
+         * Only the gaussians the level needs are reduced.
          *
-         * @param image The original image.
+         * @param level The compression level.
          *
-         * @return The image without the last row.
+         * @return The laplacian image at the given level.
          */
-        [[nodiscard]] cv::Mat removeLastRow(const cv::Mat& image) const;
+        [[nodiscard]] cv::Mat lazyLevel(uint8_t level) const;
 
         /**
          *
-         * Cuts the given image to the size of the given rows and columns starting on the left upper corner (0, 0).
+         * Gets the size of the laplacian image at the given level without reading an opened level or computing a lazy
+         * level.
          *
-         * @param image The image which is to cut.
-         * @param rows The expected rows of the cut image.
-         * @param cols The expected columns of the cut image.
+         * @param level The compression level.
          *
-         * @return The cut image sharing the same memory with the original image.
+         * @return The size of the laplacian image.
+         */
+        [[nodiscard]] cv::Size levelSize(uint8_t level) const;
+
+        /**
          *
+         * Gets the type of the laplacian images without reading an opened level or computing a lazy level. This is the
+         * type of the top level, which the levels below have unless they are held in half precision.
+         *
+         * @return The type of the laplacian images.
          */
-        [[nodiscard]] cv::Mat cutImage(const cv::Mat& image, int rows, int cols) const;
+        [[nodiscard]] int planeType() const;
+
+        /**
+         *
+         * Keeps the given laplacian planes as the planes of this pyramid, in the precision of the pyramid. Planes
+         * which are converted reuse the memory of the planes of the pyramid if they have the same size.
+         * If the pyramid is quantized and sparse planes are allowed, the levels below the top level which are mostly
+         * zero are held as #laplacian::SparsePlane instead. Encodings into a workspace keep their planes dense, so
+         * they do not allocate.
+         *
+         * @param planes The laplacian planes of full precision.
+         * @param sparse Whether quantized levels may be held as sparse planes.
+         */
+        void storePlanes(const std::vector<cv::Mat>& planes, bool sparse);
+
+        /**
+         *
+         * Gets the sparse plane of the given level.
+         *
+         * @param level The compression level.
+         *
+         * @return The sparse plane, or nullptr if the level is dense.
+         */
+        [[nodiscard]] const SparsePlane* sparsePlane(uint8_t level) const;
+
+        /**
+         *
+         * Converts a half precision plane to CV_32F.
+         *
+         * @param plane The plane.
+         *
+         * @return The plane itself if it is not held in half precision, otherwise the converted plane.
+         */
+        [[nodiscard]] static cv::Mat fullPrecision(const cv::Mat& plane);
+
+        /**
+         *
+         * Checks whether laplacian images of the given sizes and types form a pyramid, which means they have the
+         * sizes of the levels of the geometry of the first image and the same type.
+         *
+         * @param sizes The sizes of the laplacian images, one per level.
+         * @param types The types of the laplacian images, one per level.
+         *
+         * @return True if the images form a pyramid.
+         */
+        [[nodiscard]] static bool formsPyramid(const std::vector<cv::Size>& sizes, const std::vector<int>& types);
+
+        /**
+         *
+         * Checks whether a decoded image of the given size can be cut out of level 0.
+         *
+         * @param imageSize The size of the decoded image.
+         * @param levelSize The size of level 0.
+         *
+         * @return True if the image is not empty and not larger than level 0.
+         */
+        [[nodiscard]] static bool fitsInto(cv::Size imageSize, cv::Size levelSize);
+
+        /**
+         *
+         * Gets the window of the level above which the expansion of the given window needs. An output pixel 2q or
+         * 2q + 1 needs the source pixels q - 1 to q + 1, clamped to the source.
+         *
+         * @param window The window of the expanded level.
+         * @param sourceSize The size of the level above.
+         *
+         * @return The window of the level above.
+         */
+        [[nodiscard]] static cv::Rect sourceWindow(const cv::Rect& window, cv::Size sourceSize);
 
         /**
          *
-         * Checks if a valid scaling is applied.
-         * The formula is taken from the paper "The Laplacian Pyramid as a Compact Image Code". The presented formula
-         * may be wrong, for the implementation the followin is used: M_c = (C + 1) / 2^N.
-         * Because the matrices in the paper start with an index of -2, the corresponding part of the formula is moved
-         * by +2. This results in the final formula: M_c = (C + 3) / 2^N.
+         * Validates the given image and applies the valid scaling of the given geometry to perform the fast formulas.
+         * A cropped image shares the same memory with the given image. A padded image is a copy with the reflected
+         * border, see #laplacian::Scaling::PAD.
+         * If the image does not have the size of the geometry or does not have a supported type,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param image The image to validate and scale.
+         * @param geometry The geometry of the pyramid.
          *
-         * The dimension is valid when the above formula results in an integer value for M_c.
+         * @return The scaled image.
+         */
+        [[nodiscard]] cv::Mat applyValidScaling(const cv::Mat& image, const PyramidGeometry& geometry) const;
+
+        /**
          *
-         * @param dimension The dimension "C" which is to be checked to validity
-         * @param compressions The levels of the pyramid. This refers to "N" in the above formula.
+         * Applies the valid scaling like above, but pads the image into the given scaled image. If the scaled image
+         * already has the size and the type, its memory is reused.
          *
-         * @return Gives true, when the formula gets an integer value for M_c
+         * @param image The image to validate and scale.
+         * @param geometry The geometry of the pyramid.
+         * @param scaled The scaled image.
          */
-        [[nodiscard]] bool isValidScaling(int dimension, uint8_t compressions) const;
+        void applyValidScaling(const cv::Mat& image, const PyramidGeometry& geometry, cv::Mat& scaled) const;
 
         /**
          *
-         * Checks if a given value is an integer type. It gets true, when the integer is nearly int.
+         * Cuts the given reconstruction of level 0 to the size of the decoded image, see #imageSize.
+         *
+         * @param reconstruction The reconstruction of level 0.
          *
-         * @param value The value to check.
-         * @return Gets true, if the value is of type int or nearly of type int.
+         * @return The decoded image sharing the memory of the reconstruction.
          */
-        [[nodiscard]] bool isInteger(float value) const;
+        [[nodiscard]] cv::Mat cutToImage(const cv::Mat& reconstruction) const;
 
         /**
          *
-         * Checks if two types are nearly the same.
+         * Cuts the given image to the size of the given rows and columns starting on the left upper corner (0, 0).
+         *
+         * @param image The image which is to cut.
+         * @param rows The expected rows of the cut image.
+         * @param cols The expected columns of the cut image.
+         *
+         * @return The cut image sharing the same memory with the original image.
          *
-         * @param value1 The first value
-         * @param value2 The last value
-         * @return Gets true, when the first and the last value are nearly the same.
          */
-        [[nodiscard]] bool isNearlyEqual(float value1, float value2) const;
+        [[nodiscard]] cv::Mat cutImage(const cv::Mat& image, int rows, int cols) const;
 
         /**
          *
@@ -185,92 +633,183 @@ namespace laplacian {
          * The kernel has the following properties: w(2) = a, w(0) = w(4) = 1/4 - a/2, w(1) = w(3) = 1/4
          * Note that the indexes are moved by +2.
          *
-         * This one dimensional kernel "w" is transposed and multiplied by itself to generate the 2D kernel matrix.
+         * The 2D kernel matrix is this one dimensional kernel "w" multiplied by its transposition. Because it is
+         * separable, the 2D kernel is applied as a horizontal and a vertical pass of "w".
          *
          * @param a A value to modify the kernel
-         * @return The 2D kernel described above
+         * @return The one dimensional kernel described above
          */
-        [[nodiscard]] cv::Mat kernel(float a = DEFAULT_A) const;
+        [[nodiscard]] static cv::Mat kernel(float a = DEFAULT_A);
 
         /**
          *
-         * Reduces the given image with the given kernel by the given compressions and gets the results in a vector.
+         * Reduces the given image with the given kernel to the levels of the given geometry.
+         * The gaussian of level 0 is the image itself. Floating point images of a pyramid without a concurrent
+         * executor are reduced to all levels in one cache blocked pass by a #laplacian::ReduceCascade.
          *
          * @param image The image to encode
          * @param kernel The kernel for encoding
-         * @param compressions The expected compression levels.
-         * @return A vector of the reduced images.
+         * @param geometry The geometry of the pyramid.
+         * @param gaussians The reduced images, one per level.
          */
-        [[nodiscard]] std::vector<cv::Mat> reduceToGaussians(const cv::Mat& image,
-                                                             const cv::Mat& kernel,
-                                                             uint8_t compressions) const;
+        void reduceToGaussians(const cv::Mat& image,
+                               const cv::Mat& kernel,
+                               const PyramidGeometry& geometry,
+                               std::vector<cv::Mat>& gaussians) const;
 
         /**
          *
          * Reduces an image with the given kernel to the expected size (rows, columns).
+         * The reduction is done by a #laplacian::ReduceEngine, or a #laplacian::FixedPointReduceEngine for integer
+         * images, in a horizontal and a vertical pass. The reduced image gets the plane type of the image.
          *
          * @param image The image to reduce.
          * @param kernel The kernel used for reduction.
          * @param rows The expected rows of the reduced image.
          * @param columns The expected columns of the reduced image.
-         * @return The reduced image.
+         * @param reduced The reduced image.
          */
-        [[nodiscard]] cv::Mat reduceGaussian(const cv::Mat& image,
-                               const cv::Mat& kernel,
-                               int rows,
-                               int columns) const;
+        void reduceGaussian(const cv::Mat& image, const cv::Mat& kernel, int rows, int columns, cv::Mat& reduced) const;
 
         /**
          *
-         * Upsamples the given images to the double of their sizes.
+         * Upsamples the given image to the size of the given addend and adds it to the addend in one pass.
+         * The upsampled image is never stored. This is the reconstruction step of the decoding.
          *
-         * @param images The images which are to be upsampled.
+         * @param image The image which is to be upsampled.
+         * @param addend The image of the next lower level, the upsampled image is added to.
          * @param kernel The kernel used for upsampling.
-         *
-         * @return The upsampled images of a corresponding level.
+         * @param type The type of the sum. Either the type of the addend or its image type.
+         * @param sum The sum of the addend and the upsampled image.
          */
-        [[nodiscard]] std::vector<cv::Mat> upsample(const std::vector<cv::Mat>& images,
-                                                    const cv::Mat& kernel) const;
+        void upsampleAndAdd(const cv::Mat& image,
+                            const cv::Mat& addend,
+                            const cv::Mat& kernel,
+                            int type,
+                            cv::Mat& sum) const;
 
         /**
          *
-         * Upsamples the given image to the given row and column size.
+         * Upsamples the given image and adds it to the given sparse plane like #upsampleAndAdd. Runs of rows of empty
+         * blocks get the upsampled image only, the rows of occupied blocks are made dense one row of blocks at a time
+         * and added.
          *
          * @param image The image which is to be upsampled.
-         * @param rows The expected row size
-         * @param cols The expeced column size
+         * @param addend The sparse plane of the next lower level, the upsampled image is added to.
          * @param kernel The kernel used for upsampling.
+         * @param type The type of the sum. Either the type of the addend or its image type.
+         * @param sum The sum of the addend and the upsampled image.
+         */
+        void upsampleAndAddSparse(const cv::Mat& image,
+                                  const SparsePlane& addend,
+                                  const cv::Mat& kernel,
+                                  int type,
+                                  cv::Mat& sum) const;
+
+        /**
+         *
+         * Upsamples the given image to the size of the given minuend and subtracts it from the minuend in one pass.
+         * The upsampled image is never stored. This is the encoding step of a laplacian plane.
          *
-         * @return The upsampled image.
+         * @param image The image which is to be upsampled.
+         * @param minuend The image of the next lower level, the upsampled image is subtracted from.
+         * @param kernel The kernel used for upsampling.
+         * @param difference The difference of the minuend and the upsampled image.
          */
-        [[nodiscard]] cv::Mat upsample(const cv::Mat& image, int rows, int cols, const cv::Mat& kernel) const;
+        void upsampleAndSubtract(const cv::Mat& image,
+                                 const cv::Mat& minuend,
+                                 const cv::Mat& kernel,
+                                 cv::Mat& difference) const;
 
         /**
          *
-         * Creates the laplacian planes from the given gaussians and upsampled images.
-         * The laplacian image of level "n" is the level "n" image of the gaussians.
-         * The both vectors have to be of the same length.
+         * Creates the laplacian planes from the given gaussians.
+         * The laplacian image of level "n" is the gaussian of level "n" minus the upsampled gaussian of level "n + 1",
+         * computed in one pass per level by #upsampleAndSubtract. The last laplacian image is the last gaussian.
          *
          * @param gaussians The gaussian images.
-         * @param upsampled The upsampled images.
-         *
-         * @return The laplacian images, which are basically the difference images of the given vectors.
+         * @param kernel The kernel used for upsampling.
+         * @param planes The laplacian images, one per level.
          */
-        [[nodiscard]] std::vector<cv::Mat> buildLaplacianPlanes(const std::vector<cv::Mat>& gaussians,
-                                                                const std::vector<cv::Mat>& upsampled);
+        void buildLaplacianPlanes(const std::vector<cv::Mat>& gaussians,
+                                  const cv::Mat& kernel,
+                                  std::vector<cv::Mat>& planes) const;
 
         /**
          *
          * Quantize uniformly the laplacian planes with the given quantization. The quantization is the delta
          * of one quantization bin. All the values inside a bin are represented by its middle value.
-         * The amount of bins is getting smaller in lower levels of the pyramid.
+         * The amount of bins is getting smaller in lower levels of the pyramid, see #quantizationStep.
+         * The planes are quantized in place.
          *
          * @param laplacianPlanes The laplacian planes which are to be quantized.
          * @param quantization The uniform quantization of the laplacian planes.
+         */
+        void quantize(std::vector<cv::Mat>& laplacianPlanes, float quantization) const;
+
+        /**
+         *
+         * Replaces every value of the given plane, or a region of it, by the middle of its quantization bin.
+         *
+         * @param plane The plane to quantize in place.
+         * @param step The width of the quantization bins, see #quantizationStep.
+         */
+        static void quantizePlane(cv::Mat& plane, float step);
+
+        /**
+         *
+         * Gets the width of the quantization bins of a level. The top level and the level below use the
+         * quantization, every finer level doubles the width of the level above. Integer planes get integer widths
+         * of at least one.
+         *
+         * @param quantization The uniform quantization of the laplacian planes, zero for no quantization.
+         * @param level The level of the plane.
+         * @param levels The levels of the pyramid.
+         * @param type The type of the plane.
+         *
+         * @return The width of the bins, zero for no quantization.
+         */
+        [[nodiscard]] static float quantizationStep(float quantization, uint8_t level, uint8_t levels, int type);
+
+        /**
+         *
+         * Gets the width of the quantization bins of the given level of this pyramid, see #quantizationSteps.
+         *
+         * @param level The level.
+         *
+         * @return The width of the bins, zero for no quantization.
+         */
+        [[nodiscard]] float levelStep(uint8_t level) const;
+
+        /**
+         *
+         * Keeps the given quantization steps of the levels if they do not follow the quantization of this pyramid.
+         *
+         * @param steps The steps, one per level.
+         */
+        void keepSteps(const std::vector<float>& steps);
+
+        /**
+         *
+         * Replaces every value of the given row by the middle of its quantization bin.
+         *
+         * @tparam T The type of the values.
+         * @param row The row to quantize.
+         * @param width The amount of values of the row.
+         * @param step The width of the quantization bins.
+         */
+        template<class T>
+        static void quantizeRow(T* row, int width, float step);
+
+        /**
+         *
+         * Splits the given amount of rows into bands and runs the given body for every band on the executor.
+         * Without executor, or if there are too few rows to split, the body is called once with all rows.
          *
-         * @return The quantized laplacian planes
+         * @param rows The amount of rows to split.
+         * @param body The body which gets the first row and the row behind the last row of a band.
          */
-        [[nodiscard]] std::vector<cv::Mat> quantize(const std::vector<cv::Mat>& laplacianPlanes,
-                                                    float quantization) const;
+        template<class Body>
+        void forEachRowBand(int rows, const Body& body) const;
     };
 }
\ No newline at end of file
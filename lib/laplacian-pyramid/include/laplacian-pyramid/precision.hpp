@@ -0,0 +1,21 @@
+#pragma once
+
+namespace laplacian {
+
+    /**
+     *
+     * How the laplacian planes of floating point images are held in memory.
+     */
+    enum class Precision {
+        /**
+         * Every plane is CV_32F.
+         */
+        FULL,
+        /**
+         * The planes below the top level are CV_16F, which halves their memory. The top level is the gaussian of the
+         * image and keeps CV_32F, the detail planes below have a small range which half precision covers with an
+         * error of at most 2^-11 of a value. The planes are converted back while they are added to the expansion.
+         */
+        HALF
+    };
+}
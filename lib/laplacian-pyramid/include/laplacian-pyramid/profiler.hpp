@@ -0,0 +1,83 @@
+#pragma once
+
+#include "macro_definition.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace laplacian {
+
+    /**
+     *
+     * The stages of the encoding and the decoding of a pyramid.
+     */
+    enum class Stage {
+        /**
+         * Validating the image and cutting it to the valid scaling, level 0.
+         */
+        VALID_SCALING,
+        /**
+         * Reducing the gaussian of the level below into the gaussian of the level.
+         */
+        REDUCE,
+        /**
+         * Upsampling the gaussian of the level above and subtracting it from the gaussian of the level.
+         */
+        LAPLACIAN_PLANE,
+        /**
+         * Quantizing the laplacian plane of the level.
+         */
+        QUANTIZE,
+        /**
+         * Upsampling the reconstruction of the level above and adding the laplacian plane of the level.
+         */
+        RECONSTRUCT
+    };
+
+    /**
+     * The amount of stages of #laplacian::Stage.
+     */
+    const int STAGES = 5;
+
+    /**
+     *
+     * The measurement of one stage at one level.
+     */
+    struct StageEvent {
+        Stage stage;
+        uint8_t level;
+        std::chrono::nanoseconds duration;
+
+        /**
+         * The bytes of image memory the stage allocated, zero if it reused existing memory.
+         */
+        size_t bytesAllocated;
+
+        /**
+         * The pixels the stage wrote.
+         */
+        size_t pixels;
+    };
+
+    /**
+     *
+     * Receives the measurements of the stages of a pyramid. Implement this interface to feed a tracing system, or
+     * use #laplacian::PyramidStats to collect them.
+     * A pyramid without profiler does not read the clock at all. The stages are measured on the thread calling the
+     * pyramid, a stage running its row bands on an executor is measured as a whole. A profiler shared by pyramids
+     * on several threads has to be thread safe.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID Profiler {
+    public:
+        virtual ~Profiler() = default;
+
+        /**
+         *
+         * Records the measurement of a finished stage.
+         *
+         * @param event The measurement.
+         */
+        virtual void record(const StageEvent& event) = 0;
+    };
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "executor.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    class PyramidGeometry;
+
+    /**
+     *
+     * Encodes and decodes many images of one size and type.
+     *
+     * The geometry of the levels and the kernel are computed once for the whole batch instead of once per image.
+     * The images are spread over the executor, so many small images keep all cores busy even though their
+     * levels are too small to be split into row bands. Every thread reuses its own intermediate gaussians and
+     * reconstructions from one image to the next.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID PyramidBatch {
+    public:
+
+        /**
+         *
+         * Creates a batch for images of the given size and type.
+         * If such an image cannot be scaled down by the expected compressions, or the type is not supported by
+         * #laplacian::LaplacianPyramid with that many compressions, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param imageSize The size of the images.
+         * @param type The type of the images.
+         * @param compressions The compression levels.
+         * @param quantization The quantization used for the reduction of entropy.
+         * @param executor The executor running the images, or nullptr to run on the calling thread. The encoded
+         *                 pyramids keep it for their decoding.
+         */
+        PyramidBatch(cv::Size imageSize,
+                     int type,
+                     uint8_t compressions = DEFAULT_COMPRESSIONS,
+                     float quantization = DEFAULT_QUANTIZATION,
+                     std::shared_ptr<Executor> executor = nullptr);
+
+        ~PyramidBatch();
+
+        /**
+         *
+         * Encodes the given images. The result is the same as constructing a #laplacian::LaplacianPyramid for every
+         * image. If an image does not have the size or the type of the batch,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param images The images to encode.
+         *
+         * @return The pyramids of the images, in the order of the images.
+         */
+        [[nodiscard]] std::vector<LaplacianPyramid> encode(const std::vector<cv::Mat>& images) const;
+
+        /**
+         *
+         * Decodes the given pyramids. The result is the same as #laplacian::LaplacianPyramid::decode for every
+         * pyramid.
+         *
+         * @param pyramids The pyramids to decode.
+         *
+         * @return The decoded images, in the order of the pyramids.
+         */
+        [[nodiscard]] std::vector<cv::Mat> decode(const std::vector<LaplacianPyramid>& pyramids) const;
+
+        /**
+         *
+         * Gets the levels of the pyramids of the batch.
+         *
+         * @return The levels.
+         */
+        [[nodiscard]] uint8_t levels() const;
+
+    private:
+        std::shared_ptr<const PyramidGeometry> _geometry;
+        int _type;
+        cv::Mat _kernel;
+        float _quantization;
+        std::shared_ptr<Executor> _executor;
+
+        /**
+         *
+         * Runs the given task for every index in [0, count), on the executor if there is one.
+         *
+         * @param count The amount of tasks.
+         * @param task The task which gets the index of the current task.
+         */
+        void forEachIndex(int count, const std::function<void(int)>& task) const;
+
+        /**
+         *
+         * Gets the executor a single image uses for its row bands. With at least as many images as the executor
+         * runs tasks at the same time, every image runs on one thread.
+         *
+         * @param count The amount of images.
+         *
+         * @return The executor for the row bands, or nullptr.
+         */
+        [[nodiscard]] std::shared_ptr<Executor> bandExecutor(size_t count) const;
+    };
+}
@@ -0,0 +1,238 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "executor.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Combines the laplacian planes of several pyramids of the same size and type into one pyramid, the multi band
+     * blending of Burt and Adelson and the exposure fusion of Mertens et al.
+     *
+     * Every pyramid gets a weight map of the size of the decoded image. The gaussian pyramids of the weight maps are
+     * reduced with the kernel of the pyramids, and every level of the result is the sum of the levels of the
+     * pyramids weighted by the gaussians of that level. So the weights are smooth at coarse levels and sharp at fine
+     * levels, which hides the seams. Every level is combined in one vectorized pass over its rows, split into row
+     * bands if an executor is given, which converts half precision and integer planes while it weights them.
+     * The blender keeps the gaussians of the weight maps, so combining pyramids of the same size again reuses their
+     * memory. A blender is not thread safe, use one blender per thread.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID PyramidBlender {
+    public:
+
+        /**
+         *
+         * Creates a blender.
+         *
+         * @param executor The executor running the row bands of every level, or nullptr to run on the calling
+         *                 thread. The combined pyramids keep it for their decoding.
+         */
+        explicit PyramidBlender(std::shared_ptr<Executor> executor = nullptr);
+
+        /**
+         *
+         * Blends two pyramids with the given mask. The mask is the weight of the first pyramid, one minus the mask
+         * the weight of the second pyramid.
+         * The pyramids have to have the same levels, sizes, type, precision and kernel, and the mask has to be
+         * a CV_32F image with one channel which covers the decoded image, see #laplacian::LaplacianPyramid::imageSize.
+         * Otherwise a #laplacian::LaplacianPyramidException is thrown. A larger mask is cut, a mask smaller than
+         * level 0 of a padded pyramid is padded like the image. One channel of the mask weights every channel of
+         * the planes.
+         *
+         * @param first The pyramid taken where the mask is one.
+         * @param second The pyramid taken where the mask is zero.
+         * @param mask The weights of the first pyramid, usually between zero and one.
+         *
+         * @return The blended pyramid, without quantization.
+         */
+        [[nodiscard]] LaplacianPyramid blend(const LaplacianPyramid& first,
+                                             const LaplacianPyramid& second,
+                                             const cv::Mat& mask);
+
+        /**
+         *
+         * Blends two pyramids into the given result, see #blend. The planes of the result are reused if they have
+         * the size and the type of the blended planes, so copies of the result see the new planes. The result may
+         * be one of the pyramids.
+         *
+         * @param first The pyramid taken where the mask is one.
+         * @param second The pyramid taken where the mask is zero.
+         * @param mask The weights of the first pyramid, usually between zero and one.
+         * @param result The pyramid to blend into.
+         */
+        void blend(const LaplacianPyramid& first,
+                   const LaplacianPyramid& second,
+                   const cv::Mat& mask,
+                   LaplacianPyramid& result);
+
+        /**
+         *
+         * Fuses the given pyramids with the given weights. The weights of every pixel are normalized to a sum of
+         * one, pixels without any weight take the mean of the pyramids.
+         * The pyramids have to fulfill the requirements of #blend, and there has to be one weight map like the mask
+         * of #blend for every pyramid. Otherwise a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param pyramids The pyramids to fuse.
+         * @param weights The weights of the pyramids, not negative.
+         *
+         * @return The fused pyramid, without quantization.
+         */
+        [[nodiscard]] LaplacianPyramid fuse(const std::vector<LaplacianPyramid>& pyramids,
+                                            const std::vector<cv::Mat>& weights);
+
+        /**
+         *
+         * Fuses the given pyramids into the given result, see #fuse. The planes of the result are reused like
+         * the planes of the result of #blend.
+         *
+         * @param pyramids The pyramids to fuse.
+         * @param weights The weights of the pyramids, not negative.
+         * @param result The pyramid to fuse into.
+         */
+        void fuse(const std::vector<LaplacianPyramid>& pyramids,
+                  const std::vector<cv::Mat>& weights,
+                  LaplacianPyramid& result);
+
+    private:
+        std::shared_ptr<Executor> _executor;
+
+        /**
+         * The gaussian pyramids of the weight maps, level 0 is the weight map cut or padded to level 0.
+         */
+        std::vector<std::vector<cv::Mat>> _gaussians;
+
+        /**
+         *
+         * Checks whether the given pyramids can be combined and the given weight maps cover their decoded image.
+         * Otherwise a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param pyramids The pyramids.
+         * @param weights The weight maps.
+         */
+        static void validate(const std::vector<const LaplacianPyramid*>& pyramids, const std::vector<cv::Mat>& weights);
+
+        /**
+         *
+         * Builds the gaussian pyramids of the given weight maps into the kept gaussians.
+         *
+         * @param pyramid A pyramid giving the level sizes and the kernel.
+         * @param weights The weight maps.
+         * @param normalize Whether the weights of every pixel are normalized to a sum of one.
+         */
+        void reduceWeights(const LaplacianPyramid& pyramid, const std::vector<cv::Mat>& weights, bool normalize);
+
+        /**
+         *
+         * Copies the given weight map into the given level 0 of the gaussians, cut or padded to the given size.
+         *
+         * @param weights The weight map.
+         * @param imageSize The size of the decoded image.
+         * @param size The size of level 0.
+         * @param gaussian The level 0 of the gaussians.
+         */
+        static void scaleWeights(const cv::Mat& weights, cv::Size imageSize, cv::Size size, cv::Mat& gaussian);
+
+        /**
+         *
+         * Normalizes the level 0 of the kept gaussians to a sum of one at every pixel.
+         *
+         * @param count The amount of weight maps.
+         */
+        void normalizeWeights(size_t count);
+
+        /**
+         *
+         * Combines every level of the given pyramids with the kept gaussians into the result, which takes the kernel
+         * and the image size of the pyramids.
+         *
+         * @param pyramids The pyramids.
+         * @param complement Whether the second pyramid is weighted with one minus the first gaussians.
+         * @param result The pyramid to combine into.
+         */
+        void combine(const std::vector<const LaplacianPyramid*>& pyramids,
+                     bool complement,
+                     LaplacianPyramid& result) const;
+
+        /**
+         *
+         * Combines the given level of the given pyramids with the kept gaussians into the result.
+         *
+         * @param pyramids The pyramids.
+         * @param level The level.
+         * @param complement Whether the second pyramid is weighted with one minus the first gaussians.
+         * @param result The pyramid to combine into.
+         */
+        void combineLevel(const std::vector<const LaplacianPyramid*>& pyramids,
+                          uint8_t level,
+                          bool complement,
+                          LaplacianPyramid& result) const;
+
+        /**
+         *
+         * Runs the given body for row bands covering [0, rows), on the executor if there is one.
+         *
+         * @param rows The amount of rows.
+         * @param body The body which gets the first row and the end of the band.
+         */
+        void forEachRowBand(int rows, const std::function<void(int, int)>& body) const;
+
+        /**
+         *
+         * Blends a row, the first row weighted with the mask and the second row with one minus the mask.
+         *
+         * @tparam T The depth of the planes.
+         * @tparam CN The channels of the planes.
+         * @param first The row of the first plane.
+         * @param second The row of the second plane.
+         * @param mask The row of the gaussian of the mask.
+         * @param result The row of the result.
+         * @param cols The columns of the row.
+         */
+        template<class T, int CN>
+        static void blendRow(const T* first, const T* second, const float* mask, T* result, int cols);
+
+        /**
+         *
+         * Adds a row weighted with the given weights to the given sums.
+         *
+         * @tparam T The depth of the plane.
+         * @tparam CN The channels of the plane.
+         * @param row The row of the plane.
+         * @param weights The row of the gaussian of the weights.
+         * @param sums The sums of the row.
+         * @param cols The columns of the row.
+         */
+        template<class T, int CN>
+        static void accumulateRow(const T* row, const float* weights, float* sums, int cols);
+
+        /**
+         *
+         * Rounds and saturates the given sums into a row of a plane.
+         *
+         * @tparam T The depth of the plane.
+         * @param sums The sums of the row.
+         * @param row The row of the plane.
+         * @param width The amount of values of the row, its columns times its channels.
+         */
+        template<class T>
+        static void storeSums(const float* sums, T* row, int width);
+
+        /**
+         *
+         * Runs the given body with the depth and the channels of the given plane type as template arguments.
+         *
+         * @param type The type of the planes.
+         * @param body A callable taking a pointer of the depth and a std::integral_constant of the channels.
+         */
+        template<class Body>
+        static void withPlaneType(int type, const Body& body);
+    };
+}
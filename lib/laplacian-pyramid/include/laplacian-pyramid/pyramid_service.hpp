@@ -0,0 +1,134 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace laplacian {
+
+    const size_t DEFAULT_QUEUE_CAPACITY = 16;
+
+    /**
+     *
+     * Encodes and decodes pyramids asynchronously on its own worker threads.
+     *
+     * Every submitted request is queued and returns a future of its result at once. Each worker runs one request
+     * at a time, so the encoding of a frame overlaps with the decoding of the frame before, and a frame pipeline
+     * keeps as many frames in flight as there are workers. The queue is bounded: if it is full, submitting blocks
+     * until a worker takes the oldest request. So a producer faster than the workers is slowed down instead of
+     * queueing frames without limit.
+     * A service may be used by several threads at once.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID PyramidService {
+    public:
+
+        /**
+         *
+         * Creates a service and starts its workers.
+         * If there are no workers or the queue has no capacity, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param workers The amount of worker threads. Defaults to the amount of hardware threads.
+         * @param capacity The amount of requests which may wait for a worker.
+         */
+        explicit PyramidService(int workers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())),
+                                size_t capacity = DEFAULT_QUEUE_CAPACITY);
+
+        /**
+         *
+         * Runs the queued requests and stops the workers. Every future handed out gets its result.
+         */
+        ~PyramidService();
+
+        PyramidService(const PyramidService&) = delete;
+        PyramidService& operator=(const PyramidService&) = delete;
+
+        /**
+         *
+         * Queues the encoding of the given image, see #laplacian::LaplacianPyramid::LaplacianPyramid.
+         * The image is not copied, so it must not be written until the future is ready. If the queue is full, this
+         * blocks until there is room. An exception of the encoding is rethrown by the future.
+         *
+         * @param image The image to encode.
+         * @param compressions The compression levels.
+         * @param quantization The quantization used for the reduction of entropy.
+         *
+         * @return The future of the pyramid.
+         */
+        [[nodiscard]] std::future<LaplacianPyramid> submitEncode(const cv::Mat& image,
+                                                                 uint8_t compressions = DEFAULT_COMPRESSIONS,
+                                                                 float quantization = DEFAULT_QUANTIZATION);
+
+        /**
+         *
+         * Queues the decoding of the given pyramid, see #laplacian::LaplacianPyramid::decode. The pyramid shares its
+         * planes with the given one, so they must not be written until the future is ready. If the queue is full,
+         * this blocks until there is room. An exception of the decoding is rethrown by the future.
+         *
+         * @param pyramid The pyramid to decode.
+         *
+         * @return The future of the decoded image.
+         */
+        [[nodiscard]] std::future<cv::Mat> submitDecode(const LaplacianPyramid& pyramid);
+
+        /**
+         *
+         * Gets the amount of worker threads.
+         *
+         * @return The workers of the service.
+         */
+        [[nodiscard]] int workers() const;
+
+        /**
+         *
+         * Gets the amount of requests which wait for a worker.
+         *
+         * @return The queued requests.
+         */
+        [[nodiscard]] size_t pending() const;
+
+    private:
+        const size_t _capacity;
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _requests;
+        mutable std::mutex _mutex;
+        std::condition_variable _notEmpty;
+        std::condition_variable _notFull;
+        bool _stopping;
+
+        /**
+         *
+         * Queues the given task once there is room and gets the future of its result.
+         *
+         * @tparam Result The result of the task.
+         * @param task The task.
+         *
+         * @return The future of the result.
+         */
+        template<class Result>
+        std::future<Result> submit(std::function<Result()> task);
+
+        /**
+         *
+         * Lets the workers finish the queued requests and joins them.
+         */
+        void stop();
+
+        /**
+         *
+         * The loop of a worker thread, which runs the queued requests until the service is destroyed and the queue
+         * is empty.
+         */
+        void work();
+    };
+}
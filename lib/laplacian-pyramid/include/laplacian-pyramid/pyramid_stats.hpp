@@ -0,0 +1,93 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "profiler.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * The sum of the measurements of a stage.
+     */
+    struct StageStats {
+        size_t calls = 0;
+        std::chrono::nanoseconds duration{0};
+        size_t bytesAllocated = 0;
+        size_t pixels = 0;
+    };
+
+    /**
+     *
+     * A thread safe #laplacian::Profiler summing up the measurements per stage and level. One instance can be
+     * shared by all pyramids whose stages should be attributed together, e.g. all pyramids of a service.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID PyramidStats : public Profiler {
+    public:
+        PyramidStats();
+
+        void record(const StageEvent& event) override;
+
+        /**
+         *
+         * Gets the sum of the measurements of the given stage over all levels.
+         *
+         * @param stage The stage.
+         *
+         * @return The sum of the measurements.
+         */
+        [[nodiscard]] StageStats stage(Stage stage) const;
+
+        /**
+         *
+         * Gets the sum of the measurements of the given stage at the given level.
+         *
+         * @param stage The stage.
+         * @param level The level.
+         *
+         * @return The sum of the measurements, empty if the stage never ran at the level.
+         */
+        [[nodiscard]] StageStats stage(Stage stage, uint8_t level) const;
+
+        /**
+         *
+         * Gets the amount of levels any stage was recorded at.
+         *
+         * @return The highest recorded level plus one.
+         */
+        [[nodiscard]] uint8_t levels() const;
+
+        /**
+         *
+         * Gets the time spent in all stages.
+         *
+         * @return The sum of the durations of all measurements.
+         */
+        [[nodiscard]] std::chrono::nanoseconds total() const;
+
+        /**
+         *
+         * Discards all measurements.
+         */
+        void reset();
+
+    private:
+        mutable std::mutex _mutex;
+        std::vector<std::array<StageStats, STAGES>> _levels;
+
+        /**
+         *
+         * Adds the given measurement to the given sum.
+         *
+         * @param sum The sum.
+         * @param stats The measurement to add.
+         */
+        static void add(StageStats& sum, const StageStats& stats);
+    };
+}
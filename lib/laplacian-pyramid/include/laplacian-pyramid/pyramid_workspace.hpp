@@ -0,0 +1,110 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "scaling.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    class PyramidGeometry;
+
+    /**
+     *
+     * Preallocated memory for encoding and decoding images of one size with a fixed amount of levels.
+     *
+     * All gaussian images, laplacian planes and reconstructions live in one contiguous arena. Every image starts on
+     * a cache line. A #laplacian::LaplacianPyramid encoded with a workspace and decodes into a workspace run without
+     * allocating image memory, so a workspace is meant to be reused for a stream of images.
+     *
+     * The laplacian planes of a pyramid encoded with a workspace share the memory of the workspace. Encoding the next
+     * image with the same workspace overwrites them. The arena stays alive as long as any of its images is referenced.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID PyramidWorkspace {
+    public:
+
+        /**
+         *
+         * Creates a workspace for images of the given size and type.
+         * If such an image cannot be scaled down by the expected compressions, or the type is not supported by
+         * #laplacian::LaplacianPyramid with that many compressions, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param imageSize The size of the images to encode.
+         * @param compressions The compression levels.
+         * @param type The type of the images to encode.
+         * @param scaling Whether the images are cropped or padded to a valid size.
+         */
+        PyramidWorkspace(cv::Size imageSize, uint8_t compressions, int type = CV_32F, Scaling scaling = Scaling::CROP);
+
+        PyramidWorkspace(const PyramidWorkspace&) = delete;
+        PyramidWorkspace& operator=(const PyramidWorkspace&) = delete;
+
+        /**
+         *
+         * Gets the size of the images the workspace is made for.
+         *
+         * @return The image size.
+         */
+        [[nodiscard]] cv::Size imageSize() const;
+
+        /**
+         *
+         * Gets the type of the images the workspace is made for.
+         *
+         * @return The image type.
+         */
+        [[nodiscard]] int type() const;
+
+        /**
+         *
+         * Gets the levels of the pyramids the workspace is made for.
+         *
+         * @return The levels.
+         */
+        [[nodiscard]] uint8_t levels() const;
+
+        /**
+         *
+         * Gets the size of the arena in bytes.
+         *
+         * @return The size of the arena.
+         */
+        [[nodiscard]] size_t bytes() const;
+
+    private:
+        friend class LaplacianPyramid;
+
+        static const size_t CACHE_LINE = 64;
+
+        std::shared_ptr<const PyramidGeometry> _geometry;
+        int _type;
+        cv::Mat _arena;
+        std::vector<cv::Mat> _gaussians;
+        std::vector<cv::Mat> _planes;
+        std::vector<cv::Mat> _reconstructed;
+
+        /**
+         *
+         * Gets an image of the given size which views the arena at the given offset.
+         *
+         * @param offset The offset in the arena in elements.
+         * @param size The size of the image.
+         *
+         * @return The image sharing the memory of the arena.
+         */
+        [[nodiscard]] cv::Mat view(size_t offset, cv::Size size) const;
+
+        /**
+         *
+         * Gets the amount of elements of a plane of the given size, rounded up to whole cache lines.
+         *
+         * @param size The size of the image.
+         *
+         * @return The aligned amount of elements.
+         */
+        [[nodiscard]] size_t alignedElements(cv::Size size) const;
+    };
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Chooses the quantization step of every level of a pyramid for a target size or a target quality, instead of
+     * encoding and decoding the image once per tried quantization.
+     *
+     * The controller measures every unquantized laplacian plane once for a grid of candidate steps: the entropy of
+     * the histogram of the bin indices, which estimates the coded size of the level, and the squared error of the
+     * quantization. An error at a level reaches the decoded image amplified by every expansion down to level 0, so
+     * it is weighted with the gain of the kernel per level. A target is met with a Lagrangian search: for a
+     * multiplier every level takes the step with the least weighted error plus the multiplier times its bits, and
+     * the multiplier is bisected until the estimate meets the target. Only the chosen steps are applied to the
+     * planes, and the result is checked once by serializing or decoding it. If the estimate missed the target, it
+     * is corrected by the measured miss and the search runs again.
+     * The controller keeps the planes of the pyramid, not copies of them, so they must not be written as long as
+     * the controller is used.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID RateController {
+    public:
+
+        /**
+         *
+         * Creates a controller for the given pyramid and measures its levels. The measurements are split over the
+         * executor of the pyramid, if it has one.
+         * If the pyramid is quantized, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param pyramid The unquantized pyramid.
+         */
+        explicit RateController(const LaplacianPyramid& pyramid);
+
+        /**
+         *
+         * Quantizes the pyramid with the finest steps whose #laplacian::LaplacianPyramid::serialize takes at most
+         * the given bytes. If even the coarsest steps take more, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param bytes The budget of the serialized pyramid.
+         *
+         * @return The quantized pyramid.
+         */
+        [[nodiscard]] LaplacianPyramid fitSize(size_t bytes) const;
+
+        /**
+         *
+         * Quantizes the pyramid with the coarsest steps whose decoding keeps the given peak signal to noise ratio
+         * to the decoding of the unquantized pyramid.
+         *
+         * @param psnr The least peak signal to noise ratio in decibel.
+         * @param peak The largest value of the image, 255 for CV_8U images and 65535 for CV_16U images.
+         *
+         * @return The quantized pyramid.
+         */
+        [[nodiscard]] LaplacianPyramid fitPsnr(double psnr, double peak = 255.0) const;
+
+        /**
+         *
+         * Quantizes the pyramid with the given steps, see #laplacian::LaplacianPyramid::quantizationSteps. Integer
+         * planes get integer steps of at least one. If there is not one step per level or a step is negative,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param steps The width of the quantization bins of every level, zero for no quantization.
+         *
+         * @return The quantized pyramid.
+         */
+        [[nodiscard]] LaplacianPyramid quantize(const std::vector<float>& steps) const;
+
+    private:
+
+        /**
+         * A candidate step of a level with its estimated bits and its squared error.
+         */
+        struct Candidate {
+            float step;
+            double bits;
+            double error;
+        };
+
+        /**
+         * The candidate steps get finer by this many steps per halving.
+         */
+        static const int STEPS_PER_OCTAVE = 4;
+
+        /**
+         * The finest candidate step splits the largest value of a level into this many bins.
+         */
+        static const int MAX_BINS = 1 << 15;
+
+        static const int SEARCH_ITERATIONS = 64;
+        static const int MAX_ATTEMPTS = 6;
+
+        /**
+         * A result which meets its target by less than this share of the target is taken without searching again.
+         */
+        static constexpr double TOLERANCE = 0.05;
+
+        LaplacianPyramid _pyramid;
+
+        /**
+         * The laplacian planes of the pyramid in full precision.
+         */
+        std::vector<cv::Mat> _planes;
+
+        /**
+         * The candidates of every level, from the coarsest to the finest step.
+         */
+        std::vector<std::vector<Candidate>> _candidates;
+
+        /**
+         * The factor a squared error at a level is amplified by in the decoded image.
+         */
+        std::vector<double> _gains;
+
+        /**
+         *
+         * Chooses a candidate of every level for the given multiplier.
+         *
+         * @param multiplier The price of a bit in squared error.
+         *
+         * @return The index of the chosen candidate of every level.
+         */
+        [[nodiscard]] std::vector<size_t> choose(double multiplier) const;
+
+        /**
+         *
+         * Searches the finest choice whose estimated bits do not exceed the given bits.
+         *
+         * @param bits The estimated bits.
+         *
+         * @return The index of the chosen candidate of every level.
+         */
+        [[nodiscard]] std::vector<size_t> chooseBits(double bits) const;
+
+        /**
+         *
+         * Searches the coarsest choice whose estimated squared error in the decoded image does not exceed the given
+         * error.
+         *
+         * @param error The estimated squared error.
+         *
+         * @return The index of the chosen candidate of every level.
+         */
+        [[nodiscard]] std::vector<size_t> chooseError(double error) const;
+
+        [[nodiscard]] double bits(const std::vector<size_t>& choice) const;
+        [[nodiscard]] double error(const std::vector<size_t>& choice) const;
+        [[nodiscard]] std::vector<float> steps(const std::vector<size_t>& choice) const;
+
+        /**
+         *
+         * Gets the candidate steps of a plane from the coarsest step, which puts every value into the zero bin, to
+         * the finest step.
+         *
+         * @param plane The plane.
+         *
+         * @return The steps, zero for the unquantized plane of a floating point plane.
+         */
+        [[nodiscard]] static std::vector<float> candidateSteps(const cv::Mat& plane);
+
+        /**
+         *
+         * Measures the bits and the squared error of the given plane quantized with the given step.
+         *
+         * @param plane The plane.
+         * @param step The step.
+         *
+         * @return The candidate of the step.
+         */
+        [[nodiscard]] static Candidate measure(const cv::Mat& plane, float step);
+
+        /**
+         *
+         * Computes the bin indices of a row the way #laplacian::LaplacianPyramid::quantizeRow bins the values and
+         * gets the squared error of the quantization.
+         *
+         * @tparam T The type of the values.
+         * @param row The row.
+         * @param width The amount of values of the row.
+         * @param step The width of the quantization bins.
+         * @param indices The bin indices of the row.
+         *
+         * @return The sum of the squared differences between the values and the middles of their bins.
+         */
+        template<class T>
+        static double binRow(const T* row, int width, float step, int* indices);
+
+        /**
+         *
+         * Gets the amount of bytes #laplacian::LaplacianPyramid::serialize writes for the given pyramid.
+         *
+         * @param pyramid The pyramid.
+         *
+         * @return The bytes of the serialized pyramid.
+         */
+        [[nodiscard]] static size_t serializedBytes(const LaplacianPyramid& pyramid);
+    };
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace laplacian {
+
+    /**
+     *
+     * How an image is brought to a size the pyramid can be built of. A dimension "C" is valid if (C + 3) / 2^N is
+     * an integer for the compression levels "N".
+     */
+    enum class Scaling {
+        /**
+         * Cuts the image at its right and bottom border to the next smaller valid size. The cut pixels are lost and
+         * the decoded image has the smaller size.
+         */
+        CROP,
+        /**
+         * Reflects the image at its right and bottom border to the next larger valid size. The decoded image is
+         * cut back to the size of the image, so no pixel is lost.
+         */
+        PAD
+    };
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "laplacian_pyramid.hpp"
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    class PyramidGeometry;
+    class ReduceEngine;
+    class ExpandEngine;
+
+    /**
+     *
+     * Encodes an image which is given as a sequence of horizontal strips, without holding the image or any level
+     * of the pyramid in memory.
+     *
+     * Every level keeps only the last rows its 5 tap windows need in rolling line buffers. As soon as all rows a
+     * row of a laplacian plane depends on are known, the row is computed and handed to the sink, so the memory is
+     * proportional to the width of the image times the levels. The rows of every level are emitted in order,
+     * the rows of different levels are interleaved. They are exactly the rows of the planes of a
+     * #laplacian::LaplacianPyramid of the whole image.
+     *
+     * Only CV_32F images with one to four channels are supported. Integer strips can be converted strip by strip.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID StripEncoder {
+    public:
+
+        /**
+         * Receives a finished row of a laplacian plane: the level, the row in the plane and the row itself. The
+         * row is only valid during the call.
+         */
+        using Sink = std::function<void(uint8_t level, int row, const cv::Mat& planeRow)>;
+
+        /**
+         *
+         * Creates an encoder for an image of the given size and type.
+         * If such an image cannot be scaled down by the expected compressions or the type is not supported,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param imageSize The size of the whole image.
+         * @param type The type of the image.
+         * @param compressions The compression levels.
+         * @param sink The sink receiving the rows of the laplacian planes.
+         * @param quantization The quantization used for the reduction of entropy, like in #laplacian::LaplacianPyramid.
+         */
+        StripEncoder(cv::Size imageSize,
+                     int type,
+                     uint8_t compressions,
+                     Sink sink,
+                     float quantization = DEFAULT_QUANTIZATION);
+
+        ~StripEncoder();
+
+        StripEncoder(const StripEncoder&) = delete;
+        StripEncoder& operator=(const StripEncoder&) = delete;
+
+        /**
+         *
+         * Encodes the next rows of the image. The strip may have any amount of rows, but the width and the type of
+         * the image. Rows behind the valid scaling of the image are dropped, like the pyramid does.
+         * If the strip does not fit to the image, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param strip The next rows of the image.
+         */
+        void push(const cv::Mat& strip);
+
+        /**
+         *
+         * Pulls strips from the given source and encodes them until the source returns false, then calls #finish.
+         *
+         * @param source Writes the next strip into its argument and returns true, or returns false at the end of
+         *               the image.
+         */
+        void encode(const std::function<bool(cv::Mat& strip)>& source);
+
+        /**
+         *
+         * Checks that the whole image has been pushed and every row of every plane has been emitted.
+         * Otherwise a #laplacian::LaplacianPyramidException is thrown.
+         */
+        void finish();
+
+        /**
+         *
+         * Gets the levels of the pyramid.
+         *
+         * @return The levels.
+         */
+        [[nodiscard]] uint8_t levels() const;
+
+        /**
+         *
+         * Gets the size of the laplacian plane at the given level.
+         *
+         * @param level The level.
+         *
+         * @return The size of the plane.
+         */
+        [[nodiscard]] cv::Size levelSize(uint8_t level) const;
+
+    private:
+        /**
+         * The amount of gaussian rows every level keeps. The encoder emits as soon as possible, so the rows it still
+         * needs are at most 8 rows behind the last row of a level.
+         */
+        static const int GAUSSIAN_ROWS = 8;
+        static const int REDUCE_ROWS = 5;
+        static const int EXPAND_ROWS = 3;
+
+        /**
+         * The rolling state of one level.
+         */
+        struct Level {
+            /** The size of the level. */
+            cv::Size size;
+            /** The amount of gaussian rows known so far. */
+            int produced = 0;
+            /** The amount of plane rows emitted so far. */
+            int emitted = 0;
+            /** The last gaussian rows, row r at r % GAUSSIAN_ROWS. */
+            cv::Mat gaussian;
+            /** The last horizontally reduced gaussian rows of this level, for the reduction of the next level. */
+            cv::Mat reduced;
+            int reducedRows[REDUCE_ROWS] = {-1, -1, -1, -1, -1};
+            /** The last horizontally expanded gaussian rows of the next level, for the planes of this level. */
+            cv::Mat expanded;
+            int expandedRows[EXPAND_ROWS] = {-1, -1, -1};
+            /** The plane row handed to the sink. */
+            cv::Mat plane;
+        };
+
+        std::shared_ptr<const PyramidGeometry> _geometry;
+        int _type;
+        Sink _sink;
+        float _quantization;
+        std::unique_ptr<ReduceEngine> _reduceEngine;
+        std::unique_ptr<ExpandEngine> _expandEngine;
+        std::vector<Level> _levels;
+        int _pushed;
+
+        /**
+         *
+         * Reduces and emits as many rows as the known gaussian rows allow.
+         */
+        void advance();
+
+        /**
+         *
+         * Computes the next gaussian row of the level below the given level.
+         *
+         * @param level The level whose gaussian rows are reduced.
+         */
+        void reduceNextRow(uint8_t level);
+
+        /**
+         *
+         * Computes the next row of the laplacian plane of the given level and hands it to the sink.
+         *
+         * @param level The level of the plane.
+         */
+        void emitNextRow(uint8_t level);
+
+        /**
+         *
+         * Gets a kept gaussian row of the given level. If the row is not kept anymore,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param level The level.
+         * @param row The row.
+         *
+         * @return The gaussian row.
+         */
+        [[nodiscard]] float* gaussianRow(uint8_t level, int row);
+    };
+}
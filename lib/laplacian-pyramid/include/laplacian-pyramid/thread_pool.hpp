@@ -0,0 +1,73 @@
+#pragma once
+
+#include "macro_definition.hpp"
+#include "executor.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * A fixed size pool of threads implementing the #laplacian::Executor.
+     * The thread calling parallelFor takes part in running the tasks, so the pool starts one thread less
+     * than its concurrency.
+     */
+    class EXPORT_LAPLACIAN_PYRAMID ThreadPool : public Executor {
+    public:
+
+        /**
+         *
+         * Creates a pool with the given concurrency.
+         *
+         * @param threads The amount of threads running tasks, including the calling thread.
+         *                Defaults to the amount of hardware threads.
+         */
+        explicit ThreadPool(int threads = static_cast<int>(std::thread::hardware_concurrency()));
+
+        ~ThreadPool() override;
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        void parallelFor(int count, const std::function<void(int)>& task) override;
+
+        [[nodiscard]] int concurrency() const override;
+
+    private:
+        struct Job;
+
+        std::vector<std::thread> _workers;
+        std::deque<std::shared_ptr<Job>> _jobs;
+        std::mutex _mutex;
+        std::condition_variable _wakeUp;
+        bool _stopping;
+
+        /**
+         *
+         * Wakes the workers, which return once the queued jobs are claimed, and joins them.
+         */
+        void stop();
+
+        /**
+         *
+         * The loop of a worker thread, which runs the tasks of the queued jobs until the pool is destroyed.
+         */
+        void work();
+
+        /**
+         *
+         * Claims and runs the next task of the given job.
+         *
+         * @param job The job to run a task of.
+         *
+         * @return Gets false, if all tasks of the job were already claimed.
+         */
+        static bool runNext(Job& job);
+    };
+}
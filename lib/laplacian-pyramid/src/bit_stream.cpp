@@ -0,0 +1,91 @@
+#include "bit_stream.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+
+laplacian::BitWriter::BitWriter(std::vector<uint8_t>& bytes) : _bytes(bytes), _buffer(0), _bits(0) {
+}
+
+void laplacian::BitWriter::write(uint32_t value, int count) {
+
+    if (count == 0) {
+        return;
+    }
+
+    _buffer = (_buffer << count) | (value & (0xFFFFFFFFu >> (32 - count)));
+    _bits += count;
+
+    while (_bits >= 8) {
+        _bits -= 8;
+        _bytes.push_back(static_cast<uint8_t>(_buffer >> _bits));
+    }
+}
+
+void laplacian::BitWriter::flush() {
+
+    if (_bits > 0) {
+        _bytes.push_back(static_cast<uint8_t>(_buffer << (8 - _bits)));
+        _bits = 0;
+    }
+    _buffer = 0;
+}
+
+laplacian::BitReader::BitReader(const uint8_t* data, size_t size) :
+        _data(data),
+        _size(size),
+        _position(0),
+        _consumed(0),
+        _buffer(0),
+        _bits(0) {
+}
+
+uint32_t laplacian::BitReader::peek(int count) {
+
+    if (_bits < count) {
+        fill();
+    }
+    return static_cast<uint32_t>(_buffer >> (64 - count));
+}
+
+void laplacian::BitReader::skip(int count) {
+
+    if (count == 0) {
+        return;
+    }
+
+    if (_bits < count) {
+        fill();
+    }
+
+    _consumed += count;
+    if (_consumed > _size * 8) {
+        throw LaplacianPyramidException{"The stream ends unexpectedly!"};
+    }
+
+    _buffer <<= count;
+    _bits -= count;
+}
+
+uint32_t laplacian::BitReader::read(int count) {
+
+    if (count == 0) {
+        return 0;
+    }
+
+    const uint32_t value = peek(count);
+    skip(count);
+    return value;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::BitReader::fill() {
+
+    while (_bits <= 56) {
+        const uint64_t byte = _position < _size ? _data[_position] : 0;
+        _buffer |= byte << (56 - _bits);
+        _bits += 8;
+        _position++;
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Appends bits to a byte vector, the most significant bit first.
+     */
+    class BitWriter {
+    public:
+
+        /**
+         *
+         * Creates a writer appending to the given bytes.
+         *
+         * @param bytes The bytes to append to.
+         */
+        explicit BitWriter(std::vector<uint8_t>& bytes);
+
+        /**
+         *
+         * Writes the lowest bits of the given value.
+         *
+         * @param value The value holding the bits.
+         * @param count The amount of bits to write, at most 32.
+         */
+        void write(uint32_t value, int count);
+
+        /**
+         *
+         * Writes the pending bits padded with zeros to a whole byte.
+         */
+        void flush();
+
+    private:
+        std::vector<uint8_t>& _bytes;
+        uint64_t _buffer;
+        int _bits;
+    };
+
+    /**
+     *
+     * Reads bits written by a #laplacian::BitWriter. Reading behind the end of the bytes throws a
+     * #laplacian::LaplacianPyramidException.
+     */
+    class BitReader {
+    public:
+
+        /**
+         *
+         * Creates a reader of the given bytes.
+         *
+         * @param data The bytes to read.
+         * @param size The amount of bytes.
+         */
+        BitReader(const uint8_t* data, size_t size);
+
+        /**
+         *
+         * Gets the next bits without consuming them. Bits behind the end of the bytes are zero.
+         *
+         * @param count The amount of bits, between 1 and 32.
+         *
+         * @return The bits in the lowest bits of the result.
+         */
+        [[nodiscard]] uint32_t peek(int count);
+
+        /**
+         *
+         * Consumes the given amount of bits.
+         *
+         * @param count The amount of bits, at most 32.
+         */
+        void skip(int count);
+
+        /**
+         *
+         * Reads and consumes the given amount of bits.
+         *
+         * @param count The amount of bits, at most 32.
+         *
+         * @return The bits in the lowest bits of the result.
+         */
+        [[nodiscard]] uint32_t read(int count);
+
+    private:
+        const uint8_t* _data;
+        size_t _size;
+        size_t _position;
+        size_t _consumed;
+        uint64_t _buffer;
+        int _bits;
+
+        /**
+         *
+         * Fills the buffer up to at least 57 bits.
+         */
+        void fill();
+    };
+}
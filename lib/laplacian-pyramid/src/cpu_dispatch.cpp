@@ -0,0 +1,121 @@
+#include "cpu_dispatch.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+    using laplacian::CpuLevel;
+
+    bool supports(CpuLevel level) {
+
+        switch (level) {
+            case CpuLevel::SCALAR:
+            case CpuLevel::BASELINE:
+                return true;
+#ifdef LAPLACIAN_PYRAMID_X86_KERNELS
+            case CpuLevel::SSE4:
+                return cv::checkHardwareSupport(CV_CPU_SSE4_2) && cv::checkHardwareSupport(CV_CPU_POPCNT);
+            case CpuLevel::AVX2:
+                return supports(CpuLevel::SSE4) && cv::checkHardwareSupport(CV_CPU_AVX2) &&
+                       cv::checkHardwareSupport(CV_CPU_FMA3) && cv::checkHardwareSupport(CV_CPU_FP16);
+            case CpuLevel::AVX512:
+                return supports(CpuLevel::AVX2) && cv::checkHardwareSupport(CV_CPU_AVX_512SKX);
+#endif
+            default:
+                return false;
+        }
+    }
+
+    CpuLevel highestSupported() {
+
+        for (auto level : {CpuLevel::AVX512, CpuLevel::AVX2, CpuLevel::SSE4}) {
+            if (supports(level)) {
+                return level;
+            }
+        }
+        return CpuLevel::BASELINE;
+    }
+
+    /**
+     * Reads the level of the environment variable "LAPLACIAN_PYRAMID_CPU". A level above the supported one is
+     * lowered to it, an unknown value is ignored.
+     */
+    CpuLevel requested(CpuLevel supported) {
+
+        const char* value = std::getenv("LAPLACIAN_PYRAMID_CPU");
+        if (!value) {
+            return supported;
+        }
+
+        const std::pair<const char*, CpuLevel> names[] = {{"scalar", CpuLevel::SCALAR},
+                                                          {"baseline", CpuLevel::BASELINE},
+                                                          {"sse4", CpuLevel::SSE4},
+                                                          {"avx2", CpuLevel::AVX2},
+                                                          {"avx512", CpuLevel::AVX512}};
+        for (const auto& [name, level] : names) {
+            if (std::strcmp(value, name) == 0) {
+                return std::min(level, supported);
+            }
+        }
+        return supported;
+    }
+
+    const laplacian::kernels::KernelTable& kernelsOf(CpuLevel level) {
+
+        switch (level) {
+            case CpuLevel::SCALAR:
+                return laplacian::kernels::scalarKernels();
+#ifdef LAPLACIAN_PYRAMID_X86_KERNELS
+            case CpuLevel::SSE4:
+                return laplacian::kernels::sse4Kernels();
+            case CpuLevel::AVX2:
+                return laplacian::kernels::avx2Kernels();
+            case CpuLevel::AVX512:
+                return laplacian::kernels::avx512Kernels();
+#endif
+            default:
+                return laplacian::kernels::baselineKernels();
+        }
+    }
+
+    std::atomic<const laplacian::kernels::KernelTable*> selected{nullptr};
+
+    const laplacian::kernels::KernelTable& select() {
+
+        const auto& kernels = kernelsOf(requested(highestSupported()));
+        selected.store(&kernels);
+        return kernels;
+    }
+
+    // Selects the kernels when the library is loaded. Kernels used by other static initializers before select them
+    // on their own.
+    [[maybe_unused]] const bool SELECTED_AT_LOAD = (laplacian::kernels::kernelTable(), true);
+}
+
+const laplacian::kernels::KernelTable& laplacian::kernels::kernelTable() {
+
+    const KernelTable* kernels = selected.load(std::memory_order_relaxed);
+    return kernels ? *kernels : select();
+}
+
+laplacian::CpuLevel laplacian::supportedCpuLevel() {
+    return highestSupported();
+}
+
+laplacian::CpuLevel laplacian::cpuLevel() {
+    return kernels::kernelTable().level;
+}
+
+void laplacian::setCpuLevel(CpuLevel level) {
+
+    if (!supports(level)) {
+        throw LaplacianPyramidException{"The CPU level is not supported by this CPU or build!"};
+    }
+
+    selected.store(&kernelsOf(level));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "row_kernels.hpp"
+
+#include <laplacian-pyramid/cpu_level.hpp>
+#include <opencv2/core.hpp>
+
+namespace laplacian::kernels {
+
+    /**
+     *
+     * The row kernels of one #laplacian::CpuLevel. Every level is compiled from simd_kernels.hpp with the flags of
+     * its instruction set in its own translation unit.
+     */
+    struct KernelTable {
+        CpuLevel level;
+
+        /**
+         * Filters and decimates one row of pixels horizontally by the 5 weights of "w", see
+         * #laplacian::ReduceEngine::reduceHorizontally.
+         */
+        void (*reduceRow)(const float* source, int length, int channels, float* target, int cols,
+                          const float* weights);
+
+        /**
+         * Expands one row of pixels horizontally by the 5 doubled weights of "w", see
+         * #laplacian::ExpandEngine::expandHorizontally.
+         */
+        void (*expandRow)(const float* source, int length, int channels, float* target, int cols,
+                          const float* weights);
+
+        /**
+         * Combines rows with the given weights, sum = sum(weights[k] * rows[k]), and writes the sum to the target
+         * with the given accumulation. The sum is accumulated in the order of the rows, so a fused accumulation
+         * gives the same result as storing the sum and adding or subtracting it afterwards. The target may be the
+         * base row. Two, three and five rows are vectorized.
+         */
+        void (*combineRows)(const float* const* rows, const float* weights, int count, Accumulation accumulation,
+                            const float* base, float* target, int cols);
+
+        /**
+         * Combines rows like #combineRows with a half precision base row, which is converted while the sum is added
+         * to it or subtracted from it.
+         */
+        void (*combineHalfRows)(const float* const* rows, const float* weights, int count,
+                                Accumulation accumulation, const cv::float16_t* base, float* target, int cols);
+
+        /**
+         * Replaces every value of a floating point row by the middle of its quantization bin, see
+         * #laplacian::LaplacianPyramid::quantizeRow.
+         */
+        void (*quantizeRow)(float* row, int width, float step);
+    };
+
+    /**
+     *
+     * Gets the kernels of the selected level, see #laplacian::cpuLevel.
+     *
+     * @return The kernels.
+     */
+    [[nodiscard]] const KernelTable& kernelTable();
+
+    /**
+     *
+     * Get the kernels of a level. The kernels of the x86 levels are only built for x86 and may only be touched on a
+     * CPU which supports them, so they are only reached through #kernelTable.
+     *
+     * @return The kernels.
+     */
+    [[nodiscard]] const KernelTable& scalarKernels();
+    [[nodiscard]] const KernelTable& baselineKernels();
+    [[nodiscard]] const KernelTable& sse4Kernels();
+    [[nodiscard]] const KernelTable& avx2Kernels();
+    [[nodiscard]] const KernelTable& avx512Kernels();
+}
@@ -0,0 +1,256 @@
+#include "entropy_coder.hpp"
+#include "bit_stream.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <utility>
+
+void laplacian::EntropyCoder::encode(const int32_t* values, size_t count, std::vector<uint8_t>& bytes) {
+
+    const auto forEachToken = [values, count](const auto& token) {
+
+        size_t i = 0;
+        while (i < count) {
+
+            if (values[i] == 0) {
+
+                size_t run = 1;
+                while (i + run < count && values[i + run] == 0 && run < 0x80000000u) {
+                    run++;
+                }
+                const int length = bitLength(static_cast<uint32_t>(run));
+                token(RUN_SYMBOLS + length - 1, static_cast<uint32_t>(run), length - 1);
+                i += run;
+
+            } else {
+
+                const uint32_t magnitude = values[i] < 0 ? 0u - static_cast<uint32_t>(values[i])
+                                                         : static_cast<uint32_t>(values[i]);
+                const int length = bitLength(magnitude);
+                const uint32_t sign = values[i] < 0 ? 1u : 0u;
+                token(length, (sign << (length - 1)) | (magnitude & ~(1u << (length - 1))), length);
+                i++;
+            }
+        }
+    };
+
+    std::vector<uint64_t> counts(SYMBOLS, 0);
+    forEachToken([&counts](int symbol, uint32_t, int) { counts[symbol]++; });
+
+    std::vector<int> lengths;
+    std::vector<uint32_t> codes;
+    codeLengths(counts, lengths);
+    canonicalCodes(lengths, codes);
+
+    BitWriter writer{bytes};
+    for (int symbol = 0; symbol < SYMBOLS; symbol++) {
+        writer.write(static_cast<uint32_t>(lengths[symbol]), LENGTH_BITS);
+    }
+
+    // The extra bits hold the sign and the magnitude without its highest bit, which is implied by the symbol.
+    forEachToken([&writer, &lengths, &codes](int symbol, uint32_t extra, int extraBits) {
+        writer.write(codes[symbol], lengths[symbol]);
+        writer.write(extra, extraBits);
+    });
+    writer.flush();
+}
+
+void laplacian::EntropyCoder::decode(const uint8_t* data, size_t size, int32_t* values, size_t count) {
+
+    BitReader reader{data, size};
+
+    std::vector<int> lengths(SYMBOLS);
+    for (int symbol = 0; symbol < SYMBOLS; symbol++) {
+
+        lengths[symbol] = static_cast<int>(reader.read(LENGTH_BITS));
+        if (lengths[symbol] > MAX_CODE_LENGTH) {
+            throw LaplacianPyramidException{"The stream holds an invalid code length!"};
+        }
+    }
+
+    // Canonical decoding: the codes of one length are consecutive, starting at firstCode[length].
+    int lengthCounts[MAX_CODE_LENGTH + 1] = {};
+    for (int length : lengths) {
+        lengthCounts[length]++;
+    }
+    lengthCounts[0] = 0;
+
+    uint32_t firstCode[MAX_CODE_LENGTH + 2] = {};
+    int firstIndex[MAX_CODE_LENGTH + 2] = {};
+    uint64_t kraft = 0;
+    for (int length = 1; length <= MAX_CODE_LENGTH; length++) {
+        firstCode[length + 1] = (firstCode[length] + lengthCounts[length]) << 1;
+        firstIndex[length + 1] = firstIndex[length] + lengthCounts[length];
+        kraft += static_cast<uint64_t>(lengthCounts[length]) << (MAX_CODE_LENGTH - length);
+    }
+    if (kraft > (1ull << MAX_CODE_LENGTH)) {
+        throw LaplacianPyramidException{"The stream holds invalid code lengths!"};
+    }
+
+    std::vector<int> sorted(SYMBOLS);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&lengths](int a, int b) { return lengths[a] < lengths[b]; });
+    sorted.erase(sorted.begin(), sorted.begin() + (SYMBOLS - firstIndex[MAX_CODE_LENGTH + 1]));
+
+    // Codes up to FAST_BITS are looked up in one step by their next FAST_BITS bits.
+    std::vector<std::pair<int16_t, int16_t>> fast(1u << FAST_BITS, {0, 0});
+    std::vector<uint32_t> codes;
+    canonicalCodes(lengths, codes);
+    for (int symbol = 0; symbol < SYMBOLS; symbol++) {
+
+        const int length = lengths[symbol];
+        if (length > 0 && length <= FAST_BITS) {
+            const uint32_t begin = codes[symbol] << (FAST_BITS - length);
+            const uint32_t end = begin + (1u << (FAST_BITS - length));
+            std::fill(fast.begin() + begin, fast.begin() + end,
+                      std::make_pair(static_cast<int16_t>(symbol), static_cast<int16_t>(length)));
+        }
+    }
+
+    const auto readSymbol = [&]() -> int {
+
+        const auto& entry = fast[reader.peek(FAST_BITS)];
+        if (entry.second > 0) {
+            reader.skip(entry.second);
+            return entry.first;
+        }
+
+        for (int length = FAST_BITS + 1; length <= MAX_CODE_LENGTH; length++) {
+
+            const uint32_t code = reader.peek(length);
+            if (code >= firstCode[length] && code - firstCode[length] < static_cast<uint32_t>(lengthCounts[length])) {
+                reader.skip(length);
+                return sorted[firstIndex[length] + (code - firstCode[length])];
+            }
+        }
+        throw LaplacianPyramidException{"The stream holds an invalid code!"};
+    };
+
+    size_t i = 0;
+    while (i < count) {
+
+        const int symbol = readSymbol();
+        if (symbol >= RUN_SYMBOLS) {
+
+            const int extraBits = symbol - RUN_SYMBOLS;
+            const size_t run = (size_t{1} << extraBits) | reader.read(extraBits);
+            if (run > count - i) {
+                throw LaplacianPyramidException{"The stream holds a run behind the end of the plane!"};
+            }
+            std::fill(values + i, values + i + run, 0);
+            i += run;
+
+        } else if (symbol > 0) {
+
+            const uint32_t extra = reader.read(symbol);
+            const uint32_t magnitude = (1u << (symbol - 1)) | (extra & ~(1u << (symbol - 1)));
+            const bool negative = (extra >> (symbol - 1)) & 1u;
+            values[i++] = static_cast<int32_t>(negative ? 0u - magnitude : magnitude);
+
+        } else {
+            throw LaplacianPyramidException{"The stream holds an invalid symbol!"};
+        }
+    }
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::EntropyCoder::codeLengths(const std::vector<uint64_t>& counts, std::vector<int>& lengths) {
+
+    lengths.assign(counts.size(), 0);
+    std::vector<uint64_t> weights = counts;
+
+    while (true) {
+
+        // Huffman tree over the used symbols. Nodes behind the symbols are the inner nodes.
+        using Node = std::pair<uint64_t, int>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+        std::vector<int> parents(2 * counts.size(), -1);
+
+        for (size_t symbol = 0; symbol < weights.size(); symbol++) {
+            if (weights[symbol] > 0) {
+                queue.emplace(weights[symbol], static_cast<int>(symbol));
+            }
+        }
+
+        if (queue.empty()) {
+            return;
+        }
+        if (queue.size() == 1) {
+            lengths[queue.top().second] = 1;
+            return;
+        }
+
+        int next = static_cast<int>(counts.size());
+        while (queue.size() > 1) {
+
+            const Node first = queue.top();
+            queue.pop();
+            const Node second = queue.top();
+            queue.pop();
+            parents[first.second] = next;
+            parents[second.second] = next;
+            queue.emplace(first.first + second.first, next++);
+        }
+
+        int longest = 0;
+        for (size_t symbol = 0; symbol < weights.size(); symbol++) {
+
+            if (weights[symbol] == 0) {
+                continue;
+            }
+
+            int length = 0;
+            for (int node = static_cast<int>(symbol); parents[node] >= 0; node = parents[node]) {
+                length++;
+            }
+            lengths[symbol] = length;
+            longest = std::max(longest, length);
+        }
+
+        if (longest <= MAX_CODE_LENGTH) {
+            return;
+        }
+
+        // Flatten the distribution until the longest code fits.
+        for (auto& weight : weights) {
+            weight = weight > 0 ? std::max<uint64_t>(1, weight / 2) : 0;
+        }
+    }
+}
+
+void laplacian::EntropyCoder::canonicalCodes(const std::vector<int>& lengths, std::vector<uint32_t>& codes) {
+
+    codes.assign(lengths.size(), 0);
+
+    std::vector<int> sorted(lengths.size());
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&lengths](int a, int b) { return lengths[a] < lengths[b]; });
+
+    uint32_t code = 0;
+    int previous = 0;
+    for (int symbol : sorted) {
+
+        if (lengths[symbol] == 0) {
+            continue;
+        }
+        code <<= (lengths[symbol] - previous);
+        codes[symbol] = code++;
+        previous = lengths[symbol];
+    }
+}
+
+int laplacian::EntropyCoder::bitLength(uint32_t value) {
+
+    int length = 0;
+    while (value != 0) {
+        value >>= 1;
+        length++;
+    }
+    return length;
+}
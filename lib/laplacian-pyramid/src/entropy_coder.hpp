@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Codes the integer values of a quantized laplacian plane.
+     *
+     * The fine levels of a quantized pyramid are dominated by zeros. The values are therefore tokenized into runs
+     * of zeros and nonzero values. Each token is a symbol of its magnitude category, the bit length of the run or of
+     * the value, followed by the remaining bits of the magnitude and, for values, a sign bit. The symbols are coded
+     * by a canonical huffman code whose code lengths are stored in front of the codes.
+     */
+    class EntropyCoder {
+    public:
+
+        /**
+         *
+         * Codes the given values and appends them to the given bytes.
+         *
+         * @param values The values to code.
+         * @param count The amount of values.
+         * @param bytes The bytes the coded values are appended to.
+         */
+        static void encode(const int32_t* values, size_t count, std::vector<uint8_t>& bytes);
+
+        /**
+         *
+         * Decodes values coded by #encode. If the bytes are no valid code of the given amount of values,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param data The coded bytes.
+         * @param size The amount of coded bytes.
+         * @param values The decoded values.
+         * @param count The amount of values to decode.
+         */
+        static void decode(const uint8_t* data, size_t size, int32_t* values, size_t count);
+
+    private:
+        /**
+         * Symbols 1 to 32 are nonzero values of that bit length, symbols 33 to 64 runs of zeros of the bit length
+         * minus 32. Symbol 0 is not used.
+         */
+        static const int SYMBOLS = 65;
+        static const int RUN_SYMBOLS = 33;
+        static const int MAX_CODE_LENGTH = 24;
+        static const int LENGTH_BITS = 5;
+        static const int FAST_BITS = 10;
+
+        /**
+         *
+         * Computes the huffman code lengths of the given symbol counts, limited to MAX_CODE_LENGTH.
+         *
+         * @param counts The counts of the symbols.
+         * @param lengths The code lengths of the symbols, zero for unused symbols.
+         */
+        static void codeLengths(const std::vector<uint64_t>& counts, std::vector<int>& lengths);
+
+        /**
+         *
+         * Computes the canonical codes of the given code lengths.
+         *
+         * @param lengths The code lengths of the symbols.
+         * @param codes The codes of the symbols.
+         */
+        static void canonicalCodes(const std::vector<int>& lengths, std::vector<uint32_t>& codes);
+
+        /**
+         *
+         * Gets the bit length of the given value.
+         *
+         * @param value The value.
+         *
+         * @return The position of the highest set bit plus one, zero for zero.
+         */
+        [[nodiscard]] static int bitLength(uint32_t value);
+    };
+}
@@ -0,0 +1,112 @@
+#include "expand_engine.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+#include <vector>
+
+laplacian::ExpandEngine::ExpandEngine(const cv::Mat& kernel) : _weights(), _kernels(&kernels::kernelTable()) {
+
+    if (kernel.total() != TAPS || kernel.type() != CV_32F) {
+        throw LaplacianPyramidException{"The generating kernel has to have 5 taps and be CV_32F encoded!"};
+    }
+
+    for (int tap = 0; tap < TAPS; tap++) {
+        _weights[tap] = 2.0f * kernel.at<float>(tap);
+    }
+}
+
+void laplacian::ExpandEngine::apply(const cv::Mat& image, cv::Mat& expanded, int rowBegin, int rowEnd) const {
+
+    run(image, kernels::Accumulation::STORE, nullptr, 0, expanded, rowBegin, rowEnd);
+}
+
+void laplacian::ExpandEngine::applyAndAdd(const cv::Mat& image,
+                                          const cv::Mat& addend,
+                                          cv::Mat& target,
+                                          int rowBegin,
+                                          int rowEnd) const {
+
+    run(image, kernels::Accumulation::ADD, &addend, 0, target, rowBegin, rowEnd);
+}
+
+void laplacian::ExpandEngine::applyAndAdd(const cv::Mat& image,
+                                          const cv::Mat& addend,
+                                          int addendRow,
+                                          cv::Mat& target,
+                                          int rowBegin,
+                                          int rowEnd) const {
+
+    run(image, kernels::Accumulation::ADD, &addend, addendRow, target, rowBegin, rowEnd);
+}
+
+void laplacian::ExpandEngine::applyAndSubtract(const cv::Mat& image,
+                                               const cv::Mat& minuend,
+                                               cv::Mat& target,
+                                               int rowBegin,
+                                               int rowEnd) const {
+
+    run(image, kernels::Accumulation::SUBTRACT, &minuend, 0, target, rowBegin, rowEnd);
+}
+
+void laplacian::ExpandEngine::expandHorizontally(const float* source,
+                                                 int length,
+                                                 int channels,
+                                                 float* target,
+                                                 int cols) const {
+
+    _kernels->expandRow(source, length, channels, target, cols, _weights);
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::ExpandEngine::run(const cv::Mat& image,
+                                  kernels::Accumulation accumulation,
+                                  const cv::Mat* base,
+                                  int baseRow,
+                                  cv::Mat& target,
+                                  int rowBegin,
+                                  int rowEnd) const {
+
+    const int channels = image.channels();
+    if (image.depth() != CV_32F || channels > MAX_CHANNELS || target.type() != image.type() ||
+        (base && base->type() != image.type() && base->type() != CV_16FC(channels))) {
+        throw LaplacianPyramidException{"The images have to be CV_32F encoded with up to four channels!"};
+    }
+
+    const int cols = target.cols;
+    const int width = cols * channels;
+
+    // Ring of horizontally expanded rows. Every output row needs at most the source rows p - 1 to p + 1, which are
+    // distinct modulo the ring size even if the last ones are clamped to the last row of the image.
+    // The ring only grows, so steady state encoding and decoding do not allocate.
+    thread_local std::vector<float> ring;
+    ring.resize(std::max(ring.size(), static_cast<size_t>(PHASE_TAPS * width)));
+    int ringRows[PHASE_TAPS] = {-1, -1, -1};
+
+    const auto horizontal = [&](int row) -> const float* {
+
+        const int slot = row % PHASE_TAPS;
+        float* line = ring.data() + slot * width;
+        if (ringRows[slot] != row) {
+            expandHorizontally(image.ptr<float>(row), image.cols, channels, line, cols);
+            ringRows[slot] = row;
+        }
+        return line;
+    };
+
+    // A half precision base is converted while it is added, see #laplacian::Precision::HALF.
+    if (base && base->depth() == CV_16F) {
+        for (int i = rowBegin; i < rowEnd; i++) {
+            expandVertically(i, image.rows, horizontal, accumulation, base->ptr<cv::float16_t>(i - baseRow),
+                             target.ptr<float>(i), width);
+        }
+        return;
+    }
+
+    for (int i = rowBegin; i < rowEnd; i++) {
+        expandVertically(i, image.rows, horizontal, accumulation, base ? base->ptr<float>(i - baseRow) : nullptr,
+                         target.ptr<float>(i), width);
+    }
+}
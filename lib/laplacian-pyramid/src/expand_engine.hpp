@@ -0,0 +1,214 @@
+#pragma once
+
+#include "cpu_dispatch.hpp"
+#include "row_kernels.hpp"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <type_traits>
+
+namespace laplacian {
+
+    /**
+     *
+     * Applies the EXPAND operation of the paper "The Laplacian Pyramid as a Compact Image Code" in polyphase form.
+     *
+     * Only every second tap of the generating kernel "w" hits a source pixel. An even output column is therefore
+     * the weighted sum of the three source columns q - 1, q and q + 1 with w(4), w(2) and w(0), an odd output
+     * column the sum of the two source columns q and q + 1 with w(3) and w(1). The rows are expanded the same way,
+     * so all four phases are computed directly from their contributing taps by a horizontal and a vertical pass.
+     * The horizontally expanded rows are kept in a ring, so every source row is expanded once.
+     * Taps in front of the image are dropped and taps behind the image are clamped to the last row or column.
+     * The horizontal pass is instantiated with compile time weights for the common kernels, see
+     * #laplacian::kernels::withWeights. Both passes run the kernels of the instruction set selected at load, see
+     * #laplacian::cpuLevel.
+     */
+    class ExpandEngine {
+    public:
+
+        /**
+         *
+         * Creates an engine for the given generating kernel.
+         *
+         * @param kernel The one dimensional generating kernel "w" with 5 taps.
+         */
+        explicit ExpandEngine(const cv::Mat& kernel);
+
+        /**
+         *
+         * Expands the given image into the rows [rowBegin, rowEnd) of the given expanded image.
+         * The image has to be CV_32F encoded with one to four interleaved channels. The expanded image has to be
+         * allocated with the expected size and the type of the image.
+         *
+         * @param image The image to expand.
+         * @param expanded The target of the expansion.
+         * @param rowBegin The first row of the expanded image to compute.
+         * @param rowEnd The row behind the last row of the expanded image to compute.
+         */
+        void apply(const cv::Mat& image, cv::Mat& expanded, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and adds it to the given addend in one pass. Gives the same result as expanding
+         * the image and adding it afterwards, without storing the expanded image.
+         * The target has to be allocated with the size and the type of the image. The addend has the type of the
+         * image or is its CV_16F counterpart, which is converted while it is added.
+         *
+         * @param image The image to expand.
+         * @param addend The image the expansion is added to.
+         * @param target The target of the sum. May be the addend itself.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void applyAndAdd(const cv::Mat& image, const cv::Mat& addend, cv::Mat& target, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and adds it to the given addend like above, but the addend only holds the rows of
+         * the target starting at the given row, e.g. the decompressed rows of a #laplacian::SparsePlane.
+         *
+         * @param image The image to expand.
+         * @param addend The rows the expansion is added to.
+         * @param addendRow The row of the target the first row of the addend belongs to.
+         * @param target The target of the sum.
+         * @param rowBegin The first row of the target to compute, not in front of the addend.
+         * @param rowEnd The row behind the last row of the target to compute, not behind the addend.
+         */
+        void applyAndAdd(const cv::Mat& image,
+                         const cv::Mat& addend,
+                         int addendRow,
+                         cv::Mat& target,
+                         int rowBegin,
+                         int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and subtracts it from the given minuend in one pass. Gives the same result as
+         * expanding the image and subtracting it afterwards, without storing the expanded image.
+         * The target has to be allocated with the size and the type of the image. The minuend has the type of the
+         * image or is its CV_16F counterpart.
+         *
+         * @param image The image to expand.
+         * @param minuend The image the expansion is subtracted from.
+         * @param target The target of the difference. May be the minuend itself.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void applyAndSubtract(const cv::Mat& image,
+                              const cv::Mat& minuend,
+                              cv::Mat& target,
+                              int rowBegin,
+                              int rowEnd) const;
+
+        /**
+         *
+         * Expands one row of pixels horizontally. This is the horizontal pass of #apply.
+         *
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param channels The amount of interleaved channels, one to four.
+         * @param target The horizontally expanded row.
+         * @param cols The length of the expanded row in pixels.
+         */
+        void expandHorizontally(const float* source, int length, int channels, float* target, int cols) const;
+
+        /**
+         *
+         * Combines the horizontally expanded source rows of one expanded row and writes it with the given
+         * accumulation. This is the vertical pass of #apply, #applyAndAdd and #applyAndSubtract.
+         *
+         * @tparam Horizontal A callable of the signature const float*(int).
+         * @tparam Base float or cv::float16_t.
+         * @param row The row of the expanded image.
+         * @param sourceRows The amount of rows of the source image.
+         * @param horizontal Gets the horizontally expanded source row of the given index.
+         * @param accumulation How the expanded row is written to the target.
+         * @param base The row the expanded row is added to or subtracted from, or nullptr to store it.
+         * @param target The target row.
+         * @param width The amount of values of the expanded row, its columns times its channels.
+         */
+        template<class Horizontal, class Base>
+        void expandVertically(int row,
+                              int sourceRows,
+                              const Horizontal& horizontal,
+                              kernels::Accumulation accumulation,
+                              const Base* base,
+                              float* target,
+                              int width) const;
+
+    private:
+        static const int TAPS = 5;
+        static const int PHASE_TAPS = 3;
+        static const int MAX_CHANNELS = 4;
+
+        /**
+         * The weights of "w" multiplied by two, which applies the factor four of EXPAND over both passes.
+         */
+        float _weights[TAPS];
+
+        /**
+         * The kernels selected when the engine is created, see #laplacian::kernels::kernelTable.
+         */
+        const kernels::KernelTable* _kernels;
+
+        /**
+         *
+         * Expands the rows [rowBegin, rowEnd) and writes them to the target with the given accumulation.
+         *
+         * @param image The image to expand.
+         * @param accumulation How the expanded rows are written to the target.
+         * @param base The image the expanded rows are added to or subtracted from, or nullptr to store them.
+         * @param baseRow The row of the target the first row of the base belongs to.
+         * @param target The target image.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void run(const cv::Mat& image,
+                 kernels::Accumulation accumulation,
+                 const cv::Mat* base,
+                 int baseRow,
+                 cv::Mat& target,
+                 int rowBegin,
+                 int rowEnd) const;
+    };
+
+    template<class Horizontal, class Base>
+    void ExpandEngine::expandVertically(int row,
+                                        int sourceRows,
+                                        const Horizontal& horizontal,
+                                        kernels::Accumulation accumulation,
+                                        const Base* base,
+                                        float* target,
+                                        int width) const {
+
+        const int p = row >> 1;
+        const int lastRow = sourceRows - 1;
+        const float* rows[PHASE_TAPS];
+        float weights[PHASE_TAPS];
+        int count = 0;
+
+        if ((row & 1) == 0) {
+
+            rows[count] = horizontal(std::min(p + 1, lastRow));
+            weights[count++] = _weights[0];
+            rows[count] = horizontal(std::min(p, lastRow));
+            weights[count++] = _weights[2];
+            if (p > 0) {
+                rows[count] = horizontal(std::min(p - 1, lastRow));
+                weights[count++] = _weights[4];
+            }
+        } else {
+
+            rows[count] = horizontal(std::min(p + 1, lastRow));
+            weights[count++] = _weights[1];
+            rows[count] = horizontal(std::min(p, lastRow));
+            weights[count++] = _weights[3];
+        }
+
+        if constexpr (std::is_same_v<Base, cv::float16_t>) {
+            _kernels->combineHalfRows(rows, weights, count, accumulation, base, target, width);
+        } else {
+            _kernels->combineRows(rows, weights, count, accumulation, base, target, width);
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include "fixed_expand_engine.hpp"
+#include "fixed_row_kernels.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+laplacian::FixedPointExpandEngine::FixedPointExpandEngine(const cv::Mat& kernel) : _weights() {
+
+    if (kernel.total() != TAPS || kernel.type() != CV_32F) {
+        throw LaplacianPyramidException{"The generating kernel has to have 5 taps and be CV_32F encoded!"};
+    }
+
+    for (int tap = 0; tap < TAPS; tap++) {
+
+        const float scaled = kernels::FIXED_POINT_SCALE * kernel.at<float>(tap);
+        if (std::abs(scaled - static_cast<float>(cvRound(scaled))) > 1e-4f) {
+            throw LaplacianPyramidException{"The generating kernel has no fixed point representation!"};
+        }
+        _weights[tap] = 2 * cvRound(scaled);
+    }
+}
+
+void laplacian::FixedPointExpandEngine::apply(const cv::Mat& image, cv::Mat& expanded, int rowBegin, int rowEnd) const {
+
+    run(image, kernels::Accumulation::STORE, nullptr, 0, expanded, rowBegin, rowEnd);
+}
+
+void laplacian::FixedPointExpandEngine::applyAndAdd(const cv::Mat& image,
+                                                    const cv::Mat& addend,
+                                                    cv::Mat& target,
+                                                    int rowBegin,
+                                                    int rowEnd) const {
+
+    run(image, kernels::Accumulation::ADD, &addend, 0, target, rowBegin, rowEnd);
+}
+
+void laplacian::FixedPointExpandEngine::applyAndAdd(const cv::Mat& image,
+                                                    const cv::Mat& addend,
+                                                    int addendRow,
+                                                    cv::Mat& target,
+                                                    int rowBegin,
+                                                    int rowEnd) const {
+
+    run(image, kernels::Accumulation::ADD, &addend, addendRow, target, rowBegin, rowEnd);
+}
+
+void laplacian::FixedPointExpandEngine::applyAndSubtract(const cv::Mat& image,
+                                                         const cv::Mat& minuend,
+                                                         cv::Mat& target,
+                                                         int rowBegin,
+                                                         int rowEnd) const {
+
+    run(image, kernels::Accumulation::SUBTRACT, &minuend, 0, target, rowBegin, rowEnd);
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::FixedPointExpandEngine::run(const cv::Mat& image,
+                                            kernels::Accumulation accumulation,
+                                            const cv::Mat* base,
+                                            int baseRow,
+                                            cv::Mat& target,
+                                            int rowBegin,
+                                            int rowEnd) const {
+
+    const int source = image.depth();
+    const int addend = base ? base->depth() : source;
+    const int sum = target.depth();
+
+    if ((base && base->channels() != image.channels()) || target.channels() != image.channels()) {
+        throw LaplacianPyramidException{"The images have to have the same channels!"};
+    }
+
+    if (source == CV_16S && addend == CV_16S && sum == CV_16S) {
+        run<short, short, short, int>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else if (source == CV_16S && addend == CV_8U && sum == CV_16S) {
+        run<short, uchar, short, int>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else if (source == CV_16S && addend == CV_16S && sum == CV_8U) {
+        run<short, short, uchar, int>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else if (source == CV_32S && addend == CV_32S && sum == CV_32S) {
+        run<int, int, int, int64_t>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else if (source == CV_32S && addend == CV_16U && sum == CV_32S) {
+        run<int, ushort, int, int64_t>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else if (source == CV_32S && addend == CV_32S && sum == CV_16U) {
+        run<int, int, ushort, int64_t>(image, accumulation, base, baseRow, target, rowBegin, rowEnd);
+    } else {
+        throw LaplacianPyramidException{"The images do not have matching fixed point types!"};
+    }
+}
+
+template<class S, class B, class D, class A>
+void laplacian::FixedPointExpandEngine::run(const cv::Mat& image,
+                                            kernels::Accumulation accumulation,
+                                            const cv::Mat* base,
+                                            int baseRow,
+                                            cv::Mat& target,
+                                            int rowBegin,
+                                            int rowEnd) const {
+
+    const int channels = image.channels();
+    const int cols = target.cols;
+    const int width = cols * channels;
+
+    // Same ring of horizontally expanded rows as in the floating point engine.
+    thread_local std::vector<A> ring;
+    ring.resize(std::max(ring.size(), static_cast<size_t>(PHASE_TAPS * width)));
+    int ringRows[PHASE_TAPS] = {-1, -1, -1};
+
+    const auto horizontal = [&](int row) -> const A* {
+
+        const int slot = row % PHASE_TAPS;
+        A* line = ring.data() + slot * width;
+        if (ringRows[slot] != row) {
+            expandRow(image.ptr<S>(row), image.cols, channels, line, cols);
+            ringRows[slot] = row;
+        }
+        return line;
+    };
+
+    const int lastRow = image.rows - 1;
+    const A* rows[PHASE_TAPS];
+    int weights[PHASE_TAPS];
+
+    for (int i = rowBegin; i < rowEnd; i++) {
+
+        const int p = i >> 1;
+        int count = 0;
+
+        if ((i & 1) == 0) {
+
+            rows[count] = horizontal(std::min(p + 1, lastRow));
+            weights[count++] = _weights[0];
+            rows[count] = horizontal(std::min(p, lastRow));
+            weights[count++] = _weights[2];
+            if (p > 0) {
+                rows[count] = horizontal(std::min(p - 1, lastRow));
+                weights[count++] = _weights[4];
+            }
+        } else {
+
+            rows[count] = horizontal(std::min(p + 1, lastRow));
+            weights[count++] = _weights[1];
+            rows[count] = horizontal(std::min(p, lastRow));
+            weights[count++] = _weights[3];
+        }
+
+        kernels::combineFixedPointRows<A, B, D>(rows, weights, count, accumulation,
+                                                base ? base->ptr<B>(i - baseRow) : nullptr, target.ptr<D>(i), width);
+    }
+}
+
+template<class S, class A>
+void laplacian::FixedPointExpandEngine::expandRow(const S* source,
+                                                  int length,
+                                                  int channels,
+                                                  A* target,
+                                                  int cols) const {
+
+    const A w0 = _weights[0];
+    const A w1 = _weights[1];
+    const A w2 = _weights[2];
+    const A w3 = _weights[3];
+    const A w4 = _weights[4];
+
+    // The interior are all source columns q whose neighbours q - 1 and q + 1 lie inside the source row and whose
+    // odd output column 2q + 1 lies inside the target row.
+    const int interiorBegin = std::min(1, cols / 2);
+    const int interiorEnd = std::max(interiorBegin, std::min(length - 1, cols / 2));
+    const int last = length - 1;
+
+    const auto expandAt = [&](int col) {
+
+        const int q = col >> 1;
+        const S* next = source + std::min(q + 1, last) * channels;
+        const S* center = source + std::min(q, last) * channels;
+        const S* previous = q > 0 ? source + std::min(q - 1, last) * channels : nullptr;
+
+        for (int k = 0; k < channels; k++) {
+
+            A value;
+            if ((col & 1) == 0) {
+                value = w0 * next[k] + w2 * center[k] + (previous ? w4 * previous[k] : 0);
+            } else {
+                value = w1 * next[k] + w3 * center[k];
+            }
+            target[col * channels + k] = value;
+        }
+    };
+
+    int j = 0;
+    for (; j < (interiorBegin << 1); j++) {
+        expandAt(j);
+    }
+
+    int q = interiorBegin;
+
+#if CV_SIMD
+    // Single channel CV_16S rows are expanded like in the floating point kernels. Their sums need more than 16 bits,
+    // so the gaussians are widened to 32 bit lanes.
+    if constexpr (std::is_same<S, short>::value && std::is_same<A, int>::value) {
+        if (channels == 1) {
+
+            const int lanes = cv::v_int32::nlanes;
+            const cv::v_int32 vw0 = cv::vx_setall_s32(w0);
+            const cv::v_int32 vw1 = cv::vx_setall_s32(w1);
+            const cv::v_int32 vw2 = cv::vx_setall_s32(w2);
+            const cv::v_int32 vw3 = cv::vx_setall_s32(w3);
+            const cv::v_int32 vw4 = cv::vx_setall_s32(w4);
+
+            for (; q + lanes <= interiorEnd; q += lanes) {
+
+                const cv::v_int32 previous = cv::vx_load_expand(source + q - 1);
+                const cv::v_int32 center = cv::vx_load_expand(source + q);
+                const cv::v_int32 next = cv::vx_load_expand(source + q + 1);
+
+                cv::v_store_interleave(target + (q << 1),
+                                       vw0 * next + vw2 * center + vw4 * previous,
+                                       vw1 * next + vw3 * center);
+            }
+            cv::vx_cleanup();
+        }
+    }
+#endif
+
+    for (; q < interiorEnd; q++) {
+
+        const S* tap = source + q * channels;
+        A* even = target + (q << 1) * channels;
+        A* odd = even + channels;
+        for (int k = 0; k < channels; k++) {
+            even[k] = w0 * tap[channels + k] + w2 * tap[k] + w4 * tap[k - channels];
+            odd[k] = w1 * tap[channels + k] + w3 * tap[k];
+        }
+    }
+
+    for (j = interiorEnd << 1; j < cols; j++) {
+        expandAt(j);
+    }
+}
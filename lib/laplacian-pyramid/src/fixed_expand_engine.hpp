@@ -0,0 +1,157 @@
+#pragma once
+
+#include "row_kernels.hpp"
+
+#include <opencv2/core.hpp>
+
+namespace laplacian {
+
+    /**
+     *
+     * Applies the EXPAND operation like #laplacian::ExpandEngine in fixed point arithmetic.
+     *
+     * The weights of the generating kernel "w" are doubled and scaled to integers by kernels::FIXED_POINT_SCALE.
+     * The horizontal pass sums exactly, the vertical pass rounds the expansion once to the nearest integer before
+     * it is added or subtracted. Because the decoding adds the same rounded expansion the encoding subtracted, an
+     * unquantized pyramid decodes losslessly. CV_16S images are expanded with 32 bit sums, CV_32S images with
+     * 64 bit sums.
+     */
+    class FixedPointExpandEngine {
+    public:
+
+        /**
+         *
+         * Creates an engine for the given generating kernel.
+         * If the kernel does not consist of multiples of 1/16, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param kernel The one dimensional generating kernel "w" with 5 taps.
+         */
+        explicit FixedPointExpandEngine(const cv::Mat& kernel);
+
+        /**
+         *
+         * Expands the given image into the rows [rowBegin, rowEnd) of the given expanded image.
+         * The expanded image has to be allocated with the expected size and the type of the image.
+         *
+         * @param image The image to expand. It has to be CV_16S or CV_32S encoded.
+         * @param expanded The target of the expansion.
+         * @param rowBegin The first row of the expanded image to compute.
+         * @param rowEnd The row behind the last row of the expanded image to compute.
+         */
+        void apply(const cv::Mat& image, cv::Mat& expanded, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and adds it to the given addend in one pass with saturation.
+         * The target has to be allocated with the size of the addend and either the type of the addend or, to
+         * decode the last level, the image type of the addend.
+         *
+         * @param image The image to expand. It has to be CV_16S or CV_32S encoded.
+         * @param addend The image the expansion is added to. It has to have the type of the image.
+         * @param target The target of the sum. May be the addend itself.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void applyAndAdd(const cv::Mat& image, const cv::Mat& addend, cv::Mat& target, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and adds it to the given addend like above, but the addend only holds the rows of
+         * the target starting at the given row, e.g. the decompressed rows of a #laplacian::SparsePlane.
+         *
+         * @param image The image to expand. It has to be CV_16S or CV_32S encoded.
+         * @param addend The rows the expansion is added to. It has to have the type of the image.
+         * @param addendRow The row of the target the first row of the addend belongs to.
+         * @param target The target of the sum.
+         * @param rowBegin The first row of the target to compute, not in front of the addend.
+         * @param rowEnd The row behind the last row of the target to compute, not behind the addend.
+         */
+        void applyAndAdd(const cv::Mat& image,
+                         const cv::Mat& addend,
+                         int addendRow,
+                         cv::Mat& target,
+                         int rowBegin,
+                         int rowEnd) const;
+
+        /**
+         *
+         * Expands the given image and subtracts it from the given minuend in one pass.
+         * The target has to be allocated with the size of the minuend and the type of the image.
+         *
+         * @param image The image to expand. It has to be CV_16S or CV_32S encoded.
+         * @param minuend The image the expansion is subtracted from. It has to have the type of the image, or for
+         *                the first level the image type of it.
+         * @param target The target of the difference.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void applyAndSubtract(const cv::Mat& image,
+                              const cv::Mat& minuend,
+                              cv::Mat& target,
+                              int rowBegin,
+                              int rowEnd) const;
+
+    private:
+        static const int TAPS = 5;
+        static const int PHASE_TAPS = 3;
+
+        /**
+         * The weights of "w" multiplied by two and the fixed point scale.
+         */
+        int _weights[TAPS];
+
+        /**
+         *
+         * Selects the types of the given images and expands the rows [rowBegin, rowEnd) with them.
+         *
+         * @param image The image to expand.
+         * @param accumulation How the expanded rows are written to the target.
+         * @param base The image the expanded rows are added to or subtracted from, or nullptr to store them.
+         * @param baseRow The row of the target the first row of the base belongs to.
+         * @param target The target image.
+         * @param rowBegin The first row of the target to compute.
+         * @param rowEnd The row behind the last row of the target to compute.
+         */
+        void run(const cv::Mat& image,
+                 kernels::Accumulation accumulation,
+                 const cv::Mat* base,
+                 int baseRow,
+                 cv::Mat& target,
+                 int rowBegin,
+                 int rowEnd) const;
+
+        /**
+         *
+         * Expands the rows [rowBegin, rowEnd) with the given source, base, target and sum types.
+         *
+         * @tparam S The type of the image.
+         * @tparam B The type of the base.
+         * @tparam D The type of the target.
+         * @tparam A The type of the sums.
+         */
+        template<class S, class B, class D, class A>
+        void run(const cv::Mat& image,
+                 kernels::Accumulation accumulation,
+                 const cv::Mat* base,
+                 int baseRow,
+                 cv::Mat& target,
+                 int rowBegin,
+                 int rowEnd) const;
+
+        /**
+         *
+         * Expands one source row of pixels with interleaved channels horizontally into exact sums.
+         * Single channel CV_16S rows are vectorized.
+         *
+         * @tparam S The type of the source row.
+         * @tparam A The type of the sums.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param channels The amount of channels.
+         * @param target The target row.
+         * @param cols The length of the target row in pixels.
+         */
+        template<class S, class A>
+        void expandRow(const S* source, int length, int channels, A* target, int cols) const;
+    };
+}
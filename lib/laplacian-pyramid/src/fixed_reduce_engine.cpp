@@ -0,0 +1,223 @@
+#include "fixed_reduce_engine.hpp"
+#include "fixed_row_kernels.hpp"
+#include "pyramid_types.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+#if CV_SIMD
+    cv::v_int16 broadcast(short weight) {
+        return cv::vx_setall_s16(weight);
+    }
+
+    cv::v_int32 broadcast(int weight) {
+        return cv::vx_setall_s32(weight);
+    }
+
+    // Widens a register of values into two registers of the lanes of their sums.
+    void widen(const cv::v_uint8& values, cv::v_int16& low, cv::v_int16& high) {
+
+        cv::v_uint16 first, second;
+        cv::v_expand(values, first, second);
+        low = cv::v_reinterpret_as_s16(first);
+        high = cv::v_reinterpret_as_s16(second);
+    }
+
+    void widen(const cv::v_int16& values, cv::v_int32& low, cv::v_int32& high) {
+        cv::v_expand(values, low, high);
+    }
+
+    // Weights the even and odd columns of the taps 2j - 2 to 2j + 2 of the columns j.
+    template<class V>
+    V combineTaps(const V* weight, const V& even0, const V& odd0, const V& even1, const V& odd1, const V& even2) {
+        return weight[0] * even2 + weight[1] * odd1 + weight[2] * even1 + weight[3] * odd0 + weight[4] * even0;
+    }
+#endif
+}
+
+laplacian::FixedPointReduceEngine::FixedPointReduceEngine(const cv::Mat& kernel) : _weights() {
+
+    if (kernel.total() != TAPS || kernel.type() != CV_32F) {
+        throw LaplacianPyramidException{"The generating kernel has to have 5 taps and be CV_32F encoded!"};
+    }
+
+    for (int tap = 0; tap < TAPS; tap++) {
+
+        const float scaled = kernels::FIXED_POINT_SCALE * kernel.at<float>(tap);
+        _weights[tap] = cvRound(scaled);
+        if (std::abs(scaled - static_cast<float>(_weights[tap])) > 1e-4f) {
+            throw LaplacianPyramidException{"The generating kernel has no fixed point representation!"};
+        }
+    }
+}
+
+void laplacian::FixedPointReduceEngine::apply(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const {
+
+    if (reduced.type() != types::planeType(image.type())) {
+        throw LaplacianPyramidException{"The reduced image does not have the plane type of the image!"};
+    }
+
+    switch (image.depth()) {
+        case CV_8U:
+            run<uchar, short, short>(image, reduced, rowBegin, rowEnd);
+            break;
+        case CV_16S:
+            run<short, short, int>(image, reduced, rowBegin, rowEnd);
+            break;
+        case CV_16U:
+            run<ushort, int, int64_t>(image, reduced, rowBegin, rowEnd);
+            break;
+        case CV_32S:
+            run<int, int, int64_t>(image, reduced, rowBegin, rowEnd);
+            break;
+        default:
+            throw LaplacianPyramidException{"The image has to be CV_8U, CV_16U, CV_16S or CV_32S encoded!"};
+    }
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+template<class S, class D, class A>
+void laplacian::FixedPointReduceEngine::run(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const {
+
+    const int channels = image.channels();
+    const int cols = reduced.cols;
+    const int width = cols * channels;
+
+    // Same ring of horizontally reduced rows as in the floating point engine.
+    thread_local std::vector<A> ring;
+    ring.resize(std::max(ring.size(), static_cast<size_t>(TAPS * width)));
+    int ringRows[TAPS] = {-1, -1, -1, -1, -1};
+
+    const auto horizontal = [&](int row) -> const A* {
+
+        const int slot = row % TAPS;
+        A* line = ring.data() + slot * width;
+        if (ringRows[slot] != row) {
+            reduceRow(image.ptr<S>(row), image.cols, channels, line, cols);
+            ringRows[slot] = row;
+        }
+        return line;
+    };
+
+    const A* rows[TAPS];
+    int weights[TAPS];
+
+    for (int i = rowBegin; i < rowEnd; i++) {
+
+        int count = 0;
+        for (int m = -TAPS / 2; m <= TAPS / 2; m++) {
+
+            const int row = (i << 1) - m;
+            if (row >= 0) {
+                rows[count] = horizontal(std::min(row, image.rows - 1));
+                weights[count] = _weights[m + TAPS / 2];
+                count++;
+            }
+        }
+
+        kernels::combineFixedPointRows<A, D, D>(rows, weights, count, kernels::Accumulation::STORE, nullptr,
+                                                reduced.ptr<D>(i), width);
+    }
+}
+
+template<class S, class A>
+void laplacian::FixedPointReduceEngine::reduceRow(const S* source,
+                                                  int length,
+                                                  int channels,
+                                                  A* target,
+                                                  int cols) const {
+
+    const A w0 = _weights[0];
+    const A w1 = _weights[1];
+    const A w2 = _weights[2];
+    const A w3 = _weights[3];
+    const A w4 = _weights[4];
+
+    // The interior are all columns whose taps 2j - 2 to 2j + 2 lie inside the source row.
+    const int interiorBegin = std::min(1, cols);
+    const int interiorEnd = std::max(interiorBegin, std::min(cols, (length - 1) / 2));
+
+    const auto reduceAt = [&](int j) {
+
+        for (int k = 0; k < channels; k++) {
+
+            A value = 0;
+            for (int n = -TAPS / 2; n <= TAPS / 2; n++) {
+
+                const int col = (j << 1) - n;
+                if (col >= 0) {
+                    value += _weights[n + TAPS / 2] * static_cast<A>(source[std::min(col, length - 1) * channels + k]);
+                }
+            }
+            target[j * channels + k] = value;
+        }
+    };
+
+    int j = 0;
+    for (; j < interiorBegin; j++) {
+        reduceAt(j);
+    }
+
+#if CV_SIMD
+    // Single channel rows are split into even and odd columns like in the floating point kernels. The sums of CV_8U
+    // rows fit into 16 bits, so they are computed in twice as many lanes as the 32 bit sums of CV_16S rows.
+    constexpr bool vectorized = (std::is_same<S, uchar>::value && std::is_same<A, short>::value) ||
+                                (std::is_same<S, short>::value && std::is_same<A, int>::value);
+    if constexpr (vectorized) {
+        if (channels == 1) {
+
+            using Values = decltype(cv::vx_load(source));
+            using Sums = decltype(broadcast(w0));
+            const int lanes = Values::nlanes;
+            const int half = Sums::nlanes;
+            const Sums weight[TAPS] = {broadcast(w0), broadcast(w1), broadcast(w2), broadcast(w3), broadcast(w4)};
+
+            // The last load reads the columns up to 2 (j + lanes) + 1.
+            for (; j + lanes <= interiorEnd && 2 * (j + lanes) + 2 <= length; j += lanes) {
+
+                const S* tap = source + (j << 1) - 2;
+                Values even0, odd0, even1, odd1, even2, odd2;
+                cv::v_load_deinterleave(tap, even0, odd0);
+                cv::v_load_deinterleave(tap + 2, even1, odd1);
+                cv::v_load_deinterleave(tap + 4, even2, odd2);
+
+                Sums e0[2], o0[2], e1[2], o1[2], e2[2];
+                widen(even0, e0[0], e0[1]);
+                widen(odd0, o0[0], o0[1]);
+                widen(even1, e1[0], e1[1]);
+                widen(odd1, o1[0], o1[1]);
+                widen(even2, e2[0], e2[1]);
+                for (int part = 0; part < 2; part++) {
+                    cv::v_store(target + j + part * half,
+                                combineTaps(weight, e0[part], o0[part], e1[part], o1[part], e2[part]));
+                }
+            }
+            cv::vx_cleanup();
+        }
+    }
+#endif
+
+    for (; j < interiorEnd; j++) {
+
+        const S* tap = source + (j << 1) * channels;
+        A* pixel = target + j * channels;
+        for (int k = 0; k < channels; k++) {
+            pixel[k] = w0 * tap[2 * channels + k] + w1 * tap[channels + k] + w2 * tap[k] +
+                       w3 * tap[k - channels] + w4 * tap[k - 2 * channels];
+        }
+    }
+
+    for (; j < cols; j++) {
+        reduceAt(j);
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+namespace laplacian {
+
+    /**
+     *
+     * Applies the REDUCE operation like #laplacian::ReduceEngine in fixed point arithmetic.
+     *
+     * The weights of the generating kernel "w" are scaled to integers by kernels::FIXED_POINT_SCALE. The horizontal
+     * pass sums exactly, the vertical pass rounds once to the nearest integer. CV_8U and CV_16S images are reduced
+     * into CV_16S images with 32 bit sums, CV_16U and CV_32S images into CV_32S images with 64 bit sums. The
+     * horizontal sums of CV_8U images need at most 14 bits, so they are held and vectorized in 16 bits.
+     */
+    class FixedPointReduceEngine {
+    public:
+
+        /**
+         *
+         * Creates an engine for the given generating kernel.
+         * If the kernel does not consist of multiples of 1/16, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param kernel The one dimensional generating kernel "w" with 5 taps.
+         */
+        explicit FixedPointReduceEngine(const cv::Mat& kernel);
+
+        /**
+         *
+         * Reduces the given image into the rows [rowBegin, rowEnd) of the given reduced image.
+         * The reduced image has to be allocated with the expected size and the plane type of the image.
+         *
+         * @param image The image to reduce.
+         * @param reduced The target of the reduction.
+         * @param rowBegin The first row of the reduced image to compute.
+         * @param rowEnd The row behind the last row of the reduced image to compute.
+         */
+        void apply(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const;
+
+    private:
+        static const int TAPS = 5;
+
+        int _weights[TAPS];
+
+        /**
+         *
+         * Reduces the rows [rowBegin, rowEnd) with the given source, target and sum types.
+         *
+         * @tparam S The type of the image.
+         * @tparam D The type of the reduced image.
+         * @tparam A The type of the sums.
+         * @param image The image to reduce.
+         * @param reduced The target of the reduction.
+         * @param rowBegin The first row of the reduced image to compute.
+         * @param rowEnd The row behind the last row of the reduced image to compute.
+         */
+        template<class S, class D, class A>
+        void run(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Filters and decimates one source row of pixels with interleaved channels into exact sums.
+         * Single channel CV_8U and CV_16S rows are vectorized.
+         *
+         * @tparam S The type of the source row.
+         * @tparam A The type of the sums.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param channels The amount of channels.
+         * @param target The target row.
+         * @param cols The length of the target row in pixels.
+         */
+        template<class S, class A>
+        void reduceRow(const S* source, int length, int channels, A* target, int cols) const;
+    };
+}
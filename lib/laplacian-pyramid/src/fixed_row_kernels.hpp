@@ -0,0 +1,135 @@
+#pragma once
+
+#include "row_kernels.hpp"
+
+#include <opencv2/core.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstdint>
+#include <type_traits>
+
+namespace laplacian::kernels {
+
+    /**
+     * The fixed point weights are the weights of the generating kernel "w" multiplied by this scale, so "w" has to
+     * consist of multiples of 1/16. This holds for every "a" which is a multiple of 1/8, e.g. 1 and 0.375.
+     */
+    const int FIXED_POINT_SCALE = 16;
+
+    /**
+     * Divides the sum of both passes by FIXED_POINT_SCALE * FIXED_POINT_SCALE.
+     */
+    const int FIXED_POINT_SHIFT = 8;
+
+    // The rounding shifts negative sums right and relies on the arithmetic shift, which rounds towards negative
+    // infinity like the vectorized shift does. Before C++20 the shift of a negative value is implementation defined.
+    static_assert((-1 >> 1) == -1 && (-3 >> 1) == -2 && (-int64_t{257} >> FIXED_POINT_SHIFT) == -2,
+                  "The fixed point rounding requires an arithmetic right shift of negative values!");
+
+    /**
+     *
+     * Combines rows of fixed point sums with the given weights, rounds the weighted sum to the nearest integer by
+     * sum = (sum(weights[k] * rows[k]) + 2^(FIXED_POINT_SHIFT - 1)) >> FIXED_POINT_SHIFT, and writes the sum to the
+     * target with the given accumulation and saturation. The rounding does not depend on the accumulation, so an
+     * expansion added while decoding is exactly the expansion subtracted while encoding.
+     * Rows of short or int sums with CV_8U or CV_16S bases and targets are vectorized. Short rows are multiplied in
+     * 16 bit lanes and summed pairwise into 32 bit lanes, the weighted sum of the rows needs more than 16 bits.
+     *
+     * @tparam A The type of the sums in the rows. Short sums are weighted in int.
+     * @tparam B The type of the base row.
+     * @tparam D The type of the target row.
+     * @param rows The rows to combine.
+     * @param weights The fixed point weight of each row.
+     * @param count The amount of rows and weights.
+     * @param accumulation How the sum is written to the target.
+     * @param base The row the sum is added to or subtracted from. Unused for #Accumulation::STORE.
+     * @param target The target row. May be the same as the base row.
+     * @param cols The length of the rows.
+     */
+    template<class A, class B, class D>
+    void combineFixedPointRows(const A* const* rows,
+                               const int* weights,
+                               int count,
+                               Accumulation accumulation,
+                               const B* base,
+                               D* target,
+                               int cols) {
+
+        using Sum = std::common_type_t<A, int>;
+        const Sum half = Sum{1} << (FIXED_POINT_SHIFT - 1);
+        int j = 0;
+
+#if CV_SIMD
+        constexpr bool vectorized = (std::is_same<A, int>::value || std::is_same<A, short>::value) &&
+                                    (std::is_same<B, short>::value || std::is_same<B, uchar>::value) &&
+                                    (std::is_same<D, short>::value || std::is_same<D, uchar>::value);
+        if constexpr (vectorized) {
+
+            const int lanes = cv::v_int32::nlanes;
+            const cv::v_int32 vhalf = cv::vx_setall_s32(half);
+
+            for (; j + 2 * lanes <= cols; j += 2 * lanes) {
+
+                cv::v_int32 low = vhalf;
+                cv::v_int32 high = vhalf;
+                if constexpr (std::is_same<A, short>::value) {
+
+                    // Two rows are interleaved, so every 32 bit lane holds a column of both rows and the dot
+                    // product with the interleaved pair of weights sums both products. An odd row is paired with
+                    // itself and a zero weight.
+                    for (int k = 0; k < count; k += 2) {
+                        const int second = k + 1 < count ? k + 1 : k;
+                        const int pair = (k + 1 < count ? weights[k + 1] : 0) * (1 << 16) + (weights[k] & 0xffff);
+                        const cv::v_int16 weight = cv::v_reinterpret_as_s16(cv::vx_setall_s32(pair));
+                        cv::v_int16 first, next;
+                        cv::v_zip(cv::vx_load(rows[k] + j), cv::vx_load(rows[second] + j), first, next);
+                        low += cv::v_dotprod(first, weight);
+                        high += cv::v_dotprod(next, weight);
+                    }
+                } else {
+                    for (int k = 0; k < count; k++) {
+                        const cv::v_int32 weight = cv::vx_setall_s32(weights[k]);
+                        low += weight * cv::vx_load(rows[k] + j);
+                        high += weight * cv::vx_load(rows[k] + j + lanes);
+                    }
+                }
+                low = low >> FIXED_POINT_SHIFT;
+                high = high >> FIXED_POINT_SHIFT;
+
+                if (accumulation != Accumulation::STORE) {
+                    cv::v_int32 baseLow, baseHigh;
+                    if constexpr (std::is_same<B, uchar>::value) {
+                        cv::v_expand(cv::v_reinterpret_as_s16(cv::vx_load_expand(base + j)), baseLow, baseHigh);
+                    } else {
+                        cv::v_expand(cv::vx_load(base + j), baseLow, baseHigh);
+                    }
+                    low = accumulation == Accumulation::ADD ? baseLow + low : baseLow - low;
+                    high = accumulation == Accumulation::ADD ? baseHigh + high : baseHigh - high;
+                }
+
+                if constexpr (std::is_same<D, uchar>::value) {
+                    cv::v_pack_u_store(target + j, cv::v_pack(low, high));
+                } else {
+                    cv::v_store(target + j, cv::v_pack(low, high));
+                }
+            }
+            cv::vx_cleanup();
+        }
+#endif
+
+        for (; j < cols; j++) {
+
+            Sum sum = half;
+            for (int k = 0; k < count; k++) {
+                sum += static_cast<Sum>(weights[k]) * rows[k][j];
+            }
+            sum >>= FIXED_POINT_SHIFT;
+
+            if (accumulation == Accumulation::ADD) {
+                sum = static_cast<Sum>(base[j]) + sum;
+            } else if (accumulation == Accumulation::SUBTRACT) {
+                sum = static_cast<Sum>(base[j]) - sum;
+            }
+            target[j] = cv::saturate_cast<D>(sum);
+        }
+    }
+}
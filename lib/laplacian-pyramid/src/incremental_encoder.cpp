@@ -0,0 +1,206 @@
+#include <laplacian-pyramid/incremental_encoder.hpp>
+#include "pyramid_geometry.hpp"
+#include <algorithm>
+#include <cstring>
+
+laplacian::IncrementalEncoder::IncrementalEncoder(const cv::Mat& frame,
+                                                  uint8_t compressions,
+                                                  float quantization,
+                                                  std::shared_ptr<Executor> executor) :
+        _geometry(std::make_shared<PyramidGeometry>(frame.size(), compressions)),
+        _pyramid(std::vector<cv::Mat>(), _geometry->decodedSize(), LaplacianPyramid::kernel(), quantization,
+                 std::move(executor)),
+        _gaussians(_geometry->levels()) {
+
+    const PyramidGeometry& geometry = *_geometry;
+
+    // The gaussians are kept for the next frame. So the first gaussian is a copy of the frame and the top plane is
+    // a copy of the top gaussian, which the quantization does not touch.
+    const cv::Mat image = _pyramid.applyValidScaling(frame, geometry).clone();
+    _pyramid.reduceToGaussians(image, _pyramid._kernel, geometry, _gaussians);
+
+    std::vector<cv::Mat> planes(geometry.levels());
+    _pyramid.buildLaplacianPlanes(_gaussians, _pyramid._kernel, planes);
+    planes.back() = _gaussians.back().clone();
+
+    if (quantization != 0) {
+        _pyramid.quantize(planes, quantization);
+    }
+    _pyramid._laplacianPlanesQuantized = std::move(planes);
+}
+
+laplacian::IncrementalEncoder::~IncrementalEncoder() = default;
+
+void laplacian::IncrementalEncoder::update(const cv::Mat& frame) {
+
+    const cv::Mat image = _pyramid.applyValidScaling(frame, *_geometry);
+    const cv::Mat& last = _gaussians.front();
+    if (image.type() != last.type()) {
+        throw LaplacianPyramidException{"The frame does not have the type of the first frame!"};
+    }
+
+    // Neighbouring changed tiles of a row of tiles are joined to one rectangle.
+    std::vector<cv::Rect> dirty;
+    const size_t pixelBytes = image.elemSize();
+    const int tiles = (image.cols + COMPARE_TILE_SIZE - 1) / COMPARE_TILE_SIZE;
+
+    for (int y = 0; y < image.rows; y += COMPARE_TILE_SIZE) {
+
+        const int rows = std::min(COMPARE_TILE_SIZE, image.rows - y);
+        int runBegin = -1;
+
+        for (int tile = 0; tile <= tiles; tile++) {
+
+            const int x = tile * COMPARE_TILE_SIZE;
+            bool changed = false;
+            if (tile < tiles) {
+
+                const size_t bytes = std::min(COMPARE_TILE_SIZE, image.cols - x) * pixelBytes;
+                for (int i = y; i < y + rows && !changed; i++) {
+                    changed = std::memcmp(image.ptr(i) + x * pixelBytes, last.ptr(i) + x * pixelBytes, bytes) != 0;
+                }
+            }
+
+            if (changed && runBegin < 0) {
+                runBegin = x;
+            } else if (!changed && runBegin >= 0) {
+                dirty.emplace_back(runBegin, y, std::min(x, image.cols) - runBegin, rows);
+                runBegin = -1;
+            }
+        }
+    }
+
+    update(frame, dirty);
+}
+
+void laplacian::IncrementalEncoder::update(const cv::Mat& frame, const std::vector<cv::Rect>& dirty) {
+
+    const cv::Mat image = _pyramid.applyValidScaling(frame, *_geometry);
+    if (image.type() != _gaussians.front().type()) {
+        throw LaplacianPyramidException{"The frame does not have the type of the first frame!"};
+    }
+
+    const uint8_t levels = _geometry->levels();
+    std::vector<std::vector<cv::Rect>> changed(levels);
+
+    const cv::Rect bounds(cv::Point(), image.size());
+    for (const cv::Rect& rectangle : dirty) {
+
+        const cv::Rect window = rectangle & bounds;
+        if (!window.empty()) {
+            image(window).copyTo(_gaussians.front()(window));
+            changed.front().push_back(window);
+        }
+    }
+
+    // A level is complete before the level above is reduced from it.
+    for (uint8_t level = 1; level < levels; level++) {
+
+        for (const cv::Rect& window : changed.at(level - 1)) {
+
+            const cv::Rect reduced = reducedWindow(window, _geometry->levelSize(level));
+            if (!reduced.empty()) {
+                changed.at(level).push_back(reduced);
+            }
+        }
+
+        for (const cv::Rect& window : changed.at(level)) {
+            reduceWindow(level, window);
+        }
+    }
+
+    for (uint8_t level = 0; level < levels; level++) {
+
+        std::vector<cv::Rect> windows = changed.at(level);
+        if (level + 1 < levels) {
+            for (const cv::Rect& window : changed.at(level + 1)) {
+                windows.push_back(expandedWindow(window, _geometry->levelSize(level + 1), _geometry->levelSize(level)));
+            }
+        }
+
+        for (const cv::Rect& window : windows) {
+            planeWindow(level, window);
+        }
+    }
+}
+
+const laplacian::LaplacianPyramid& laplacian::IncrementalEncoder::pyramid() const {
+
+    return _pyramid;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::IncrementalEncoder::reduceWindow(uint8_t level, const cv::Rect& window) {
+
+    const cv::Mat& source = _gaussians.at(level - 1);
+
+    // A reduced pixel j needs the source pixels 2j - 2 to 2j + 2. The source window is reduced like a whole image
+    // from twice the pixel in front of the window, so only that first pixel differs from the full reduction.
+    const cv::Point origin(std::max(0, window.x - 1), std::max(0, window.y - 1));
+    const cv::Point sourceEnd(std::min(source.cols, 2 * window.br().x + 1),
+                              std::min(source.rows, 2 * window.br().y + 1));
+
+    cv::Mat reduced;
+    _pyramid.reduceGaussian(source(cv::Rect(origin * 2, sourceEnd)), _pyramid._kernel, window.br().y - origin.y,
+                            window.br().x - origin.x, reduced);
+    reduced(window - origin).copyTo(_gaussians.at(level)(window));
+}
+
+void laplacian::IncrementalEncoder::planeWindow(uint8_t level, const cv::Rect& window) {
+
+    const uint8_t levels = _geometry->levels();
+    cv::Mat plane = _pyramid._laplacianPlanesQuantized.at(level)(window);
+
+    if (level + 1 == levels) {
+
+        _gaussians.at(level)(window).copyTo(plane);
+
+    } else {
+
+        // Like the region decoding, the window of the level above is expanded from twice its origin.
+        const cv::Rect source = LaplacianPyramid::sourceWindow(window, _geometry->levelSize(level + 1));
+        const cv::Point origin = source.tl() * 2;
+
+        cv::Mat difference;
+        _pyramid.upsampleAndSubtract(_gaussians.at(level + 1)(source),
+                                     _gaussians.at(level)(cv::Rect(origin, window.br())),
+                                     _pyramid._kernel,
+                                     difference);
+        difference(window - origin).copyTo(plane);
+    }
+
+    const float step = LaplacianPyramid::quantizationStep(_pyramid._quantization, level, levels, plane.type());
+    if (step > 0.0f) {
+        LaplacianPyramid::quantizePlane(plane, step);
+    }
+}
+
+cv::Rect laplacian::IncrementalEncoder::reducedWindow(const cv::Rect& window, cv::Size size) {
+
+    // The pixel j is reduced from the pixels 2j - 2 to 2j + 2.
+    const int left = std::max(0, (window.x - 1) >> 1);
+    const int top = std::max(0, (window.y - 1) >> 1);
+    const int right = std::min(size.width, ((window.br().x + 1) >> 1) + 1);
+    const int bottom = std::min(size.height, ((window.br().y + 1) >> 1) + 1);
+
+    if (left >= right || top >= bottom) {
+        return {};
+    }
+    return {left, top, right - left, bottom - top};
+}
+
+cv::Rect laplacian::IncrementalEncoder::expandedWindow(const cv::Rect& window, cv::Size sourceSize, cv::Size size) {
+
+    // The pixels 2q and 2q + 1 are expanded from the source pixels q - 1 to q + 1, and every pixel behind the
+    // source from its last pixel.
+    const int left = std::max(0, window.x - 1) << 1;
+    const int top = std::max(0, window.y - 1) << 1;
+    const int right = window.br().x == sourceSize.width ? size.width
+                                                        : std::min(size.width, (window.br().x << 1) + 2);
+    const int bottom = window.br().y == sourceSize.height ? size.height
+                                                          : std::min(size.height, (window.br().y << 1) + 2);
+    return {left, top, right - left, bottom - top};
+}
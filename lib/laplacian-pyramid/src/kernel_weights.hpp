@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef LAPLACIAN_PYRAMID_ISA
+#error "The kernel weights are instantiated per instruction set, see simd_kernels.hpp."
+#endif
+
+namespace laplacian::kernels {
+
+    // The instantiations of every instruction set are distinct, so the linker cannot mix them up.
+    inline namespace LAPLACIAN_PYRAMID_ISA {
+
+        /**
+         *
+         * The weights of the generating kernel "w" for a = NUMERATOR / DENOMINATOR, multiplied by SCALE, as compile
+         * time constants. The row loops instantiated with them fold the weights into the instructions.
+         * The weights are computed like #laplacian::LaplacianPyramid::kernel does, so they are bitwise equal to the
+         * weights of that kernel and give bitwise equal results.
+         *
+         * @tparam NUMERATOR The numerator of "a".
+         * @tparam DENOMINATOR The denominator of "a".
+         * @tparam SCALE The factor of the weights, 2 for the expansion.
+         */
+        template<int NUMERATOR, int DENOMINATOR, int SCALE>
+        struct ConstantWeights {
+            static constexpr float A = static_cast<float>(NUMERATOR) / static_cast<float>(DENOMINATOR);
+            static constexpr float taps[5] = {SCALE * (0.25f - A / 2.0f), SCALE * 0.25f, SCALE * A, SCALE * 0.25f,
+                                              SCALE * (0.25f - A / 2.0f)};
+        };
+
+        /**
+         *
+         * The weights of an arbitrary generating kernel, read at runtime. The fallback of #withWeights.
+         */
+        struct RuntimeWeights {
+            float taps[5];
+        };
+
+        /**
+         *
+         * Checks whether the given weights are the compile time weights W.
+         *
+         * @tparam W The compile time weights.
+         * @param weights The 5 weights.
+         *
+         * @return True if all weights are bitwise equal.
+         */
+        template<class W>
+        bool matches(const float* weights) {
+
+            for (int tap = 0; tap < 5; tap++) {
+                if (W::taps[tap] != weights[tap]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         *
+         * Calls the given body with the compile time weights equal to the given weights, which are the default
+         * a = 1 and the common a = 0.375 and a = 0.4, or with #RuntimeWeights for any other kernel.
+         *
+         * @tparam SCALE The factor the given weights are multiplied by.
+         * @tparam Body A callable taking the weights, which is instantiated for every kind of weights.
+         * @param weights The 5 weights.
+         * @param body The body to call.
+         */
+        template<int SCALE, class Body>
+        void withWeights(const float* weights, const Body& body) {
+
+            using Default = ConstantWeights<1, 1, SCALE>;
+            using Binomial = ConstantWeights<3, 8, SCALE>;
+            using Gaussian = ConstantWeights<2, 5, SCALE>;
+
+            if (matches<Default>(weights)) {
+                body(Default{});
+            } else if (matches<Binomial>(weights)) {
+                body(Binomial{});
+            } else if (matches<Gaussian>(weights)) {
+                body(Gaussian{});
+            } else {
+                body(RuntimeWeights{{weights[0], weights[1], weights[2], weights[3], weights[4]}});
+            }
+        }
+    }
+}
@@ -1,5 +1,38 @@
 #include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include "cpu_dispatch.hpp"
+#include "expand_engine.hpp"
+#include "fixed_expand_engine.hpp"
+#include "fixed_reduce_engine.hpp"
+#include "plane_codec.hpp"
+#include "pyramid_geometry.hpp"
+#include "pyramid_types.hpp"
+#include "reduce_cascade.hpp"
+#include "reduce_engine.hpp"
+#include "sparse_plane.hpp"
+#include "stage_timer.hpp"
+#include "tiled_storage.hpp"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+struct laplacian::LaplacianPyramid::LazyLevels {
+
+    LazyLevels(cv::Mat image, const PyramidGeometry& geometry) :
+            geometry(geometry), gaussians(geometry.levels()), planes(geometry.levels()), mutex() {
+        gaussians.front() = std::move(image);
+    }
+
+    const PyramidGeometry geometry;
+
+    /**
+     * The gaussians reduced so far, level 0 is the scaled image.
+     */
+    std::vector<cv::Mat> gaussians;
+    std::vector<cv::Mat> planes;
+    std::mutex mutex;
+};
 
 laplacian::LaplacianPyramidException::LaplacianPyramidException(const std::string& message) :
     std::exception(message.c_str()) {
@@ -7,40 +40,328 @@ laplacian::LaplacianPyramidException::LaplacianPyramidException(const std::strin
 
 laplacian::LaplacianPyramid::LaplacianPyramid(const cv::Mat& image,
                                               uint8_t compressions,
-                                              float quantization) :
+                                              float quantization,
+                                              std::shared_ptr<Executor> executor,
+                                              std::shared_ptr<Profiler> profiler) :
+                                              LaplacianPyramid(image, compressions, Scaling::CROP, quantization,
+                                                               std::move(executor), std::move(profiler)) {
+}
+
+laplacian::LaplacianPyramid::LaplacianPyramid(const cv::Mat& image,
+                                              uint8_t compressions,
+                                              Scaling scaling,
+                                              float quantization,
+                                              std::shared_ptr<Executor> executor,
+                                              std::shared_ptr<Profiler> profiler) :
+                                              _laplacianPlanesQuantized(),
+                                              _imageSize(),
+                                              _kernel(kernel()),
+                                              _quantization(quantization),
+                                              _steps(),
+                                              _executor(std::move(executor)),
+                                              _profiler(std::move(profiler)),
+                                              _precision(Precision::FULL),
+                                              _storage(),
+                                              _sparsePlanes(),
+                                              _lazy() {
+
+    const PyramidGeometry geometry{image.size(), compressions, scaling};
+    std::vector<cv::Mat> gaussians(geometry.levels());
+    std::vector<cv::Mat> planes(geometry.levels());
+    encode(image, geometry, gaussians, planes, true);
+}
+
+laplacian::LaplacianPyramid::LaplacianPyramid(const cv::Mat& image,
+                                              PyramidWorkspace& workspace,
+                                              float quantization,
+                                              std::shared_ptr<Executor> executor,
+                                              std::shared_ptr<Profiler> profiler) :
                                               _laplacianPlanesQuantized(),
-                                              _kernel(kernel()){
+                                              _imageSize(),
+                                              _kernel(kernel()),
+                                              _quantization(quantization),
+                                              _steps(),
+                                              _executor(std::move(executor)),
+                                              _profiler(std::move(profiler)),
+                                              _precision(Precision::FULL),
+                                              _storage(),
+                                              _sparsePlanes(),
+                                              _lazy() {
+
+    encode(image, workspace);
+}
+
+void laplacian::LaplacianPyramid::encode(const cv::Mat& image, PyramidWorkspace& workspace) {
 
-    const auto scaledImage = applyValidScaling(image, compressions);
-    const auto gaussians = reduceToGaussians(scaledImage, _kernel, compressions);
-    const auto upsampledGaussians = upsample(gaussians, _kernel);
-    const auto laplacianPlanes = buildLaplacianPlanes(gaussians, upsampledGaussians);
-    _laplacianPlanesQuantized = quantization == 0 ? laplacianPlanes : quantize(laplacianPlanes, quantization);
+    if (image.type() != workspace.type()) {
+        throw LaplacianPyramidException{"The image does not have the type the workspace is made for!"};
+    }
+
+    encode(image, *workspace._geometry, workspace._gaussians, workspace._planes, false);
+
+    // Level 0 is the image itself, which is not kept alive by the workspace, or the padded image of the workspace.
+    if (!workspace._geometry->pads()) {
+        workspace._gaussians.front().release();
+    }
 }
 
 cv::Mat laplacian::LaplacianPyramid::decode() const {
 
-    cv::Mat reconstructed = _laplacianPlanesQuantized.at(levels() - 1);
+    std::vector<cv::Mat> reconstructed(levels());
+    return cutToImage(reconstruct(reconstructed));
+}
 
-    for (int level = levels() - 2; level >= 0; level--) {
+cv::Mat laplacian::LaplacianPyramid::decode(PyramidWorkspace& workspace) const {
+
+    if (workspace.levels() != levels() || workspace._geometry->scaledSize() != levelSize(0) ||
+        types::planeType(workspace.type()) != planeType()) {
+        throw LaplacianPyramidException{"The workspace is not made for the size and the type of the pyramid!"};
+    }
+
+    return cutToImage(reconstruct(workspace._reconstructed));
+}
+
+cv::Mat laplacian::LaplacianPyramid::decode(uint8_t level) const {
+
+    if (level >= levels()) {
+        throw LaplacianPyramidException{"The pyramid does not have the level!"};
+    }
+
+    return decode(cv::Rect(cv::Point(), level == 0 ? imageSize() : levelSize(level)), level);
+}
+
+cv::Mat laplacian::LaplacianPyramid::decode(const cv::Rect& region, uint8_t level) const {
+
+    if (level >= levels()) {
+        throw LaplacianPyramidException{"The pyramid does not have the level!"};
+    }
+
+    const cv::Rect bounds(cv::Point(), levelSize(level));
+    if (region.empty() || (region & bounds) != region) {
+        throw LaplacianPyramidException{"The region does not lie inside the level!"};
+    }
+
+    const uint8_t top = levels() - 1;
+    std::vector<cv::Rect> windows(levels());
+    windows.at(level) = region;
+    for (uint8_t above = level + 1; above <= top; above++) {
+        windows.at(above) = sourceWindow(windows.at(above - 1), levelSize(above));
+    }
+
+    cv::Mat upper = at(top, windows.at(top));
+
+    for (int current = top - 1; current >= level; current--) {
+
+        // The expansion of the window above starts at twice its origin. Expanding the window like a whole image
+        // only differs from the full expansion at its left and upper margin, which is cut off.
+        const cv::Rect& window = windows.at(current);
+        const cv::Point origin = windows.at(current + 1).tl() * 2;
+        const cv::Rect expanded(origin, window.br());
+
+        const cv::Mat plane = at(current, expanded);
+        const int type = current == level ? types::imageType(planeType()) : planeType();
+        cv::Mat sum;
+        const size_t allocated = StageTimer::allocation(sum, plane.size(), type);
+        StageTimer timer{_profiler.get(), Stage::RECONSTRUCT, static_cast<uint8_t>(current)};
+        upsampleAndAdd(upper, plane, _kernel, type, sum);
+        timer.stop(allocated, plane.total());
+        upper = sum(window - origin);
+    }
+
+    const int type = types::imageType(planeType());
+    if (upper.type() != type) {
+        cv::Mat converted;
+        upper.convertTo(converted, type);
+        return converted;
+    }
+    return upper;
+}
+
+void laplacian::LaplacianPyramid::serialize(std::ostream& stream) const {
+
+    stream.write(MAGIC, sizeof(MAGIC));
+    PlaneCodec::writeValue<uint8_t>(stream, FORMAT_VERSION);
+    PlaneCodec::writeValue<uint8_t>(stream, levels());
+    PlaneCodec::writeValue<float>(stream, _kernel.at<float>(2));
+    PlaneCodec::writeValue<float>(stream, _quantization);
+    PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(_imageSize.height));
+    PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(_imageSize.width));
+
+    for (uint8_t level = 0; level < levels(); level++) {
+
+        const cv::Mat plane = fullPrecision(at(level));
+        PlaneCodec::write(stream, plane, levelStep(level));
+    }
+
+    if (!stream) {
+        throw LaplacianPyramidException{"The pyramid could not be written to the stream!"};
+    }
+}
+
+laplacian::LaplacianPyramid laplacian::LaplacianPyramid::deserialize(std::istream& stream,
+                                                                     std::shared_ptr<Executor> executor) {
+
+    char magic[sizeof(MAGIC)];
+    stream.read(magic, sizeof(magic));
+    if (stream.gcount() != sizeof(magic) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw LaplacianPyramidException{"The stream does not hold a laplacian pyramid!"};
+    }
+
+    const auto version = PlaneCodec::readValue<uint8_t>(stream);
+    if (version == 0 || version > FORMAT_VERSION) {
+        throw LaplacianPyramidException{"The stream holds an unknown version of the format!"};
+    }
+
+    const auto levels = PlaneCodec::readValue<uint8_t>(stream);
+    const auto a = PlaneCodec::readValue<float>(stream);
+    const auto quantization = PlaneCodec::readValue<float>(stream);
+
+    // The first version has no image size, its pyramids decode to the size of level 0.
+    const auto imageRows = version > 1 ? PlaneCodec::readValue<uint32_t>(stream) : 0u;
+    const auto imageCols = version > 1 ? PlaneCodec::readValue<uint32_t>(stream) : 0u;
+
+    if (levels == 0 || !std::isfinite(a) || !(std::isfinite(quantization) && quantization >= 0.0f)) {
+        throw LaplacianPyramidException{"The stream holds an invalid pyramid!"};
+    }
 
-        const auto& laplacian = _laplacianPlanesQuantized.at(level);
-        const auto upsampled = upsample(reconstructed, laplacian.rows, laplacian.cols, _kernel);
+    std::vector<cv::Mat> planes;
+    std::vector<float> steps(levels);
+    for (uint8_t level = 0; level < levels; level++) {
+        planes.push_back(PlaneCodec::read(stream, &steps.at(level)));
+    }
+
+    std::vector<cv::Size> sizes;
+    std::vector<int> planeTypes;
+    for (const cv::Mat& plane : planes) {
+        sizes.push_back(plane.size());
+        planeTypes.push_back(plane.type());
+    }
+
+    if (!formsPyramid(sizes, planeTypes)) {
+        throw LaplacianPyramidException{"The stream holds planes which do not form a pyramid!"};
+    }
+
+    const cv::Size imageSize = version > 1 ? cv::Size(static_cast<int>(imageCols), static_cast<int>(imageRows))
+                                           : sizes.front();
+    if (!fitsInto(imageSize, sizes.front())) {
+        throw LaplacianPyramidException{"The stream holds an invalid image size!"};
+    }
+
+    // Quantized planes are held sparse like the planes of an encoding.
+    LaplacianPyramid pyramid{planes, imageSize, kernel(a), quantization, std::move(executor)};
+    pyramid.keepSteps(steps);
+    pyramid.storePlanes(planes, true);
+    return pyramid;
+}
+
+void laplacian::LaplacianPyramid::save(const std::string& path, int tileSize) const {
+
+    std::vector<cv::Mat> planes;
+    for (uint8_t level = 0; level < levels(); level++) {
+        planes.push_back(fullPrecision(at(level)));
+    }
+
+    TiledStorage::write(path, planes, _imageSize, _kernel.at<float>(2), _quantization, quantizationSteps(),
+                        tileSize);
+}
+
+laplacian::LaplacianPyramid laplacian::LaplacianPyramid::lazy(const cv::Mat& image,
+                                                              uint8_t compressions,
+                                                              Scaling scaling,
+                                                              float quantization,
+                                                              std::shared_ptr<Executor> executor) {
+
+    const PyramidGeometry geometry{image.size(), compressions, scaling};
 
-        reconstructed = laplacian + upsampled;
+    // The planes stay empty until they are computed, see #at.
+    LaplacianPyramid pyramid{std::vector<cv::Mat>(geometry.levels()), geometry.decodedSize(), kernel(), quantization,
+                             std::move(executor)};
+    pyramid._lazy = std::make_shared<LazyLevels>(pyramid.applyValidScaling(image, geometry), geometry);
+    return pyramid;
+}
+
+laplacian::LaplacianPyramid laplacian::LaplacianPyramid::open(const std::string& path,
+                                                              std::shared_ptr<Executor> executor) {
+
+    auto storage = std::make_shared<const TiledStorage>(path);
+
+    std::vector<cv::Size> sizes;
+    std::vector<int> planeTypes;
+    for (uint8_t level = 0; level < storage->levels(); level++) {
+        sizes.push_back(storage->levelSize(level));
+        planeTypes.push_back(storage->type(level));
+    }
+
+    if (!formsPyramid(sizes, planeTypes)) {
+        throw LaplacianPyramidException{"The file holds planes which do not form a pyramid!"};
+    }
+
+    if (!fitsInto(storage->imageSize(), sizes.front())) {
+        throw LaplacianPyramidException{"The file holds an invalid image size!"};
     }
 
-    return reconstructed;
+    // The planes stay empty until they are read, see #at.
+    LaplacianPyramid pyramid{std::vector<cv::Mat>(storage->levels()), storage->imageSize(), kernel(storage->a()),
+                             storage->quantization(), std::move(executor)};
+
+    pyramid._storage = std::move(storage);
+
+    // Files of the versions without steps follow the quantization.
+    const std::vector<float> steps = pyramid._storage->steps();
+    if (!steps.empty()) {
+        pyramid.keepSteps(steps);
+    }
+    return pyramid;
 }
 
 cv::Mat laplacian::LaplacianPyramid::at(uint8_t level) const {
 
-    return _laplacianPlanesQuantized.at(level);
+    if (const SparsePlane* sparse = sparsePlane(level)) {
+        return sparse->region(cv::Rect(cv::Point(), sparse->size()));
+    }
+
+    const cv::Mat& plane = _laplacianPlanesQuantized.at(level);
+    if (plane.empty() && _storage) {
+        return _storage->level(level);
+    }
+    if (plane.empty() && _lazy) {
+        return lazyLevel(level);
+    }
+    return plane;
+}
+
+cv::Mat laplacian::LaplacianPyramid::at(uint8_t level, const cv::Rect& region) const {
+
+    const cv::Mat& plane = _laplacianPlanesQuantized.at(level);
+    if (plane.empty() && _storage && !sparsePlane(level)) {
+        return _storage->region(level, region);
+    }
+
+    if (region.empty() || (region & cv::Rect(cv::Point(), levelSize(level))) != region) {
+        throw LaplacianPyramidException{"The region does not lie inside the level!"};
+    }
+
+    if (const SparsePlane* sparse = sparsePlane(level)) {
+        return sparse->region(region);
+    }
+    if (plane.empty() && _lazy) {
+        return lazyLevel(level)(region);
+    }
+    return plane(region);
 }
 
 cv::Mat& laplacian::LaplacianPyramid::at(uint8_t level) {
 
-    return _laplacianPlanesQuantized.at(level);
+    cv::Mat& plane = _laplacianPlanesQuantized.at(level);
+    if (const SparsePlane* sparse = sparsePlane(level)) {
+        plane = sparse->region(cv::Rect(cv::Point(), sparse->size()));
+        _sparsePlanes.at(level) = nullptr;
+    } else if (plane.empty() && _storage) {
+        plane = _storage->level(level);
+    } else if (plane.empty() && _lazy) {
+        plane = lazyLevel(level);
+    }
+    return plane;
 }
 
 cv::Mat laplacian::LaplacianPyramid::operator[](uint8_t level) const {
@@ -58,37 +379,280 @@ uint8_t laplacian::LaplacianPyramid::levels() const {
     return _laplacianPlanesQuantized.size();
 }
 
+cv::Size laplacian::LaplacianPyramid::imageSize() const {
+
+    return _imageSize;
+}
+
+int laplacian::LaplacianPyramid::tileSize() const {
+
+    return _storage ? _storage->tileSize() : 0;
+}
+
+void laplacian::LaplacianPyramid::setProfiler(std::shared_ptr<Profiler> profiler) {
+
+    _profiler = std::move(profiler);
+}
+
+std::shared_ptr<laplacian::Profiler> laplacian::LaplacianPyramid::profiler() const {
+
+    return _profiler;
+}
+
+void laplacian::LaplacianPyramid::setPrecision(Precision precision) {
+
+    _precision = precision;
+
+    std::vector<cv::Mat> planes;
+    for (uint8_t level = 0; level < levels(); level++) {
+        planes.push_back(fullPrecision(at(level)));
+    }
+    storePlanes(planes, true);
+}
+
+laplacian::Precision laplacian::LaplacianPyramid::precision() const {
+
+    return _precision;
+}
+
+std::vector<float> laplacian::LaplacianPyramid::quantizationSteps() const {
+
+    std::vector<float> steps;
+    for (uint8_t level = 0; level < levels(); level++) {
+        steps.push_back(levelStep(level));
+    }
+    return steps;
+}
+
 ////////////////////////////////////////
 // PRIVATE
 ////////////////////////////////////////
 
-cv::Mat laplacian::LaplacianPyramid::applyValidScaling(const cv::Mat& image, uint8_t compressions) const {
+laplacian::LaplacianPyramid::LaplacianPyramid(std::vector<cv::Mat> planes,
+                                              cv::Size imageSize,
+                                              cv::Mat kernel,
+                                              float quantization,
+                                              std::shared_ptr<Executor> executor) :
+                                              _laplacianPlanesQuantized(std::move(planes)),
+                                              _imageSize(imageSize),
+                                              _kernel(std::move(kernel)),
+                                              _quantization(quantization),
+                                              _steps(),
+                                              _executor(std::move(executor)),
+                                              _profiler(),
+                                              _precision(Precision::FULL),
+                                              _storage(),
+                                              _sparsePlanes(),
+                                              _lazy() {
+}
+
+template<class Body>
+void laplacian::LaplacianPyramid::forEachRowBand(int rows, const Body& body) const {
+
+    const int bands = _executor ? std::min(_executor->concurrency(), rows / MIN_ROWS_PER_BAND) : 1;
+
+    if (bands <= 1) {
+        body(0, rows);
+        return;
+    }
+
+    _executor->parallelFor(bands, [rows, bands, &body](int band) {
+        body(rows * band / bands, rows * (band + 1) / bands);
+    });
+}
+
+void laplacian::LaplacianPyramid::encode(const cv::Mat& image,
+                                         const PyramidGeometry& geometry,
+                                         std::vector<cv::Mat>& gaussians,
+                                         std::vector<cv::Mat>& planes,
+                                         bool sparse) {
 
-    cv::Mat validScaling = image;
-    bool widthValid = isValidScaling(validScaling.cols, compressions);
-    bool heightValid = isValidScaling(validScaling.rows, compressions);
+    // A padded image is copied into level 0 of the gaussians, a cropped image is a view of the image.
+    const size_t allocated = geometry.pads() ? StageTimer::allocation(gaussians.at(0), geometry.scaledSize(),
+                                                                      image.type()) : 0;
+    StageTimer scaling{_profiler.get(), Stage::VALID_SCALING, 0};
+    applyValidScaling(image, geometry, gaussians.at(0));
+    scaling.stop(allocated, gaussians.at(0).total());
 
-    while(!widthValid || !heightValid) {
+    reduceToGaussians(gaussians.at(0), _kernel, geometry, gaussians);
+    buildLaplacianPlanes(gaussians, _kernel, planes);
 
-        if (validScaling.rows <= 1 || validScaling.cols <= 1) {
-            throw LaplacianPyramidException{"The expected scaling cannot be applied because the original image is too small!"};
+    if (_quantization != 0) {
+
+        // The planes are quantized in place. With a single level the plane is the image itself.
+        if (planes.size() == 1) {
+            planes.front() = planes.front().clone();
         }
+        quantize(planes, _quantization);
+    }
+    storePlanes(planes, sparse);
+    _steps.clear();
+    _imageSize = geometry.decodedSize();
+    _storage = nullptr;
+}
+
+cv::Mat laplacian::LaplacianPyramid::reconstruct(std::vector<cv::Mat>& reconstructed) const {
+
+    cv::Mat upper = at(levels() - 1);
+
+    for (int level = levels() - 2; level >= 0; level--) {
 
-        widthValid = widthValid || isValidScaling((validScaling = removeLastColumn(validScaling)).cols, compressions);
-        heightValid = heightValid || isValidScaling((validScaling = removeLastRow(validScaling)).rows, compressions);
+        const cv::Size size = levelSize(level);
+        const int type = level == 0 ? types::imageType(planeType()) : planeType();
+        const size_t allocated = StageTimer::allocation(reconstructed.at(level), size, type);
+        StageTimer timer{_profiler.get(), Stage::RECONSTRUCT, static_cast<uint8_t>(level)};
+        if (const SparsePlane* sparse = sparsePlane(level)) {
+            upsampleAndAddSparse(upper, *sparse, _kernel, type, reconstructed.at(level));
+        } else {
+            upsampleAndAdd(upper, at(level), _kernel, type, reconstructed.at(level));
+        }
+        timer.stop(allocated, size.area());
+        upper = reconstructed.at(level);
     }
 
-    return validScaling;
+    return upper;
 }
 
-cv::Mat laplacian::LaplacianPyramid::removeLastColumn(const cv::Mat& image) const {
+cv::Mat laplacian::LaplacianPyramid::lazyLevel(uint8_t level) const {
+
+    std::lock_guard<std::mutex> lock(_lazy->mutex);
+
+    cv::Mat& plane = _lazy->planes.at(level);
+    if (!plane.empty()) {
+        return plane;
+    }
+
+    // A laplacian plane needs the gaussian of its level and of the level above, the top plane only its gaussian.
+    const uint8_t top = levels() - 1;
+    std::vector<cv::Mat>& gaussians = _lazy->gaussians;
+    for (uint8_t above = 1; above <= std::min<uint8_t>(level + 1, top); above++) {
+
+        cv::Mat& gaussian = gaussians.at(above);
+        if (gaussian.empty()) {
+
+            const cv::Size size = _lazy->geometry.levelSize(above);
+            const size_t allocated = StageTimer::allocation(gaussian, size, planeType());
+            StageTimer timer{_profiler.get(), Stage::REDUCE, above};
+            reduceGaussian(gaussians.at(above - 1), _kernel, size.height, size.width, gaussian);
+            timer.stop(allocated, size.area());
+        }
+    }
+
+    const cv::Mat& gaussian = gaussians.at(level);
+    if (level == top) {
+
+        // The quantization works in place, so it gets a copy of the gaussian.
+        plane = _quantization != 0 ? gaussian.clone() : gaussian;
+    } else {
 
-    return cutImage(image, image.rows, image.cols - 1);
+        const size_t allocated = StageTimer::allocation(plane, gaussian.size(), planeType());
+        StageTimer timer{_profiler.get(), Stage::LAPLACIAN_PLANE, level};
+        upsampleAndSubtract(gaussians.at(level + 1), gaussian, _kernel, plane);
+        timer.stop(allocated, gaussian.total());
+    }
+
+    if (_quantization != 0) {
+        StageTimer timer{_profiler.get(), Stage::QUANTIZE, level};
+        quantizePlane(plane, quantizationStep(_quantization, level, levels(), plane.type()));
+        timer.stop(0, plane.total());
+    }
+    return plane;
 }
 
-cv::Mat laplacian::LaplacianPyramid::removeLastRow(const cv::Mat& image) const {
+cv::Size laplacian::LaplacianPyramid::levelSize(uint8_t level) const {
 
-    return cutImage(image, image.rows - 1, image.cols);
+    if (const SparsePlane* sparse = sparsePlane(level)) {
+        return sparse->size();
+    }
+
+    const cv::Mat& plane = _laplacianPlanesQuantized.at(level);
+    if (plane.empty() && _lazy) {
+        return _lazy->geometry.levelSize(level);
+    }
+    return plane.empty() && _storage ? _storage->levelSize(level) : plane.size();
+}
+
+int laplacian::LaplacianPyramid::planeType() const {
+
+    const cv::Mat& plane = _laplacianPlanesQuantized.back();
+    if (plane.empty() && _lazy) {
+
+        // The top plane of a single level is the image itself.
+        const int imageType = _lazy->gaussians.front().type();
+        return levels() == 1 ? imageType : types::planeType(imageType);
+    }
+    return plane.empty() && _storage ? _storage->type(levels() - 1) : plane.type();
+}
+
+cv::Rect laplacian::LaplacianPyramid::sourceWindow(const cv::Rect& window, cv::Size sourceSize) {
+
+    // Behind the source every tap is clamped to its last pixel.
+    const int left = std::clamp((window.x >> 1) - 1, 0, sourceSize.width - 1);
+    const int top = std::clamp((window.y >> 1) - 1, 0, sourceSize.height - 1);
+    const int right = std::min(sourceSize.width, ((window.br().x - 1) >> 1) + 2);
+    const int bottom = std::min(sourceSize.height, ((window.br().y - 1) >> 1) + 2);
+    return {left, top, right - left, bottom - top};
+}
+
+bool laplacian::LaplacianPyramid::formsPyramid(const std::vector<cv::Size>& sizes, const std::vector<int>& types) {
+
+    // The planes have to have the sizes and the type of a pyramid, otherwise the decoding would be meaningless.
+    const PyramidGeometry geometry{sizes.front(), static_cast<uint8_t>(sizes.size())};
+    for (size_t level = 0; level < sizes.size(); level++) {
+
+        if (sizes.at(level) != geometry.levelSize(level) || types.at(level) != types.front()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool laplacian::LaplacianPyramid::fitsInto(cv::Size imageSize, cv::Size levelSize) {
+
+    return imageSize.width > 0 && imageSize.height > 0 && imageSize.width <= levelSize.width &&
+           imageSize.height <= levelSize.height;
+}
+
+cv::Mat laplacian::LaplacianPyramid::applyValidScaling(const cv::Mat& image, const PyramidGeometry& geometry) const {
+
+    cv::Mat scaled;
+    applyValidScaling(image, geometry, scaled);
+    return scaled;
+}
+
+void laplacian::LaplacianPyramid::applyValidScaling(const cv::Mat& image,
+                                                    const PyramidGeometry& geometry,
+                                                    cv::Mat& scaled) const {
+
+    if (image.size() != geometry.imageSize()) {
+        throw LaplacianPyramidException{"The image does not have the size the pyramid is made for!"};
+    }
+
+    if (!types::isSupported(image.type())) {
+        throw LaplacianPyramidException{"The image has to be CV_32F, CV_8U or CV_16U encoded with up to four channels!"};
+    }
+
+    if (!types::holdsCompressions(image.type(), geometry.levels())) {
+        throw LaplacianPyramidException{"The planes of the image type cannot hold that many compressions!"};
+    }
+
+    const auto scaledSize = geometry.scaledSize();
+    if (!geometry.pads()) {
+        scaled = cutImage(image, scaledSize.height, scaledSize.width);
+        return;
+    }
+
+    // Reflects without repeating the border pixel, so the padding continues the image without a flat seam.
+    cv::copyMakeBorder(image, scaled, 0, scaledSize.height - image.rows, 0, scaledSize.width - image.cols,
+                       cv::BORDER_REFLECT_101);
+}
+
+cv::Mat laplacian::LaplacianPyramid::cutToImage(const cv::Mat& reconstruction) const {
+
+    if (reconstruction.size() == _imageSize) {
+        return reconstruction;
+    }
+    return cutImage(reconstruction, _imageSize.height, _imageSize.width);
 }
 
 cv::Mat laplacian::LaplacianPyramid::cutImage(const cv::Mat& image, int rows, int cols) const {
@@ -97,27 +661,61 @@ cv::Mat laplacian::LaplacianPyramid::cutImage(const cv::Mat& image, int rows, in
     return image(subImage);
 }
 
-bool laplacian::LaplacianPyramid::isValidScaling(int dimension, uint8_t compressions) const {
+void laplacian::LaplacianPyramid::storePlanes(const std::vector<cv::Mat>& planes, bool sparse) {
+
+    const bool half = _precision == Precision::HALF && !planes.empty() && planes.back().depth() == CV_32F;
+    const bool compress = sparse && _quantization != 0;
+    _sparsePlanes.assign(planes.size(), nullptr);
+
+    // The stored planes replace the levels a lazy pyramid computes.
+    _lazy = nullptr;
 
-    // The formula 'C = M_c * 2^N + 1' of the paper "The laplacian pyramid as a Compact Image Code" is wrong.
-    // It should be 'C = M_c * 2^N - 1'. This results in '(C + 1) / 2^N = M_c
-    // Because the indexes in the paper starts with -2, formula is moved by +2.
-    // This results in the final formula '(C + 3) / 2^N = M_c
-    return isInteger((static_cast<float>(dimension) + 3.0f) / static_cast<float>(std::pow(2, compressions)));
+    if (!half && !compress) {
+        _laplacianPlanesQuantized = planes;
+        return;
+    }
+
+    // The planes of the last encoding are overwritten, unless they are the planes to store.
+    _laplacianPlanesQuantized.resize(planes.size());
+    for (size_t level = 0; level + 1 < planes.size(); level++) {
+
+        cv::Mat& plane = _laplacianPlanesQuantized.at(level);
+        if (!half) {
+            plane = planes.at(level);
+        } else {
+            if (plane.data == planes.at(level).data) {
+                plane = cv::Mat();
+            }
+            planes.at(level).convertTo(plane, CV_16F);
+        }
+
+        if (compress) {
+            _sparsePlanes.at(level) = SparsePlane::compress(plane, MAX_SPARSE_OCCUPANCY);
+            if (_sparsePlanes.at(level)) {
+                plane = cv::Mat();
+            }
+        }
+    }
+    _laplacianPlanesQuantized.back() = planes.back();
 }
 
-bool laplacian::LaplacianPyramid::isInteger(float value) const {
+const laplacian::SparsePlane* laplacian::LaplacianPyramid::sparsePlane(uint8_t level) const {
 
-    return isNearlyEqual(std::floor(value), value);
+    return level < _sparsePlanes.size() ? _sparsePlanes.at(level).get() : nullptr;
 }
 
-bool laplacian::LaplacianPyramid::isNearlyEqual(float value1, float value2) const {
+cv::Mat laplacian::LaplacianPyramid::fullPrecision(const cv::Mat& plane) {
+
+    if (plane.depth() != CV_16F) {
+        return plane;
+    }
 
-    static const float epsilon = 1e-5;
-    return std::abs(value1 - value2) <= epsilon * std::abs(value1);
+    cv::Mat converted;
+    plane.convertTo(converted, CV_32F);
+    return converted;
 }
 
-cv::Mat laplacian::LaplacianPyramid::kernel(float a) const {
+cv::Mat laplacian::LaplacianPyramid::kernel(float a) {
     cv::Mat kernel(5, 1, CV_32F);
 
     float zeroAndFour = 0.25f - a / 2.0f;
@@ -127,146 +725,251 @@ cv::Mat laplacian::LaplacianPyramid::kernel(float a) const {
     kernel.at<float>(3,0) = 0.25f;
     kernel.at<float>(4,0) = zeroAndFour;
 
-    cv::Mat transposedKernel;
-    cv::transpose(kernel, transposedKernel);
+    return kernel;
+}
+
+void laplacian::LaplacianPyramid::reduceToGaussians(const cv::Mat& image,
+                                                    const cv::Mat& kernel,
+                                                    const PyramidGeometry& geometry,
+                                                    std::vector<cv::Mat>& gaussians) const {
+
+    gaussians.at(0) = image;
+
+    // A single band is reduced in one cache blocked pass over all levels. Row bands split every level over the
+    // caches of the threads instead.
+    if (!types::isFixedPoint(image.type()) && (!_executor || _executor->concurrency() <= 1)) {
+
+        std::vector<size_t> allocated;
+        std::vector<StageTimer> timers;
+        for (uint8_t level = 1; level < geometry.levels(); level++) {
+
+            const auto size = geometry.levelSize(level);
+            allocated.push_back(StageTimer::allocation(gaussians.at(level), size, image.type()));
+            gaussians.at(level).create(size, image.type());
+            timers.emplace_back(_profiler.get(), Stage::REDUCE, level);
+            timers.back().pause();
+        }
+
+        ReduceCascade{kernel}.apply(gaussians, timers);
+
+        for (uint8_t level = 1; level < geometry.levels(); level++) {
+            timers.at(level - 1).stop(allocated.at(level - 1), geometry.levelSize(level).area());
+        }
+        return;
+    }
+
+    for (uint8_t level = 1; level < geometry.levels(); level++) {
 
-    return kernel * transposedKernel;
+        const auto size = geometry.levelSize(level);
+        const size_t allocated = StageTimer::allocation(gaussians.at(level), size, types::planeType(image.type()));
+        StageTimer timer{_profiler.get(), Stage::REDUCE, level};
+        reduceGaussian(gaussians.at(level - 1), kernel, size.height, size.width, gaussians.at(level));
+        timer.stop(allocated, size.area());
+    }
 }
 
-std::vector<cv::Mat> laplacian::LaplacianPyramid::reduceToGaussians(
-        const cv::Mat& image,
-        const cv::Mat& kernel,
-        uint8_t compressions) const {
+void laplacian::LaplacianPyramid::reduceGaussian(const cv::Mat& image,
+                                                 const cv::Mat& kernel,
+                                                 int rows,
+                                                 int columns,
+                                                 cv::Mat& reduced) const {
 
-    std::vector<cv::Mat> gaussians;
-    gaussians.push_back(image);
-    cv::Mat actual = image;
+    reduced.create(rows, columns, types::planeType(image.type()));
+
+    if (types::isFixedPoint(image.type())) {
+        const FixedPointReduceEngine engine{kernel};
+        forEachRowBand(rows, [&](int begin, int end) { engine.apply(image, reduced, begin, end); });
+        return;
+    }
 
-    const double Mc = (static_cast<float>(actual.cols) - 1.0f) / std::pow(2.0f, compressions);
-    const double Mr = (static_cast<float>(actual.rows) - 1.0f) / std::pow(2.0f, compressions);
+    const ReduceEngine engine{kernel};
+    forEachRowBand(rows, [&](int begin, int end) { engine.apply(image, reduced, begin, end); });
+}
+
+void laplacian::LaplacianPyramid::upsampleAndAdd(const cv::Mat& image,
+                                                 const cv::Mat& addend,
+                                                 const cv::Mat& kernel,
+                                                 int type,
+                                                 cv::Mat& sum) const {
 
-    for (uint8_t level = 1; level < compressions; level++) {
+    sum.create(addend.rows, addend.cols, type);
 
-        actual = reduceGaussian(actual, kernel,
-                                static_cast<int>(Mr * std::pow(2, compressions - level) - 3),
-                                static_cast<int>(Mc * std::pow(2, compressions - level)  - 3));
-        gaussians.push_back(actual);
+    if (types::isFixedPoint(image.type())) {
+        const FixedPointExpandEngine engine{kernel};
+        forEachRowBand(addend.rows, [&](int begin, int end) { engine.applyAndAdd(image, addend, sum, begin, end); });
+        return;
     }
 
-    return gaussians;
+    const ExpandEngine engine{kernel};
+    forEachRowBand(addend.rows, [&](int begin, int end) { engine.applyAndAdd(image, addend, sum, begin, end); });
 }
 
-cv::Mat laplacian::LaplacianPyramid::reduceGaussian(
-        const cv::Mat& image,
-        const cv::Mat& kernel,
-        int rows,
-        int columns) const {
+void laplacian::LaplacianPyramid::upsampleAndAddSparse(const cv::Mat& image,
+                                                       const SparsePlane& addend,
+                                                       const cv::Mat& kernel,
+                                                       int type,
+                                                       cv::Mat& sum) const {
 
-    cv::Mat filtered(rows, columns, CV_32F);
-    int kernelHalfRows = (kernel.rows / 2);
-    int kernelHalfCols = (kernel.cols / 2);
+    sum.create(addend.size(), type);
 
-    for (int i = 0; i < rows; i++) {
+    const auto expand = [&](const auto& engine) {
 
-        for(int j = 0; j < columns; j++) {
+        forEachRowBand(sum.rows, [&](int begin, int end) {
 
-            float value = 0.0f;
-            for(int m = -kernelHalfRows; m <= kernelHalfRows; m++) {
+            // The dense rows of one row of blocks. They are reused, so steady state decoding does not allocate.
+            thread_local cv::Mat rows;
 
-                int row = (i << 1) - m;
-                for(int n = -kernelHalfCols; n <= kernelHalfCols; n++) {
+            int row = begin;
+            while (row < end) {
 
-                    int col = (j << 1) - n;
+                const int blockRow = row / SparsePlane::BLOCK_SIZE;
+                const int first = blockRow * SparsePlane::BLOCK_SIZE;
+                if (addend.isOccupied(blockRow)) {
 
-                    if (row >= 0 && col >= 0) {
+                    const int last = std::min(end, first + SparsePlane::BLOCK_SIZE);
+                    addend.decompress(blockRow, rows);
+                    engine.applyAndAdd(image, rows, first, sum, row, last);
+                    row = last;
+                    continue;
+                }
 
-                        row = std::min(row, image.rows - 1);
-                        col = std::min(col, image.cols - 1);
-                        value += kernel.at<float>(m + kernelHalfRows, n + kernelHalfCols) * image.at<float>(row, col);
-                    }
+                // A run of empty rows of blocks is the upsampled image itself.
+                int last = std::min(end, first + SparsePlane::BLOCK_SIZE);
+                while (last < end && !addend.isOccupied(last / SparsePlane::BLOCK_SIZE)) {
+                    last = std::min(end, last + SparsePlane::BLOCK_SIZE);
                 }
+                engine.apply(image, sum, row, last);
+                row = last;
             }
-            filtered.at<float>(i, j) = value;
+        });
+    };
 
-        }
+    if (types::isFixedPoint(image.type())) {
+        expand(FixedPointExpandEngine{kernel});
+        return;
     }
-
-    return filtered;
+    expand(ExpandEngine{kernel});
 }
 
-std::vector<cv::Mat> laplacian::LaplacianPyramid::upsample(const std::vector<cv::Mat>& images,
-                                                           const cv::Mat& kernel) const {
-
-    std::vector<cv::Mat> upsampled;
+void laplacian::LaplacianPyramid::upsampleAndSubtract(const cv::Mat& image,
+                                                      const cv::Mat& minuend,
+                                                      const cv::Mat& kernel,
+                                                      cv::Mat& difference) const {
 
-    for (int level = 1; level < images.size(); level++) {
+    difference.create(minuend.rows, minuend.cols, types::planeType(minuend.type()));
 
-        const auto& imageOfUpperLevel = images.at(level - 1);
-
-        upsampled.emplace_back(upsample(images.at(level), imageOfUpperLevel.rows, imageOfUpperLevel.cols, kernel));
+    if (types::isFixedPoint(image.type())) {
+        const FixedPointExpandEngine engine{kernel};
+        forEachRowBand(minuend.rows, [&](int begin, int end) {
+            engine.applyAndSubtract(image, minuend, difference, begin, end);
+        });
+        return;
     }
 
-    return upsampled;
+    const ExpandEngine engine{kernel};
+    forEachRowBand(minuend.rows, [&](int begin, int end) {
+        engine.applyAndSubtract(image, minuend, difference, begin, end);
+    });
 }
 
-cv::Mat laplacian::LaplacianPyramid::upsample(const cv::Mat& image, int rows, int cols, const cv::Mat& kernel) const {
+void laplacian::LaplacianPyramid::buildLaplacianPlanes(const std::vector<cv::Mat>& gaussians,
+                                                       const cv::Mat& kernel,
+                                                       std::vector<cv::Mat>& planes) const {
 
-    cv::Mat upsampled(rows, cols, CV_32F);
+    for (size_t level = 0; level + 1 < gaussians.size(); level++) {
 
-    int kernelHalfRows = (kernel.rows / 2);
-    int kernelHalfCols = (kernel.cols / 2);
+        const cv::Mat& gaussian = gaussians.at(level);
+        const size_t allocated = StageTimer::allocation(planes.at(level), gaussian.size(),
+                                                        types::planeType(gaussian.type()));
+        StageTimer timer{_profiler.get(), Stage::LAPLACIAN_PLANE, static_cast<uint8_t>(level)};
+        upsampleAndSubtract(gaussians.at(level + 1), gaussian, kernel, planes.at(level));
+        timer.stop(allocated, gaussian.total());
+    }
+    planes.at(gaussians.size() - 1) = gaussians.at(gaussians.size() - 1);
+}
 
-    for (int i = 0; i < rows; i++) {
+void laplacian::LaplacianPyramid::quantize(std::vector<cv::Mat>& laplacianPlanes, float quantization) const {
 
-        for (int j = 0; j < cols; j++) {
+    const auto levels = static_cast<uint8_t>(laplacianPlanes.size());
 
-            float value = 0.0f;
-            for(int m = -kernelHalfRows; m <= kernelHalfRows; m++) {
+    for (uint8_t level = 0; level < levels; level++) {
 
-                float row = static_cast<float>((i - m)) / 2.0f;
-                for(int n = -kernelHalfCols; n <= kernelHalfCols; n++) {
+        cv::Mat& plane = laplacianPlanes.at(level);
+        StageTimer timer{_profiler.get(), Stage::QUANTIZE, level};
+        quantizePlane(plane, quantizationStep(quantization, level, levels, plane.type()));
+        timer.stop(0, plane.total());
+    }
+}
 
-                    float col = static_cast<float>((j - n)) / 2.0f;
+void laplacian::LaplacianPyramid::quantizePlane(cv::Mat& plane, float step) {
 
-                    if (isInteger(row) && row >= 0 &&
-                        isInteger(col) && col >= 0) {
+    const int width = plane.cols * plane.channels();
 
-                        int rowI = std::min(static_cast<int>(row), image.rows - 1);
-                        int colI = std::min(static_cast<int>(col), image.cols - 1);
+    for (int i = 0; i < plane.rows; i++) {
 
-                        value += kernel.at<float>(m + kernelHalfRows, n + kernelHalfCols) * image.at<float>(rowI, colI);
-                    }
-                }
-            }
-            upsampled.at<float>(i, j) = 4 * value;
+        switch (plane.depth()) {
+            case CV_32F:
+                quantizeRow(plane.ptr<float>(i), width, step);
+                break;
+            case CV_16S:
+                quantizeRow(plane.ptr<short>(i), width, step);
+                break;
+            default:
+                quantizeRow(plane.ptr<int>(i), width, step);
+                break;
         }
     }
-
-    return upsampled;
 }
 
-std::vector<cv::Mat> laplacian::LaplacianPyramid::buildLaplacianPlanes(const std::vector<cv::Mat>& gaussians,
-                                          const std::vector<cv::Mat>& upsampled) {
+float laplacian::LaplacianPyramid::quantizationStep(float quantization,
+                                                    uint8_t level,
+                                                    uint8_t levels,
+                                                    int type) {
 
-    if (gaussians.size() != (upsampled.size() + 1)) {
-        throw LaplacianPyramidException("The gaussian vector has to have one more image than the upsampled!");
+    if (quantization == 0) {
+        return 0.0f;
     }
 
-    std::vector<cv::Mat> laplacian;
+    const float step = std::ldexp(quantization, std::max(0, levels - 2 - level));
+    return types::isFixedPoint(type) ? std::max(1.0f, std::round(step)) : step;
+}
 
-    for (int level = 0; level <= gaussians.size() - 2; level++) {
+float laplacian::LaplacianPyramid::levelStep(uint8_t level) const {
 
-        laplacian.emplace_back(gaussians.at(level) - upsampled.at(level));
-    }
-    laplacian.push_back(gaussians.at(gaussians.size() - 1));
+    return _steps.empty() ? quantizationStep(_quantization, level, levels(), planeType()) : _steps.at(level);
+}
+
+void laplacian::LaplacianPyramid::keepSteps(const std::vector<float>& steps) {
 
-    return laplacian;
+    _steps.clear();
+    for (uint8_t level = 0; level < levels(); level++) {
+
+        if (steps.at(level) != quantizationStep(_quantization, level, levels(), planeType())) {
+            _steps = steps;
+            return;
+        }
+    }
 }
 
-std::vector<cv::Mat> laplacian::LaplacianPyramid::quantize(const std::vector<cv::Mat>& laplacianPlanes,
-                              float quantization) const {
+template<class T>
+void laplacian::LaplacianPyramid::quantizeRow(T* row, int width, float step) {
+
+    if constexpr (std::is_floating_point<T>::value) {
+
+        kernels::kernelTable().quantizeRow(row, width, step);
+
+    } else {
 
-    // TODO: Implement uniform quantization
+        // Rounds half away from zero, so the bins are symmetric around the zero bin.
+        const int64_t integerStep = cvRound(step);
+        const int64_t half = integerStep / 2;
+        for (int j = 0; j < width; j++) {
 
-    return laplacianPlanes;
+            const int64_t value = row[j];
+            const int64_t bin = value >= 0 ? (value + half) / integerStep : -((half - value) / integerStep);
+            row[j] = cv::saturate_cast<T>(bin * integerStep);
+        }
+    }
 }
+
+template void laplacian::LaplacianPyramid::quantizeRow<float>(float*, int, float);
@@ -0,0 +1,96 @@
+#include "mapped_file.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+laplacian::MappedFile::MappedFile(const std::string& path) : _data(nullptr), _size(0), _file(nullptr), _mapping(nullptr) {
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw LaplacianPyramidException{"The file could not be opened!"};
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        throw LaplacianPyramidException{"The file could not be mapped!"};
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!data) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw LaplacianPyramidException{"The file could not be mapped!"};
+    }
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(size.QuadPart);
+    _file = file;
+    _mapping = mapping;
+}
+
+laplacian::MappedFile::~MappedFile() {
+
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping);
+    CloseHandle(_file);
+}
+
+#else
+
+laplacian::MappedFile::MappedFile(const std::string& path) : _data(nullptr), _size(0) {
+
+    const int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw LaplacianPyramidException{"The file could not be opened!"};
+    }
+
+    struct stat status{};
+    if (::fstat(file, &status) != 0 || status.st_size <= 0) {
+        ::close(file);
+        throw LaplacianPyramidException{"The file could not be mapped!"};
+    }
+
+    // The mapping keeps its own reference to the file, so the descriptor is not needed anymore.
+    void* data = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_SHARED, file, 0);
+    ::close(file);
+    if (data == MAP_FAILED) {
+        throw LaplacianPyramidException{"The file could not be mapped!"};
+    }
+
+    _data = static_cast<const uint8_t*>(data);
+    _size = static_cast<size_t>(status.st_size);
+}
+
+laplacian::MappedFile::~MappedFile() {
+
+    ::munmap(const_cast<uint8_t*>(_data), _size);
+}
+
+#endif
+
+const uint8_t* laplacian::MappedFile::data() const {
+
+    return _data;
+}
+
+size_t laplacian::MappedFile::size() const {
+
+    return _size;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace laplacian {
+
+    /**
+     *
+     * Maps a whole file read only into memory. Opening a file only reserves the address range, the pages are read
+     * by the operating system when they are touched first. The mapping lives as long as the object.
+     */
+    class MappedFile {
+    public:
+
+        /**
+         *
+         * Maps the file at the given path. If the file cannot be opened, is empty or cannot be mapped,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param path The path of the file.
+         */
+        explicit MappedFile(const std::string& path);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         *
+         * Gets the first byte of the mapped file.
+         *
+         * @return The mapped bytes.
+         */
+        [[nodiscard]] const uint8_t* data() const;
+
+        /**
+         *
+         * Gets the size of the mapped file.
+         *
+         * @return The size in bytes.
+         */
+        [[nodiscard]] size_t size() const;
+
+    private:
+        const uint8_t* _data;
+        size_t _size;
+#if defined(_WIN32)
+        void* _file;
+        void* _mapping;
+#endif
+    };
+}
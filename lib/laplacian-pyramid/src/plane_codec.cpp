@@ -0,0 +1,178 @@
+#include "plane_codec.hpp"
+#include "entropy_coder.hpp"
+#include "pyramid_types.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+void laplacian::PlaneCodec::write(std::ostream& stream, const cv::Mat& plane, float step) {
+
+    const int width = plane.cols * plane.channels();
+    const bool coded = step > 0.0f || types::isFixedPoint(plane.type());
+
+    writeValue<uint32_t>(stream, static_cast<uint32_t>(plane.rows));
+    writeValue<uint32_t>(stream, static_cast<uint32_t>(plane.cols));
+    writeValue<int32_t>(stream, plane.type());
+    writeValue<uint8_t>(stream, coded ? CODED : RAW);
+    writeValue<float>(stream, step);
+
+    std::vector<uint8_t> payload;
+
+    if (coded) {
+
+        // Integer planes are coded losslessly with a step of one if they are not quantized.
+        const float binStep = step > 0.0f ? step : 1.0f;
+        const int integerStep = cvRound(binStep);
+
+        std::vector<int32_t> indices(static_cast<size_t>(plane.rows) * width);
+        for (int i = 0; i < plane.rows; i++) {
+
+            int32_t* row = indices.data() + static_cast<size_t>(i) * width;
+            switch (plane.depth()) {
+                case CV_32F: {
+                    const float* values = plane.ptr<float>(i);
+                    for (int j = 0; j < width; j++) {
+                        row[j] = cv::saturate_cast<int>(values[j] / binStep);
+                    }
+                    break;
+                }
+                case CV_16S: {
+                    const short* values = plane.ptr<short>(i);
+                    for (int j = 0; j < width; j++) {
+                        row[j] = values[j] / integerStep;
+                    }
+                    break;
+                }
+                default: {
+                    const int* values = plane.ptr<int>(i);
+                    for (int j = 0; j < width; j++) {
+                        row[j] = values[j] / integerStep;
+                    }
+                    break;
+                }
+            }
+        }
+        EntropyCoder::encode(indices.data(), indices.size(), payload);
+
+    } else {
+
+        payload.reserve(static_cast<size_t>(plane.rows) * width * sizeof(float));
+        for (int i = 0; i < plane.rows; i++) {
+
+            const float* values = plane.ptr<float>(i);
+            for (int j = 0; j < width; j++) {
+
+                uint32_t bits;
+                std::memcpy(&bits, &values[j], sizeof(bits));
+                for (int byte = 0; byte < 4; byte++) {
+                    payload.push_back(static_cast<uint8_t>(bits >> (8 * byte)));
+                }
+            }
+        }
+    }
+
+    writeValue<uint64_t>(stream, payload.size());
+    stream.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+}
+
+cv::Mat laplacian::PlaneCodec::read(std::istream& stream, float* step) {
+
+    const auto rows = readValue<uint32_t>(stream);
+    const auto cols = readValue<uint32_t>(stream);
+    const auto type = readValue<int32_t>(stream);
+    const auto coding = readValue<uint8_t>(stream);
+    const auto planeStep = readValue<float>(stream);
+    const auto size = readValue<uint64_t>(stream);
+
+    const bool validType = type >= 0 && types::isSupported(types::imageType(type)) &&
+                           types::planeType(types::imageType(type)) == type;
+    if (!validType || rows == 0 || cols == 0 || rows > INT_MAX / cols / 4 ||
+        !(std::isfinite(planeStep) && planeStep >= 0.0f) || (coding != RAW && coding != CODED) ||
+        (coding == RAW && types::isFixedPoint(type))) {
+        throw LaplacianPyramidException{"The stream holds an invalid plane!"};
+    }
+
+    cv::Mat plane(static_cast<int>(rows), static_cast<int>(cols), type);
+    const int width = plane.cols * plane.channels();
+    const size_t count = static_cast<size_t>(plane.rows) * width;
+
+    // A coded value takes at most 7 bytes, the code lengths less than 64.
+    if ((coding == RAW && size != count * sizeof(float)) || (coding == CODED && size > count * 7 + 64)) {
+        throw LaplacianPyramidException{"The stream holds an invalid plane!"};
+    }
+
+    std::vector<uint8_t> payload(size);
+    readBytes(stream, payload.data(), payload.size());
+
+    if (step) {
+        *step = planeStep;
+    }
+
+    if (coding == RAW) {
+
+        for (int i = 0; i < plane.rows; i++) {
+
+            float* values = plane.ptr<float>(i);
+            const uint8_t* bytes = payload.data() + static_cast<size_t>(i) * width * sizeof(float);
+            for (int j = 0; j < width; j++) {
+
+                uint32_t bits = 0;
+                for (int byte = 0; byte < 4; byte++) {
+                    bits |= static_cast<uint32_t>(bytes[4 * j + byte]) << (8 * byte);
+                }
+                std::memcpy(&values[j], &bits, sizeof(bits));
+            }
+        }
+        return plane;
+    }
+
+    std::vector<int32_t> indices(count);
+    EntropyCoder::decode(payload.data(), payload.size(), indices.data(), count);
+
+    const float binStep = planeStep > 0.0f ? planeStep : 1.0f;
+    const int64_t integerStep = cvRound(binStep);
+
+    for (int i = 0; i < plane.rows; i++) {
+
+        const int32_t* row = indices.data() + static_cast<size_t>(i) * width;
+        switch (plane.depth()) {
+            case CV_32F: {
+                float* values = plane.ptr<float>(i);
+                for (int j = 0; j < width; j++) {
+                    values[j] = static_cast<float>(row[j]) * binStep;
+                }
+                break;
+            }
+            case CV_16S: {
+                short* values = plane.ptr<short>(i);
+                for (int j = 0; j < width; j++) {
+                    values[j] = cv::saturate_cast<short>(row[j] * integerStep);
+                }
+                break;
+            }
+            default: {
+                int* values = plane.ptr<int>(i);
+                for (int j = 0; j < width; j++) {
+                    values[j] = cv::saturate_cast<int>(row[j] * integerStep);
+                }
+                break;
+            }
+        }
+    }
+
+    return plane;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::PlaneCodec::readBytes(std::istream& stream, uint8_t* bytes, size_t size) {
+
+    stream.read(reinterpret_cast<char*>(bytes), static_cast<std::streamsize>(size));
+    if (static_cast<size_t>(stream.gcount()) != size) {
+        throw LaplacianPyramidException{"The stream ends unexpectedly!"};
+    }
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+namespace laplacian {
+
+    /**
+     *
+     * Writes and reads single laplacian planes of the binary pyramid format.
+     *
+     * A plane is stored as its rows, columns and type, followed by its coding, its quantization step and the size
+     * of its payload. Quantized planes and integer planes are stored as their bin indices coded by the
+     * #laplacian::EntropyCoder. Unquantized floating point planes are stored raw. All values are little endian.
+     */
+    class PlaneCodec {
+    public:
+
+        /**
+         *
+         * Writes the given plane to the given stream.
+         *
+         * @param stream The stream to write to.
+         * @param plane The plane to write. Its values have to be multiples of the step.
+         * @param step The quantization step of the plane, zero if the plane is not quantized.
+         */
+        static void write(std::ostream& stream, const cv::Mat& plane, float step);
+
+        /**
+         *
+         * Reads a plane written by #write. If the stream holds no valid plane,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param stream The stream to read from.
+         * @param step Gets the quantization step of the plane if it is not nullptr.
+         *
+         * @return The plane.
+         */
+        [[nodiscard]] static cv::Mat read(std::istream& stream, float* step = nullptr);
+
+        /**
+         *
+         * Writes the given value little endian.
+         *
+         * @tparam T An arithmetic type.
+         * @param stream The stream to write to.
+         * @param value The value to write.
+         */
+        template<class T>
+        static void writeValue(std::ostream& stream, T value) {
+
+            static_assert(std::is_arithmetic<T>::value, "Only arithmetic values can be written.");
+
+            uint8_t bytes[sizeof(T)];
+            Bits<T> bits;
+            std::memcpy(&bits, &value, sizeof(T));
+            for (size_t i = 0; i < sizeof(T); i++) {
+                bytes[i] = static_cast<uint8_t>(bits >> (8 * i));
+            }
+            stream.write(reinterpret_cast<const char*>(bytes), sizeof(T));
+        }
+
+        /**
+         *
+         * Reads a little endian value. If the stream ends, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @tparam T An arithmetic type.
+         * @param stream The stream to read from.
+         *
+         * @return The value.
+         */
+        template<class T>
+        [[nodiscard]] static T readValue(std::istream& stream) {
+
+            static_assert(std::is_arithmetic<T>::value, "Only arithmetic values can be read.");
+
+            uint8_t bytes[sizeof(T)];
+            readBytes(stream, bytes, sizeof(T));
+
+            Bits<T> bits = 0;
+            for (size_t i = 0; i < sizeof(T); i++) {
+                bits |= static_cast<Bits<T>>(static_cast<Bits<T>>(bytes[i]) << (8 * i));
+            }
+            T value;
+            std::memcpy(&value, &bits, sizeof(T));
+            return value;
+        }
+
+    private:
+        /**
+         * The unsigned integer type with the size of T, which holds the bits of T in the byte order of the host.
+         */
+        template<class T>
+        using Bits = typename std::conditional<sizeof(T) == 1, uint8_t,
+                     typename std::conditional<sizeof(T) == 2, uint16_t,
+                     typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type>::type>::type;
+
+        static const uint8_t RAW = 0;
+        static const uint8_t CODED = 1;
+
+        /**
+         *
+         * Reads the given amount of bytes. If the stream ends, a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param stream The stream to read from.
+         * @param bytes The bytes read.
+         * @param size The amount of bytes to read.
+         */
+        static void readBytes(std::istream& stream, uint8_t* bytes, size_t size);
+    };
+}
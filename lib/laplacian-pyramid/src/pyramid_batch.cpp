@@ -0,0 +1,105 @@
+#include <laplacian-pyramid/pyramid_batch.hpp>
+#include "pyramid_geometry.hpp"
+#include "pyramid_types.hpp"
+
+laplacian::PyramidBatch::PyramidBatch(cv::Size imageSize,
+                                      int type,
+                                      uint8_t compressions,
+                                      float quantization,
+                                      std::shared_ptr<Executor> executor) :
+        _geometry(std::make_shared<PyramidGeometry>(imageSize, compressions)),
+        _type(type),
+        _kernel(LaplacianPyramid::kernel()),
+        _quantization(quantization),
+        _executor(std::move(executor)) {
+
+    if (!types::isSupported(type)) {
+        throw LaplacianPyramidException{"The images have to be CV_32F, CV_8U or CV_16U encoded with up to four channels!"};
+    }
+
+    if (!types::holdsCompressions(type, _geometry->levels())) {
+        throw LaplacianPyramidException{"The planes of the image type cannot hold that many compressions!"};
+    }
+}
+
+laplacian::PyramidBatch::~PyramidBatch() = default;
+
+std::vector<laplacian::LaplacianPyramid> laplacian::PyramidBatch::encode(const std::vector<cv::Mat>& images) const {
+
+    std::vector<LaplacianPyramid> pyramids;
+    pyramids.reserve(images.size());
+    for (const cv::Mat& image : images) {
+
+        if (image.type() != _type || image.size() != _geometry->imageSize()) {
+            throw LaplacianPyramidException{"The image does not have the size and the type the batch is made for!"};
+        }
+        pyramids.push_back(LaplacianPyramid{std::vector<cv::Mat>(), cv::Size(), _kernel, _quantization,
+                                            bandExecutor(images.size())});
+    }
+
+    const PyramidGeometry& geometry = *_geometry;
+    forEachIndex(static_cast<int>(images.size()), [&](int index) {
+
+        // The gaussians between the image and the top level are reused for the next image of the thread.
+        // Level 0 is the image itself and the top level becomes the top plane, so neither is kept.
+        thread_local std::vector<cv::Mat> gaussians;
+        gaussians.resize(geometry.levels());
+
+        std::vector<cv::Mat> planes(geometry.levels());
+        LaplacianPyramid& pyramid = pyramids.at(index);
+        pyramid.encode(images.at(index), geometry, gaussians, planes, true);
+        pyramid._executor = _executor;
+
+        gaussians.front() = cv::Mat();
+        gaussians.back() = cv::Mat();
+    });
+
+    return pyramids;
+}
+
+std::vector<cv::Mat> laplacian::PyramidBatch::decode(const std::vector<LaplacianPyramid>& pyramids) const {
+
+    std::vector<cv::Mat> images(pyramids.size());
+    const std::shared_ptr<Executor> executor = bandExecutor(pyramids.size());
+
+    forEachIndex(static_cast<int>(pyramids.size()), [&](int index) {
+
+        // The reconstructions above level 0 are reused for the next pyramid of the thread, level 0 is the result.
+        thread_local std::vector<cv::Mat> reconstructed;
+
+        LaplacianPyramid pyramid = pyramids.at(index);
+        pyramid._executor = executor;
+        reconstructed.resize(std::max<size_t>(reconstructed.size(), pyramid.levels()));
+        images.at(index) = pyramid.reconstruct(reconstructed);
+        reconstructed.front() = cv::Mat();
+    });
+
+    return images;
+}
+
+uint8_t laplacian::PyramidBatch::levels() const {
+
+    return _geometry->levels();
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::PyramidBatch::forEachIndex(int count, const std::function<void(int)>& task) const {
+
+    if (!_executor) {
+
+        for (int index = 0; index < count; index++) {
+            task(index);
+        }
+        return;
+    }
+
+    _executor->parallelFor(count, task);
+}
+
+std::shared_ptr<laplacian::Executor> laplacian::PyramidBatch::bandExecutor(size_t count) const {
+
+    return _executor && count < static_cast<size_t>(_executor->concurrency()) ? _executor : nullptr;
+}
@@ -0,0 +1,430 @@
+#include <laplacian-pyramid/pyramid_blender.hpp>
+#include "pyramid_geometry.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <type_traits>
+
+namespace {
+
+#if CV_SIMD
+    cv::v_float32 loadRow(const float* row) {
+        return cv::vx_load(row);
+    }
+
+    cv::v_float32 loadRow(const cv::float16_t* row) {
+        return cv::vx_load_expand(row);
+    }
+
+    cv::v_float32 loadRow(const short* row) {
+        return cv::v_cvt_f32(cv::vx_load_expand(row));
+    }
+
+    cv::v_float32 loadRow(const int* row) {
+        return cv::v_cvt_f32(cv::vx_load(row));
+    }
+
+    // Rounds and saturates like cv::saturate_cast.
+    void storeRow(float* row, const cv::v_float32& values) {
+        cv::v_store(row, values);
+    }
+
+    void storeRow(cv::float16_t* row, const cv::v_float32& values) {
+        cv::v_pack_store(row, values);
+    }
+
+    void storeRow(short* row, const cv::v_float32& values) {
+        cv::v_pack_store(row, cv::v_round(values));
+    }
+
+    void storeRow(int* row, const cv::v_float32& values) {
+        cv::v_store(row, cv::v_round(values));
+    }
+
+    /**
+     * Spreads the weights of cv::v_float32::nlanes pixels over their CN interleaved channels, so weights[c] weights
+     * the values c * nlanes to (c + 1) * nlanes - 1 of the pixels.
+     */
+    template<int CN>
+    void spreadWeights(const float* pixels, cv::v_float32 (&weights)[CN]) {
+
+        const cv::v_float32 weight = cv::vx_load(pixels);
+        if constexpr (CN == 1) {
+            weights[0] = weight;
+        } else {
+            float spread[CN * cv::v_float32::nlanes];
+            if constexpr (CN == 2) {
+                cv::v_store_interleave(spread, weight, weight);
+            } else if constexpr (CN == 3) {
+                cv::v_store_interleave(spread, weight, weight, weight);
+            } else {
+                cv::v_store_interleave(spread, weight, weight, weight, weight);
+            }
+            for (int c = 0; c < CN; c++) {
+                weights[c] = cv::vx_load(spread + c * cv::v_float32::nlanes);
+            }
+        }
+    }
+#endif
+}
+
+laplacian::PyramidBlender::PyramidBlender(std::shared_ptr<Executor> executor) :
+        _executor(std::move(executor)),
+        _gaussians() {
+}
+
+laplacian::LaplacianPyramid laplacian::PyramidBlender::blend(const LaplacianPyramid& first,
+                                                             const LaplacianPyramid& second,
+                                                             const cv::Mat& mask) {
+
+    LaplacianPyramid result{std::vector<cv::Mat>(), cv::Size(), first._kernel, 0.0f, _executor};
+    blend(first, second, mask, result);
+    return result;
+}
+
+void laplacian::PyramidBlender::blend(const LaplacianPyramid& first,
+                                      const LaplacianPyramid& second,
+                                      const cv::Mat& mask,
+                                      LaplacianPyramid& result) {
+
+    const std::vector<const LaplacianPyramid*> pyramids = {&first, &second};
+    const std::vector<cv::Mat> weights = {mask};
+    validate(pyramids, weights);
+
+    reduceWeights(first, weights, false);
+    combine(pyramids, true, result);
+}
+
+laplacian::LaplacianPyramid laplacian::PyramidBlender::fuse(const std::vector<LaplacianPyramid>& pyramids,
+                                                            const std::vector<cv::Mat>& weights) {
+
+    if (pyramids.empty()) {
+        throw LaplacianPyramidException{"There have to be pyramids to fuse!"};
+    }
+
+    LaplacianPyramid result{std::vector<cv::Mat>(), cv::Size(), pyramids.front()._kernel, 0.0f, _executor};
+    fuse(pyramids, weights, result);
+    return result;
+}
+
+void laplacian::PyramidBlender::fuse(const std::vector<LaplacianPyramid>& pyramids,
+                                     const std::vector<cv::Mat>& weights,
+                                     LaplacianPyramid& result) {
+
+    if (pyramids.empty() || pyramids.size() != weights.size()) {
+        throw LaplacianPyramidException{"There has to be one weight map for every pyramid to fuse!"};
+    }
+
+    std::vector<const LaplacianPyramid*> inputs;
+    inputs.reserve(pyramids.size());
+    for (const LaplacianPyramid& pyramid : pyramids) {
+        inputs.push_back(&pyramid);
+    }
+    validate(inputs, weights);
+
+    reduceWeights(pyramids.front(), weights, true);
+    combine(inputs, false, result);
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::PyramidBlender::validate(const std::vector<const LaplacianPyramid*>& pyramids,
+                                         const std::vector<cv::Mat>& weights) {
+
+    const LaplacianPyramid& reference = *pyramids.front();
+
+    for (const LaplacianPyramid* pyramid : pyramids) {
+
+        bool matches = pyramid->levels() == reference.levels() && pyramid->planeType() == reference.planeType() &&
+                       pyramid->precision() == reference.precision() && pyramid->imageSize() == reference.imageSize() &&
+                       pyramid->_kernel.at<float>(2) == reference._kernel.at<float>(2);
+        for (uint8_t level = 0; matches && level < reference.levels(); level++) {
+            matches = pyramid->levelSize(level) == reference.levelSize(level);
+        }
+
+        if (!matches) {
+            throw LaplacianPyramidException{"The pyramids do not have the same levels, sizes, type and kernel!"};
+        }
+    }
+
+    for (const cv::Mat& weight : weights) {
+
+        if (weight.type() != CV_32F || weight.cols < reference.imageSize().width ||
+            weight.rows < reference.imageSize().height) {
+            throw LaplacianPyramidException{"The weight maps have to be CV_32F images covering the decoded image!"};
+        }
+    }
+}
+
+void laplacian::PyramidBlender::reduceWeights(const LaplacianPyramid& pyramid,
+                                              const std::vector<cv::Mat>& weights,
+                                              bool normalize) {
+
+    if (_gaussians.size() < weights.size()) {
+        _gaussians.resize(weights.size());
+    }
+
+    for (size_t index = 0; index < weights.size(); index++) {
+
+        _gaussians.at(index).resize(pyramid.levels());
+        scaleWeights(weights.at(index), pyramid.imageSize(), pyramid.levelSize(0), _gaussians.at(index).front());
+    }
+
+    if (normalize) {
+        normalizeWeights(weights.size());
+    }
+
+    // Level 0 of the pyramid has a valid size, so its geometry is the geometry of the pyramid.
+    const PyramidGeometry geometry{pyramid.levelSize(0), pyramid.levels()};
+    const LaplacianPyramid reducer{std::vector<cv::Mat>(), cv::Size(), pyramid._kernel, 0.0f, _executor};
+    for (size_t index = 0; index < weights.size(); index++) {
+
+        std::vector<cv::Mat>& gaussians = _gaussians.at(index);
+        reducer.reduceToGaussians(gaussians.front(), pyramid._kernel, geometry, gaussians);
+    }
+}
+
+void laplacian::PyramidBlender::scaleWeights(const cv::Mat& weights,
+                                             cv::Size imageSize,
+                                             cv::Size size,
+                                             cv::Mat& gaussian) {
+
+    if (weights.cols >= size.width && weights.rows >= size.height) {
+        weights(cv::Rect(cv::Point(), size)).copyTo(gaussian);
+        return;
+    }
+
+    // Pads the weights of a padded pyramid the way the image was padded.
+    cv::copyMakeBorder(weights(cv::Rect(cv::Point(), imageSize)), gaussian, 0, size.height - imageSize.height, 0,
+                       size.width - imageSize.width, cv::BORDER_REFLECT_101);
+}
+
+void laplacian::PyramidBlender::normalizeWeights(size_t count) {
+
+    const cv::Size size = _gaussians.front().front().size();
+    const float mean = 1.0f / static_cast<float>(count);
+
+    forEachRowBand(size.height, [&](int begin, int end) {
+
+        // The row pointers only grow, so repeated fusions do not allocate.
+        thread_local std::vector<float*> rows;
+        rows.resize(std::max(rows.size(), count));
+        for (int i = begin; i < end; i++) {
+
+            for (size_t index = 0; index < count; index++) {
+                rows.at(index) = _gaussians.at(index).front().ptr<float>(i);
+            }
+
+            for (int j = 0; j < size.width; j++) {
+
+                float sum = 0.0f;
+                for (size_t index = 0; index < count; index++) {
+                    sum += rows[index][j];
+                }
+
+                const float scale = sum > 0.0f ? 1.0f / sum : 0.0f;
+                for (size_t index = 0; index < count; index++) {
+                    rows[index][j] = sum > 0.0f ? rows[index][j] * scale : mean;
+                }
+            }
+        }
+    });
+}
+
+void laplacian::PyramidBlender::combine(const std::vector<const LaplacianPyramid*>& pyramids,
+                                        bool complement,
+                                        LaplacianPyramid& result) const {
+
+    // The result may be one of the pyramids, so everything is taken from the pyramids before the result changes.
+    const LaplacianPyramid& reference = *pyramids.front();
+    const uint8_t levels = reference.levels();
+    const cv::Size imageSize = reference.imageSize();
+    const cv::Mat kernel = reference._kernel;
+    const Precision precision = reference._precision;
+
+    result._laplacianPlanesQuantized.resize(levels);
+    for (uint8_t level = 0; level < levels; level++) {
+        combineLevel(pyramids, level, complement, result);
+    }
+
+    result._imageSize = imageSize;
+    result._kernel = kernel;
+    result._quantization = 0.0f;
+    result._steps.clear();
+    result._precision = precision;
+    result._executor = _executor;
+    result._storage = nullptr;
+    result._sparsePlanes.clear();
+    result._lazy = nullptr;
+}
+
+void laplacian::PyramidBlender::combineLevel(const std::vector<const LaplacianPyramid*>& pyramids,
+                                             uint8_t level,
+                                             bool complement,
+                                             LaplacianPyramid& result) const {
+
+    // The headers only grow, so repeated blends do not allocate. They are cleared again before returning, so the
+    // planes are not kept alive. The row bands running on other threads see them through the reference.
+    thread_local std::vector<cv::Mat> levelPlanes;
+    std::vector<cv::Mat>& planes = levelPlanes;
+    planes.clear();
+    for (const LaplacianPyramid* pyramid : pyramids) {
+        planes.push_back(pyramid->at(level));
+    }
+
+    // The planes were read before, so a result which is one of the pyramids is combined in place.
+    cv::Mat& target = result._laplacianPlanesQuantized.at(level);
+    target.create(planes.front().size(), planes.front().type());
+
+    withPlaneType(target.type(), [&](auto depth, auto channels) {
+
+        using T = std::remove_pointer_t<decltype(depth)>;
+        constexpr int CN = decltype(channels)::value;
+        const int cols = target.cols;
+
+        forEachRowBand(target.rows, [&](int begin, int end) {
+
+            if (complement) {
+                for (int i = begin; i < end; i++) {
+                    blendRow<T, CN>(planes.at(0).ptr<T>(i), planes.at(1).ptr<T>(i),
+                                    _gaussians.front().at(level).ptr<float>(i), target.ptr<T>(i), cols);
+                }
+                return;
+            }
+
+            // The sums only grow, so repeated fusions do not allocate.
+            const size_t width = static_cast<size_t>(cols) * CN;
+            thread_local std::vector<float> sums;
+            sums.resize(std::max(sums.size(), width));
+
+            for (int i = begin; i < end; i++) {
+
+                std::fill_n(sums.begin(), width, 0.0f);
+                for (size_t index = 0; index < planes.size(); index++) {
+                    accumulateRow<T, CN>(planes.at(index).ptr<T>(i), _gaussians.at(index).at(level).ptr<float>(i),
+                                         sums.data(), cols);
+                }
+                storeSums(sums.data(), target.ptr<T>(i), static_cast<int>(width));
+            }
+        });
+    });
+
+    planes.clear();
+}
+
+void laplacian::PyramidBlender::forEachRowBand(int rows, const std::function<void(int, int)>& body) const {
+
+    const int bands = _executor ? std::min(_executor->concurrency(), rows / LaplacianPyramid::MIN_ROWS_PER_BAND) : 1;
+
+    if (bands <= 1) {
+        body(0, rows);
+        return;
+    }
+
+    _executor->parallelFor(bands, [rows, bands, &body](int band) {
+        body(rows * band / bands, rows * (band + 1) / bands);
+    });
+}
+
+template<class T, int CN>
+void laplacian::PyramidBlender::blendRow(const T* first, const T* second, const float* mask, T* result, int cols) {
+
+    int j = 0;
+
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    for (; j + lanes <= cols; j += lanes) {
+
+        cv::v_float32 weights[CN];
+        spreadWeights<CN>(mask + j, weights);
+        for (int c = 0; c < CN; c++) {
+
+            const int index = j * CN + c * lanes;
+            const cv::v_float32 lower = loadRow(second + index);
+            storeRow(result + index, cv::v_muladd(weights[c], loadRow(first + index) - lower, lower));
+        }
+    }
+    cv::vx_cleanup();
+#endif
+
+    for (; j < cols; j++) {
+
+        const float weight = mask[j];
+        for (int c = 0; c < CN; c++) {
+
+            const int index = j * CN + c;
+            const auto lower = static_cast<float>(second[index]);
+            result[index] = cv::saturate_cast<T>(lower + weight * (static_cast<float>(first[index]) - lower));
+        }
+    }
+}
+
+template<class T, int CN>
+void laplacian::PyramidBlender::accumulateRow(const T* row, const float* weights, float* sums, int cols) {
+
+    int j = 0;
+
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    for (; j + lanes <= cols; j += lanes) {
+
+        cv::v_float32 spread[CN];
+        spreadWeights<CN>(weights + j, spread);
+        for (int c = 0; c < CN; c++) {
+
+            const int index = j * CN + c * lanes;
+            cv::v_store(sums + index, cv::v_muladd(spread[c], loadRow(row + index), cv::vx_load(sums + index)));
+        }
+    }
+    cv::vx_cleanup();
+#endif
+
+    for (; j < cols; j++) {
+
+        const float weight = weights[j];
+        for (int c = 0; c < CN; c++) {
+            sums[j * CN + c] += weight * static_cast<float>(row[j * CN + c]);
+        }
+    }
+}
+
+template<class T>
+void laplacian::PyramidBlender::storeSums(const float* sums, T* row, int width) {
+
+    int j = 0;
+
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    for (; j + lanes <= width; j += lanes) {
+        storeRow(row + j, cv::vx_load(sums + j));
+    }
+    cv::vx_cleanup();
+#endif
+
+    for (; j < width; j++) {
+        row[j] = cv::saturate_cast<T>(sums[j]);
+    }
+}
+
+template<class Body>
+void laplacian::PyramidBlender::withPlaneType(int type, const Body& body) {
+
+    const auto withChannels = [type, &body](auto depth) {
+
+        switch (CV_MAT_CN(type)) {
+            case 1: body(depth, std::integral_constant<int, 1>()); break;
+            case 2: body(depth, std::integral_constant<int, 2>()); break;
+            case 3: body(depth, std::integral_constant<int, 3>()); break;
+            default: body(depth, std::integral_constant<int, 4>()); break;
+        }
+    };
+
+    switch (CV_MAT_DEPTH(type)) {
+        case CV_32F: withChannels(static_cast<float*>(nullptr)); break;
+        case CV_16F: withChannels(static_cast<cv::float16_t*>(nullptr)); break;
+        case CV_16S: withChannels(static_cast<short*>(nullptr)); break;
+        default: withChannels(static_cast<int*>(nullptr)); break;
+    }
+}
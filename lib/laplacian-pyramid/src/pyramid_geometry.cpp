@@ -0,0 +1,90 @@
+#include "pyramid_geometry.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <climits>
+#include <cmath>
+
+laplacian::PyramidGeometry::PyramidGeometry(cv::Size imageSize, uint8_t compressions, Scaling scaling) :
+        _imageSize(imageSize),
+        _scaling(scaling),
+        _levelSizes() {
+
+    if (imageSize.width < 1 || imageSize.height < 1 || compressions > MAX_COMPRESSIONS) {
+        throw LaplacianPyramidException{"The expected scaling cannot be applied because the original image is too small!"};
+    }
+
+    const int cols = validDimension(imageSize.width, compressions, scaling);
+    const int rows = validDimension(imageSize.height, compressions, scaling);
+
+    if (rows < 1 || cols < 1) {
+        throw LaplacianPyramidException{"The expected scaling cannot be applied because the original image is too small!"};
+    }
+
+    _levelSizes.emplace_back(cols, rows);
+
+    const double Mc = (static_cast<float>(cols) - 1.0f) / std::pow(2.0f, compressions);
+    const double Mr = (static_cast<float>(rows) - 1.0f) / std::pow(2.0f, compressions);
+
+    for (uint8_t level = 1; level < compressions; level++) {
+
+        const cv::Size size{static_cast<int>(Mc * std::pow(2, compressions - level) - 3),
+                            static_cast<int>(Mr * std::pow(2, compressions - level) - 3)};
+
+        if (size.width < 1 || size.height < 1) {
+            throw LaplacianPyramidException{"The expected compressions cannot be applied because the original image is too small!"};
+        }
+        _levelSizes.push_back(size);
+    }
+}
+
+cv::Size laplacian::PyramidGeometry::imageSize() const {
+
+    return _imageSize;
+}
+
+cv::Size laplacian::PyramidGeometry::scaledSize() const {
+
+    return _levelSizes.front();
+}
+
+cv::Size laplacian::PyramidGeometry::decodedSize() const {
+
+    return pads() ? _imageSize : scaledSize();
+}
+
+laplacian::Scaling laplacian::PyramidGeometry::scaling() const {
+
+    return _scaling;
+}
+
+bool laplacian::PyramidGeometry::pads() const {
+
+    return _scaling == Scaling::PAD && scaledSize() != _imageSize;
+}
+
+uint8_t laplacian::PyramidGeometry::levels() const {
+
+    return static_cast<uint8_t>(_levelSizes.size());
+}
+
+cv::Size laplacian::PyramidGeometry::levelSize(uint8_t level) const {
+
+    return _levelSizes.at(level);
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+int laplacian::PyramidGeometry::validDimension(int dimension, uint8_t compressions, Scaling scaling) {
+
+    // The formula 'C = M_c * 2^N + 1' of the paper "The laplacian pyramid as a Compact Image Code" is wrong.
+    // It should be 'C = M_c * 2^N - 1'. This results in '(C + 1) / 2^N = M_c
+    // Because the indexes in the paper starts with -2, formula is moved by +2.
+    // This results in the final formula '(C + 3) / 2^N = M_c
+    const int64_t period = int64_t{1} << compressions;
+    const int64_t shifted = static_cast<int64_t>(dimension) + 3;
+    const int64_t multiples = scaling == Scaling::PAD ? (shifted + period - 1) / period : shifted / period;
+    const int64_t valid = multiples * period - 3;
+    return valid > INT_MAX ? 0 : static_cast<int>(valid);
+}
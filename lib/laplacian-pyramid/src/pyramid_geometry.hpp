@@ -0,0 +1,118 @@
+#pragma once
+
+#include <laplacian-pyramid/scaling.hpp>
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * The sizes of all levels of a pyramid for a given image size and compression levels.
+     * The geometry only depends on the sizes, so it is shared by all images of the same size.
+     */
+    class PyramidGeometry {
+    public:
+
+        /**
+         *
+         * Computes the valid scaling of the given image size and the sizes of all levels.
+         * If the image cannot be scaled down by the expected compressions, a #laplacian::LaplacianPyramidException
+         * is thrown.
+         *
+         * @param imageSize The size of the image to encode.
+         * @param compressions The compression levels.
+         * @param scaling Whether the image is cropped or padded to the valid scaling.
+         */
+        PyramidGeometry(cv::Size imageSize, uint8_t compressions, Scaling scaling = Scaling::CROP);
+
+        /**
+         *
+         * Gets the size of the original image.
+         *
+         * @return The size of the original image.
+         */
+        [[nodiscard]] cv::Size imageSize() const;
+
+        /**
+         *
+         * Gets the size of the image after applying the valid scaling. This is the size of level 0.
+         *
+         * @return The scaled size.
+         */
+        [[nodiscard]] cv::Size scaledSize() const;
+
+        /**
+         *
+         * Gets the size of the decoded image. This is the size of the image if it is padded and the scaled size if
+         * it is cropped.
+         *
+         * @return The decoded size.
+         */
+        [[nodiscard]] cv::Size decodedSize() const;
+
+        /**
+         *
+         * Gets how the image is brought to the scaled size.
+         *
+         * @return The scaling.
+         */
+        [[nodiscard]] Scaling scaling() const;
+
+        /**
+         *
+         * Checks whether the image is padded, which means it is smaller than the scaled size.
+         *
+         * @return Gets true, if the image has to be padded to the scaled size.
+         */
+        [[nodiscard]] bool pads() const;
+
+        /**
+         *
+         * Gets the amount of levels.
+         *
+         * @return The levels of the pyramid.
+         */
+        [[nodiscard]] uint8_t levels() const;
+
+        /**
+         *
+         * Gets the size of the gaussian and laplacian image at the given level.
+         *
+         * @param level The level.
+         *
+         * @return The size of the level.
+         */
+        [[nodiscard]] cv::Size levelSize(uint8_t level) const;
+
+    private:
+        /**
+         * Larger compressions would need images with more than 2^30 pixels per dimension.
+         */
+        static const int MAX_COMPRESSIONS = 30;
+
+        cv::Size _imageSize;
+        Scaling _scaling;
+        std::vector<cv::Size> _levelSizes;
+
+        /**
+         *
+         * Gets the valid dimension next to the given dimension.
+         * The formula is taken from the paper "The Laplacian Pyramid as a Compact Image Code". The presented formula
+         * may be wrong, for the implementation the followin is used: M_c = (C + 1) / 2^N.
+         * Because the matrices in the paper start with an index of -2, the corresponding part of the formula is moved
+         * by +2. This results in the final formula: M_c = (C + 3) / 2^N.
+         *
+         * The dimension is valid when the above formula results in an integer value for M_c. So the valid
+         * dimensions are the multiples of 2^N minus 3, the next one is found in closed form.
+         *
+         * @param dimension The dimension "C" of the image.
+         * @param compressions The levels of the pyramid. This refers to "N" in the above formula.
+         * @param scaling Whether the next smaller or the next larger valid dimension is searched.
+         *
+         * @return The valid dimension, which is less than 1 if the image is too small to be cropped.
+         */
+        [[nodiscard]] static int validDimension(int dimension, uint8_t compressions, Scaling scaling);
+    };
+}
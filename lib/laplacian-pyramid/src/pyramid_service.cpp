@@ -0,0 +1,111 @@
+#include <laplacian-pyramid/pyramid_service.hpp>
+#include <memory>
+
+laplacian::PyramidService::PyramidService(int workers, size_t capacity) :
+        _capacity(capacity),
+        _workers(),
+        _requests(),
+        _mutex(),
+        _notEmpty(),
+        _notFull(),
+        _stopping(false) {
+
+    if (workers < 1 || capacity < 1) {
+        throw LaplacianPyramidException{"The service needs at least one worker and room for one request!"};
+    }
+
+    try {
+        for (int worker = 0; worker < workers; worker++) {
+            _workers.emplace_back([this]() { work(); });
+        }
+    } catch (...) {
+        // The destructor does not run for a failed constructor, so the started workers are stopped here.
+        stop();
+        throw;
+    }
+}
+
+laplacian::PyramidService::~PyramidService() {
+
+    stop();
+}
+
+std::future<laplacian::LaplacianPyramid> laplacian::PyramidService::submitEncode(const cv::Mat& image,
+                                                                                 uint8_t compressions,
+                                                                                 float quantization) {
+
+    return submit<LaplacianPyramid>([image, compressions, quantization]() {
+        return LaplacianPyramid{image, compressions, quantization};
+    });
+}
+
+std::future<cv::Mat> laplacian::PyramidService::submitDecode(const LaplacianPyramid& pyramid) {
+
+    return submit<cv::Mat>([pyramid]() { return pyramid.decode(); });
+}
+
+int laplacian::PyramidService::workers() const {
+
+    return static_cast<int>(_workers.size());
+}
+
+size_t laplacian::PyramidService::pending() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _requests.size();
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::PyramidService::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _notEmpty.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+template<class Result>
+std::future<Result> laplacian::PyramidService::submit(std::function<Result()> task) {
+
+    // The queue holds copyable functions, so the task is shared with the function running it.
+    auto request = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+    std::future<Result> result = request->get_future();
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notFull.wait(lock, [this]() { return _requests.size() < _capacity; });
+        _requests.emplace_back([request]() { (*request)(); });
+    }
+    _notEmpty.notify_one();
+    return result;
+}
+
+void laplacian::PyramidService::work() {
+
+    while (true) {
+
+        std::function<void()> request;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _notEmpty.wait(lock, [this]() { return _stopping || !_requests.empty(); });
+
+            if (_requests.empty()) {
+                return;
+            }
+
+            request = std::move(_requests.front());
+            _requests.pop_front();
+        }
+        _notFull.notify_one();
+
+        // The packaged task keeps an exception of the request for its future.
+        request();
+    }
+}
@@ -0,0 +1,72 @@
+#include <laplacian-pyramid/pyramid_stats.hpp>
+
+laplacian::PyramidStats::PyramidStats() : _mutex(), _levels() {
+}
+
+void laplacian::PyramidStats::record(const StageEvent& event) {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    if (event.level >= _levels.size()) {
+        _levels.resize(event.level + 1);
+    }
+    add(_levels.at(event.level).at(static_cast<int>(event.stage)),
+        StageStats{1, event.duration, event.bytesAllocated, event.pixels});
+}
+
+laplacian::StageStats laplacian::PyramidStats::stage(Stage stage) const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    StageStats sum;
+    for (const auto& level : _levels) {
+        add(sum, level.at(static_cast<int>(stage)));
+    }
+    return sum;
+}
+
+laplacian::StageStats laplacian::PyramidStats::stage(Stage stage, uint8_t level) const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return level < _levels.size() ? _levels.at(level).at(static_cast<int>(stage)) : StageStats{};
+}
+
+uint8_t laplacian::PyramidStats::levels() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    return static_cast<uint8_t>(_levels.size());
+}
+
+std::chrono::nanoseconds laplacian::PyramidStats::total() const {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    std::chrono::nanoseconds duration{0};
+    for (const auto& level : _levels) {
+        for (const auto& stats : level) {
+            duration += stats.duration;
+        }
+    }
+    return duration;
+}
+
+void laplacian::PyramidStats::reset() {
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _levels.clear();
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::PyramidStats::add(StageStats& sum, const StageStats& stats) {
+
+    sum.calls += stats.calls;
+    sum.duration += stats.duration;
+    sum.bytesAllocated += stats.bytesAllocated;
+    sum.pixels += stats.pixels;
+}
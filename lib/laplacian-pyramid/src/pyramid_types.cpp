@@ -0,0 +1,46 @@
+#include "pyramid_types.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <opencv2/core.hpp>
+
+bool laplacian::types::isSupported(int type) {
+
+    const int depth = CV_MAT_DEPTH(type);
+    return (depth == CV_32F || depth == CV_8U || depth == CV_16U) && CV_MAT_CN(type) <= 4;
+}
+
+bool laplacian::types::isFixedPoint(int type) {
+
+    return CV_MAT_DEPTH(type) != CV_32F;
+}
+
+bool laplacian::types::holdsCompressions(int type, uint8_t compressions) {
+
+    return CV_MAT_DEPTH(type) != CV_8U || compressions <= MAX_8U_COMPRESSIONS;
+}
+
+int laplacian::types::planeType(int type) {
+
+    const int channels = CV_MAT_CN(type);
+    switch (CV_MAT_DEPTH(type)) {
+        case CV_8U:
+            return CV_16SC(channels);
+        case CV_16U:
+            return CV_32SC(channels);
+        default:
+            return type;
+    }
+}
+
+int laplacian::types::imageType(int planeType) {
+
+    const int channels = CV_MAT_CN(planeType);
+    switch (CV_MAT_DEPTH(planeType)) {
+        case CV_16S:
+            return CV_8UC(channels);
+        case CV_32S:
+            return CV_16UC(channels);
+        default:
+            return planeType;
+    }
+}
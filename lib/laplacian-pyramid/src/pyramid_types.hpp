@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+namespace laplacian::types {
+
+    /**
+     *
+     * Checks whether images of the given type can be encoded. Supported are CV_32F, CV_8U and CV_16U encoded images
+     * with one to four channels.
+     *
+     * @param type The type of the image.
+     *
+     * @return True if the type is supported.
+     */
+    bool isSupported(int type);
+
+    /**
+     *
+     * Checks whether images or planes of the given type are encoded by the fixed point pipeline.
+     *
+     * @param type The type of the image or plane.
+     *
+     * @return True for every integer type.
+     */
+    bool isFixedPoint(int type);
+
+    /**
+     *
+     * Checks whether the planes of an image of the given type hold the given compressions. The outer taps of the
+     * default kernel are negative, so the fixed point gaussians and laplacian planes grow with every level. Up to
+     * #laplacian::MAX_8U_COMPRESSIONS compressions every CV_16S plane of every CV_8U image holds its values, one more
+     * lets the laplacian plane of level 8 of an adversarial image exceed CV_16S. The CV_32S planes of CV_16U images
+     * and the CV_32F planes hold every compression.
+     *
+     * @param type The type of the image.
+     * @param compressions The compression levels.
+     *
+     * @return True if the planes hold the compressions.
+     */
+    bool holdsCompressions(int type, uint8_t compressions);
+
+    /**
+     *
+     * Gets the type of the gaussians and laplacian planes of an image of the given type.
+     * CV_8U images get CV_16S planes, CV_16U images get CV_32S planes and CV_32F images get CV_32F planes.
+     * The channels are kept. The type of a plane is its own plane type.
+     *
+     * @param type The type of the image.
+     *
+     * @return The type of the planes.
+     */
+    int planeType(int type);
+
+    /**
+     *
+     * Gets the type of the decoded image of a pyramid with planes of the given type.
+     *
+     * @param planeType The type of the planes.
+     *
+     * @return The type of the decoded image.
+     */
+    int imageType(int planeType);
+}
@@ -0,0 +1,115 @@
+#include <laplacian-pyramid/pyramid_workspace.hpp>
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include "pyramid_geometry.hpp"
+#include "pyramid_types.hpp"
+
+laplacian::PyramidWorkspace::PyramidWorkspace(cv::Size imageSize, uint8_t compressions, int type, Scaling scaling) :
+        _geometry(std::make_shared<PyramidGeometry>(imageSize, compressions, scaling)),
+        _type(type),
+        _arena(),
+        _gaussians(),
+        _planes(),
+        _reconstructed() {
+
+    if (!types::isSupported(type)) {
+        throw LaplacianPyramidException{"The images have to be CV_32F, CV_8U or CV_16U encoded with up to four channels!"};
+    }
+
+    if (!types::holdsCompressions(type, _geometry->levels())) {
+        throw LaplacianPyramidException{"The planes of the image type cannot hold that many compressions!"};
+    }
+
+    const PyramidGeometry& geometry = *_geometry;
+    const uint8_t levels = geometry.levels();
+    const int planeType = types::planeType(type);
+
+    // Layout: gaussians of the levels 1 to n - 1, the laplacian planes of the levels 0 to n - 2 and two
+    // reconstruction buffers. Level 0 of the gaussians is the image itself and the last laplacian plane is the last
+    // gaussian, both are assigned while encoding. The reconstructions of the levels alternate between the two
+    // buffers, because the decoding only reads the reconstruction of the level above. The buffers have the size of
+    // the largest level they hold. The reconstruction of level 0 of integer images has the type of the image
+    // instead of the plane type, so it does not live in the arena. Neither does the padded image of level 0 of the
+    // gaussians, which has the type of the image as well.
+    const uint8_t firstArenaReconstruction = planeType == type ? 0 : 1;
+    cv::Size bufferSizes[2];
+    for (uint8_t level = firstArenaReconstruction; level + 1 < levels && level < firstArenaReconstruction + 2; level++) {
+        bufferSizes[level % 2] = geometry.levelSize(level);
+    }
+
+    size_t elements = 0;
+    for (uint8_t level = 1; level < levels; level++) {
+        elements += alignedElements(geometry.levelSize(level));
+    }
+    for (uint8_t level = 0; level + 1 < levels; level++) {
+        elements += alignedElements(geometry.levelSize(level));
+    }
+    const size_t reconstructionOffset = elements;
+    elements += alignedElements(bufferSizes[0]) + alignedElements(bufferSizes[1]);
+
+    // The arena is single channeled, so every image can start on a cache line whatever its channels are.
+    // The default allocator of OpenCV aligns to cache lines.
+    _arena.create(1, static_cast<int>(std::max<size_t>(elements, 1)), CV_MAT_DEPTH(planeType));
+
+    size_t offset = 0;
+    _gaussians.resize(levels);
+    for (uint8_t level = 1; level < levels; level++) {
+        _gaussians.at(level) = view(offset, geometry.levelSize(level));
+        offset += alignedElements(geometry.levelSize(level));
+    }
+
+    _planes.resize(levels);
+    for (uint8_t level = 0; level + 1 < levels; level++) {
+        _planes.at(level) = view(offset, geometry.levelSize(level));
+        offset += alignedElements(geometry.levelSize(level));
+    }
+
+    _reconstructed.resize(levels);
+    for (uint8_t level = firstArenaReconstruction; level + 1 < levels; level++) {
+        const size_t bufferOffset = (level % 2 == 0) ? 0 : alignedElements(bufferSizes[0]);
+        _reconstructed.at(level) = view(reconstructionOffset + bufferOffset, geometry.levelSize(level));
+    }
+    if (firstArenaReconstruction > 0 && levels > 1) {
+        _reconstructed.at(0).create(geometry.levelSize(0), type);
+    }
+    if (geometry.pads()) {
+        _gaussians.at(0).create(geometry.scaledSize(), type);
+    }
+}
+
+cv::Size laplacian::PyramidWorkspace::imageSize() const {
+
+    return _geometry->imageSize();
+}
+
+int laplacian::PyramidWorkspace::type() const {
+
+    return _type;
+}
+
+uint8_t laplacian::PyramidWorkspace::levels() const {
+
+    return _geometry->levels();
+}
+
+size_t laplacian::PyramidWorkspace::bytes() const {
+
+    return _arena.total() * _arena.elemSize();
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+cv::Mat laplacian::PyramidWorkspace::view(size_t offset, cv::Size size) const {
+
+    const int channels = CV_MAT_CN(_type);
+    const int begin = static_cast<int>(offset);
+    return _arena.colRange(begin, begin + size.area() * channels).reshape(channels, size.height);
+}
+
+size_t laplacian::PyramidWorkspace::alignedElements(cv::Size size) const {
+
+    const size_t elementSize = CV_ELEM_SIZE1(types::planeType(_type));
+    const size_t elements = static_cast<size_t>(size.area()) * CV_MAT_CN(_type);
+    return cv::alignSize(elements * elementSize, CACHE_LINE) / elementSize;
+}
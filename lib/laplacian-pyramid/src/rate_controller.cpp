@@ -0,0 +1,463 @@
+#include <laplacian-pyramid/rate_controller.hpp>
+#include "pyramid_types.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <ostream>
+#include <streambuf>
+#include <type_traits>
+#include <utility>
+
+namespace {
+
+    /**
+     * A stream buffer which only counts the bytes written to it.
+     */
+    class CountingBuffer : public std::streambuf {
+    public:
+        size_t bytes = 0;
+
+    protected:
+        std::streamsize xsputn(const char*, std::streamsize count) override {
+            bytes += static_cast<size_t>(count);
+            return count;
+        }
+
+        int_type overflow(int_type character) override {
+            if (!traits_type::eq_int_type(character, traits_type::eof())) {
+                bytes++;
+            }
+            return traits_type::not_eof(character);
+        }
+    };
+}
+
+laplacian::RateController::RateController(const LaplacianPyramid& pyramid) :
+        _pyramid(pyramid),
+        _planes(),
+        _candidates(pyramid.levels()),
+        _gains(pyramid.levels()) {
+
+    if (pyramid._quantization != 0 || pyramid._laplacianPlanesQuantized.empty() ||
+        types::planeType(types::imageType(pyramid.planeType())) != pyramid.planeType()) {
+        throw LaplacianPyramidException{"Only unquantized pyramids of laplacian planes can be controlled!"};
+    }
+
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+        _planes.push_back(LaplacianPyramid::fullPrecision(pyramid.at(level)));
+    }
+
+    // The expansion of white noise multiplies its energy by 4 * sum(w^2) per dimension.
+    const double gain = std::pow(4.0 * cv::norm(pyramid._kernel, cv::NORM_L2SQR), 2.0);
+    for (size_t level = 0; level < _gains.size(); level++) {
+        _gains.at(level) = std::pow(gain, static_cast<double>(level));
+    }
+
+    std::vector<std::pair<size_t, float>> tasks;
+    for (size_t level = 0; level < _planes.size(); level++) {
+
+        const std::vector<float> steps = candidateSteps(_planes.at(level));
+        _candidates.at(level).resize(steps.size());
+        for (const float step : steps) {
+            tasks.emplace_back(level, step);
+        }
+    }
+
+    std::vector<size_t> first(_planes.size());
+    for (size_t task = 1; task < tasks.size(); task++) {
+        if (tasks.at(task).first != tasks.at(task - 1).first) {
+            first.at(tasks.at(task).first) = task;
+        }
+    }
+
+    const auto measureTask = [&](int task) {
+
+        const size_t level = tasks.at(task).first;
+        _candidates.at(level).at(task - first.at(level)) = measure(_planes.at(level), tasks.at(task).second);
+    };
+
+    if (pyramid._executor) {
+        pyramid._executor->parallelFor(static_cast<int>(tasks.size()), measureTask);
+    } else {
+        for (size_t task = 0; task < tasks.size(); task++) {
+            measureTask(static_cast<int>(task));
+        }
+    }
+}
+
+laplacian::LaplacianPyramid laplacian::RateController::fitSize(size_t bytes) const {
+
+    const double budget = static_cast<double>(bytes) * 8.0;
+    double target = budget;
+    std::optional<LaplacianPyramid> best;
+    size_t bestBytes = 0;
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+
+        LaplacianPyramid result = quantize(steps(chooseBits(target)));
+        const size_t actual = serializedBytes(result);
+
+        if (actual <= bytes && (!best || actual > bestBytes)) {
+            best = std::move(result);
+            bestBytes = actual;
+        }
+        if (actual <= bytes && static_cast<double>(actual) >= static_cast<double>(bytes) * (1.0 - TOLERANCE)) {
+            break;
+        }
+
+        // The entropy misses the run lengths of the coder and the headers, so the estimate is scaled by the miss.
+        target *= budget / (static_cast<double>(actual) * 8.0);
+    }
+
+    if (best) {
+        return *best;
+    }
+
+    LaplacianPyramid coarsest = quantize(steps(std::vector<size_t>(_candidates.size(), 0)));
+    if (serializedBytes(coarsest) > bytes) {
+        throw LaplacianPyramidException{"The pyramid does not fit into the budget with any quantization!"};
+    }
+    return coarsest;
+}
+
+laplacian::LaplacianPyramid laplacian::RateController::fitPsnr(double psnr, double peak) const {
+
+    const cv::Mat reference = _pyramid.decode();
+    const double allowed = peak * peak / std::pow(10.0, psnr / 10.0) *
+                           static_cast<double>(reference.total() * reference.channels());
+    double target = allowed;
+    std::optional<LaplacianPyramid> best;
+    double bestError = 0.0;
+
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; attempt++) {
+
+        LaplacianPyramid result = quantize(steps(chooseError(target)));
+        const double actual = cv::norm(result.decode(), reference, cv::NORM_L2SQR);
+
+        if (actual <= allowed && (!best || actual > bestError)) {
+            best = std::move(result);
+            bestError = actual;
+        }
+        if (actual <= allowed && actual >= allowed * (1.0 - TOLERANCE)) {
+            break;
+        }
+
+        // Errors of neighbouring levels are not independent, so the estimate is scaled by the miss.
+        target *= actual > 0.0 ? allowed / actual : 2.0;
+    }
+
+    if (best) {
+        return *best;
+    }
+
+    // The finest steps do not quantize floating point planes and keep integer planes.
+    std::vector<size_t> finest;
+    for (const std::vector<Candidate>& candidates : _candidates) {
+        finest.push_back(candidates.size() - 1);
+    }
+    return quantize(steps(finest));
+}
+
+laplacian::LaplacianPyramid laplacian::RateController::quantize(const std::vector<float>& steps) const {
+
+    if (steps.size() != _planes.size()) {
+        throw LaplacianPyramidException{"There has to be one quantization step per level!"};
+    }
+
+    std::vector<cv::Mat> planes;
+    std::vector<float> applied;
+    for (size_t level = 0; level < _planes.size(); level++) {
+
+        float step = steps.at(level);
+        if (!(std::isfinite(step) && step >= 0.0f)) {
+            throw LaplacianPyramidException{"The quantization steps must not be negative!"};
+        }
+
+        const cv::Mat& plane = _planes.at(level);
+        if (step > 0.0f && types::isFixedPoint(plane.type())) {
+            step = std::max(1.0f, std::round(step));
+        }
+
+        if (step > 0.0f) {
+            planes.push_back(plane.clone());
+            LaplacianPyramid::quantizePlane(planes.back(), step);
+        } else {
+            planes.push_back(plane);
+        }
+        applied.push_back(step);
+    }
+
+    // The largest step marks the pyramid as quantized, the steps of the levels are kept beside it.
+    const float quantization = *std::max_element(applied.begin(), applied.end());
+    LaplacianPyramid result{planes, _pyramid._imageSize, _pyramid._kernel, quantization, _pyramid._executor};
+    result._profiler = _pyramid._profiler;
+    result._precision = _pyramid._precision;
+    result.keepSteps(applied);
+    result.storePlanes(planes, true);
+    return result;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+std::vector<size_t> laplacian::RateController::choose(double multiplier) const {
+
+    std::vector<size_t> choice;
+    for (size_t level = 0; level < _candidates.size(); level++) {
+
+        // The candidates get finer, so a tie keeps the coarser step with less bits.
+        const std::vector<Candidate>& candidates = _candidates.at(level);
+        size_t chosen = 0;
+        double least = std::numeric_limits<double>::infinity();
+        for (size_t index = 0; index < candidates.size(); index++) {
+
+            const double cost = candidates.at(index).error * _gains.at(level) + multiplier * candidates.at(index).bits;
+            if (cost < least) {
+                least = cost;
+                chosen = index;
+            }
+        }
+        choice.push_back(chosen);
+    }
+    return choice;
+}
+
+std::vector<size_t> laplacian::RateController::chooseBits(double bits) const {
+
+    if (this->bits(choose(0.0)) <= bits) {
+        return choose(0.0);
+    }
+
+    // A higher multiplier spends less bits. The bounds are widened until they enclose the budget.
+    double high = 1.0;
+    while (this->bits(choose(high)) > bits) {
+        if (high > 1e300) {
+            return std::vector<size_t>(_candidates.size(), 0);
+        }
+        high *= 16.0;
+    }
+    double low = high;
+    while (low > 1e-300 && this->bits(choose(low)) <= bits) {
+        low /= 16.0;
+    }
+
+    for (int iteration = 0; iteration < SEARCH_ITERATIONS; iteration++) {
+
+        const double middle = std::sqrt(low * high);
+        if (this->bits(choose(middle)) <= bits) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
+    return choose(high);
+}
+
+std::vector<size_t> laplacian::RateController::chooseError(double error) const {
+
+    const std::vector<size_t> coarsest(_candidates.size(), 0);
+    if (this->error(coarsest) <= error) {
+        return coarsest;
+    }
+
+    // A lower multiplier spends more bits on less error. The bounds are widened until they enclose the error.
+    double low = 1.0;
+    while (this->error(choose(low)) > error) {
+        if (low < 1e-300) {
+            return choose(0.0);
+        }
+        low /= 16.0;
+    }
+    double high = low;
+    while (high < 1e300 && this->error(choose(high)) <= error) {
+        high *= 16.0;
+    }
+
+    for (int iteration = 0; iteration < SEARCH_ITERATIONS; iteration++) {
+
+        const double middle = std::sqrt(low * high);
+        if (this->error(choose(middle)) <= error) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return choose(low);
+}
+
+double laplacian::RateController::bits(const std::vector<size_t>& choice) const {
+
+    double bits = 0.0;
+    for (size_t level = 0; level < choice.size(); level++) {
+        bits += _candidates.at(level).at(choice.at(level)).bits;
+    }
+    return bits;
+}
+
+double laplacian::RateController::error(const std::vector<size_t>& choice) const {
+
+    double error = 0.0;
+    for (size_t level = 0; level < choice.size(); level++) {
+        error += _candidates.at(level).at(choice.at(level)).error * _gains.at(level);
+    }
+    return error;
+}
+
+std::vector<float> laplacian::RateController::steps(const std::vector<size_t>& choice) const {
+
+    std::vector<float> steps;
+    for (size_t level = 0; level < choice.size(); level++) {
+        steps.push_back(_candidates.at(level).at(choice.at(level)).step);
+    }
+    return steps;
+}
+
+std::vector<float> laplacian::RateController::candidateSteps(const cv::Mat& plane) {
+
+    double minimum;
+    double maximum;
+    cv::minMaxLoc(plane.reshape(1), &minimum, &maximum);
+    const double largest = std::max(std::abs(minimum), std::abs(maximum));
+    const bool fixedPoint = types::isFixedPoint(plane.type());
+
+    if (largest == 0.0) {
+        return {fixedPoint ? 1.0f : 0.0f};
+    }
+
+    // The coarsest step puts every value into the zero bin, integer bins round half away from zero.
+    const double coarsest = fixedPoint ? 2.0 * largest + 1.0 : 2.0 * largest;
+    const double finest = largest / MAX_BINS;
+
+    std::vector<float> steps;
+    for (int index = 0; ; index++) {
+
+        double step = coarsest * std::exp2(-static_cast<double>(index) / STEPS_PER_OCTAVE);
+        if (fixedPoint) {
+
+            step = std::max(1.0, std::round(step));
+            if (steps.empty() || static_cast<float>(step) < steps.back()) {
+                steps.push_back(static_cast<float>(step));
+            }
+            if (step == 1.0) {
+                break;
+            }
+        } else {
+
+            if (step < finest) {
+                break;
+            }
+            steps.push_back(static_cast<float>(step));
+        }
+    }
+
+    if (!fixedPoint) {
+        steps.push_back(0.0f);
+    }
+    return steps;
+}
+
+laplacian::RateController::Candidate laplacian::RateController::measure(const cv::Mat& plane, float step) {
+
+    const int width = plane.cols * plane.channels();
+    const double values = static_cast<double>(plane.rows) * width;
+
+    // Unquantized floating point planes are stored raw.
+    if (step == 0.0f) {
+        return Candidate{step, values * 32.0, 0.0};
+    }
+
+    double minimum;
+    double maximum;
+    cv::minMaxLoc(plane.reshape(1), &minimum, &maximum);
+    const int largest = static_cast<int>(std::ceil(std::max(std::abs(minimum), std::abs(maximum)) / step)) + 1;
+
+    std::vector<int> indices(width);
+    std::vector<uint32_t> histogram(2 * static_cast<size_t>(largest) + 1);
+    double error = 0.0;
+
+    for (int i = 0; i < plane.rows; i++) {
+
+        switch (plane.depth()) {
+            case CV_32F:
+                error += binRow(plane.ptr<float>(i), width, step, indices.data());
+                break;
+            case CV_16S:
+                error += binRow(plane.ptr<short>(i), width, step, indices.data());
+                break;
+            default:
+                error += binRow(plane.ptr<int>(i), width, step, indices.data());
+                break;
+        }
+
+        for (const int index : indices) {
+            histogram[std::clamp(index, -largest, largest) + largest]++;
+        }
+    }
+
+    // The entropy of the bin indices is the size of an ideal coding of the indices one by one.
+    double bits = 0.0;
+    for (const uint32_t count : histogram) {
+        if (count > 0) {
+            bits += count * std::log2(values / count);
+        }
+    }
+    return Candidate{step, bits, error};
+}
+
+template<class T>
+double laplacian::RateController::binRow(const T* row, int width, float step, int* indices) {
+
+    double error = 0.0;
+
+    if constexpr (std::is_floating_point<T>::value) {
+
+        int j = 0;
+#if CV_SIMD
+        const int lanes = cv::v_float32::nlanes;
+        const cv::v_float32 steps = cv::vx_setall_f32(step);
+        cv::v_float32 sum = cv::vx_setzero_f32();
+        for (; j <= width - lanes; j += lanes) {
+
+            const cv::v_float32 value = cv::vx_load(row + j);
+            const cv::v_int32 index = cv::v_round(value / steps);
+            cv::v_store(indices + j, index);
+            const cv::v_float32 difference = value - cv::v_cvt_f32(index) * steps;
+            sum = cv::v_muladd(difference, difference, sum);
+        }
+        error = cv::v_reduce_sum(sum);
+#endif
+        for (; j < width; j++) {
+
+            indices[j] = cv::saturate_cast<int>(row[j] / step);
+            const float difference = row[j] - static_cast<float>(indices[j]) * step;
+            error += difference * difference;
+        }
+
+    } else {
+
+        const int64_t integerStep = cvRound(step);
+        const int64_t half = integerStep / 2;
+        for (int j = 0; j < width; j++) {
+
+            const int64_t value = row[j];
+            const int64_t bin = value >= 0 ? (value + half) / integerStep : -((half - value) / integerStep);
+            indices[j] = static_cast<int>(bin);
+            const auto difference = static_cast<double>(value - bin * integerStep);
+            error += difference * difference;
+        }
+    }
+
+    return error;
+}
+
+size_t laplacian::RateController::serializedBytes(const LaplacianPyramid& pyramid) {
+
+    CountingBuffer buffer;
+    std::ostream stream(&buffer);
+    pyramid.serialize(stream);
+    return buffer.bytes;
+}
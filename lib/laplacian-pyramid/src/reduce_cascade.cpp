@@ -0,0 +1,61 @@
+#include "reduce_cascade.hpp"
+
+#include <algorithm>
+
+laplacian::ReduceCascade::ReduceCascade(const cv::Mat& kernel) : _engine(kernel) {
+}
+
+void laplacian::ReduceCascade::apply(std::vector<cv::Mat>& gaussians, std::vector<StageTimer>& timers) const {
+
+    if (gaussians.size() < 2) {
+        return;
+    }
+
+    // The rings and the known rows only grow, so steady state encoding does not allocate.
+    thread_local std::vector<ReduceEngine::Ring> rings;
+    thread_local std::vector<int> known;
+    rings.resize(std::max(rings.size(), gaussians.size() - 1));
+    known.resize(std::max(known.size(), gaussians.size()));
+    std::fill_n(known.begin(), gaussians.size(), 0);
+    for (size_t level = 1; level < gaussians.size(); level++) {
+        rings.at(level - 1).reset(gaussians.at(level).cols * gaussians.at(level).channels());
+    }
+
+    const cv::Mat& image = gaussians.front();
+    const size_t rowBytes = image.cols * image.elemSize();
+    const int tileRows = std::max(MIN_TILE_ROWS, static_cast<int>(TILE_BYTES / std::max<size_t>(rowBytes, 1)));
+
+    while (known.front() < image.rows) {
+
+        known.front() = std::min(image.rows, known.front() + tileRows);
+
+        for (size_t level = 1; level < gaussians.size(); level++) {
+
+            const cv::Mat& source = gaussians.at(level - 1);
+            cv::Mat& reduced = gaussians.at(level);
+            const int rows = reducibleRows(known.at(level - 1), source.rows, reduced.rows);
+
+            if (rows > known.at(level)) {
+
+                StageTimer& timer = timers.at(level - 1);
+                timer.resume();
+                _engine.apply(source, reduced, known.at(level), rows, rings.at(level - 1));
+                timer.pause();
+                known.at(level) = rows;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+int laplacian::ReduceCascade::reducibleRows(int known, int sourceRows, int rows) {
+
+    // The row i needs the source rows up to 2i + 2, clamped to the last row.
+    if (known >= sourceRows) {
+        return rows;
+    }
+    return std::min(rows, std::max(0, (known - 1) / 2));
+}
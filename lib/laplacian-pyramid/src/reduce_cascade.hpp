@@ -0,0 +1,68 @@
+#pragma once
+
+#include "reduce_engine.hpp"
+#include "stage_timer.hpp"
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Reduces an image to all levels of a gaussian pyramid in one pass over the image.
+     *
+     * Reducing level by level streams every level through the memory twice, once written and once read by the next
+     * level, and a large image does not fit into the cache. The cascade walks the image in tiles of rows which fit
+     * into the L2 cache. After every tile, every level computes as many rows as the rows of the level below allow,
+     * so a row is read by the next level while it is still in the cache. The horizontally reduced rows of every
+     * level are kept between the tiles in a #laplacian::ReduceEngine::Ring, so the halo rows a tile shares with
+     * the tile before are not filtered again. The result is exactly the result of #laplacian::ReduceEngine applied
+     * level by level.
+     * Only CV_32F images with one to four channels are supported.
+     */
+    class ReduceCascade {
+    public:
+
+        /**
+         *
+         * Creates a cascade for the given generating kernel.
+         *
+         * @param kernel The one dimensional generating kernel "w" with 5 taps.
+         */
+        explicit ReduceCascade(const cv::Mat& kernel);
+
+        /**
+         *
+         * Reduces the first gaussian into all following gaussians. The gaussians have to be allocated with the
+         * expected sizes and the type of the first gaussian.
+         *
+         * @param gaussians The image followed by its reductions, one per level.
+         * @param timers The paused timers of the levels from level 1 on, resumed while their level is reduced.
+         */
+        void apply(std::vector<cv::Mat>& gaussians, std::vector<StageTimer>& timers) const;
+
+    private:
+
+        /**
+         * The bytes of the image a tile should hold, half of a common L2 cache.
+         */
+        static const size_t TILE_BYTES = 256 * 1024;
+        static const int MIN_TILE_ROWS = 8;
+
+        ReduceEngine _engine;
+
+        /**
+         *
+         * Gets the amount of rows of a reduced image whose source rows are known.
+         *
+         * @param known The amount of rows of the source image computed so far.
+         * @param sourceRows The amount of rows of the source image.
+         * @param rows The amount of rows of the reduced image.
+         *
+         * @return The amount of rows which can be reduced.
+         */
+        [[nodiscard]] static int reducibleRows(int known, int sourceRows, int rows);
+    };
+}
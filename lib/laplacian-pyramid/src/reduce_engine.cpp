@@ -0,0 +1,71 @@
+#include "reduce_engine.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+#include <vector>
+
+laplacian::ReduceEngine::ReduceEngine(const cv::Mat& kernel) : _weights(), _kernels(&kernels::kernelTable()) {
+
+    if (kernel.total() != TAPS || kernel.type() != CV_32F) {
+        throw LaplacianPyramidException{"The generating kernel has to have 5 taps and be CV_32F encoded!"};
+    }
+
+    for (int tap = 0; tap < TAPS; tap++) {
+        _weights[tap] = kernel.at<float>(tap);
+    }
+}
+
+void laplacian::ReduceEngine::apply(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const {
+
+    // The ring only grows, so steady state encoding and decoding do not allocate.
+    thread_local Ring ring;
+    ring.reset(reduced.cols * image.channels());
+    apply(image, reduced, rowBegin, rowEnd, ring);
+}
+
+void laplacian::ReduceEngine::apply(const cv::Mat& image,
+                                    cv::Mat& reduced,
+                                    int rowBegin,
+                                    int rowEnd,
+                                    Ring& ring) const {
+
+    const int channels = image.channels();
+    if (image.depth() != CV_32F || channels > MAX_CHANNELS || reduced.type() != image.type()) {
+        throw LaplacianPyramidException{"The images have to be CV_32F encoded with up to four channels!"};
+    }
+
+    const int cols = reduced.cols;
+    const int width = cols * channels;
+
+    // Every output row needs the source rows 2i - 2 to 2i + 2, which are distinct modulo the ring size even if the
+    // last ones are clamped to the last row of the image.
+    const auto horizontal = [&](int row) -> const float* {
+
+        const int slot = row % TAPS;
+        float* line = ring.lines.data() + slot * width;
+        if (ring.rows[slot] != row) {
+            reduceHorizontally(image.ptr<float>(row), image.cols, channels, line, cols);
+            ring.rows[slot] = row;
+        }
+        return line;
+    };
+
+    for (int i = rowBegin; i < rowEnd; i++) {
+        reduceVertically(i, image.rows, horizontal, reduced.ptr<float>(i), width);
+    }
+}
+
+void laplacian::ReduceEngine::reduceHorizontally(const float* source,
+                                                 int length,
+                                                 int channels,
+                                                 float* target,
+                                                 int cols) const {
+
+    _kernels->reduceRow(source, length, channels, target, cols, _weights);
+}
+
+void laplacian::ReduceEngine::Ring::reset(int width) {
+
+    lines.resize(std::max(lines.size(), static_cast<size_t>(TAPS * width)));
+    std::fill(std::begin(rows), std::end(rows), -1);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "cpu_dispatch.hpp"
+#include "row_kernels.hpp"
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * Applies the REDUCE operation of the paper "The Laplacian Pyramid as a Compact Image Code" by two
+     * separable passes of the generating kernel "w".
+     *
+     * A horizontal pass filters and decimates every needed source row by 5 taps. A vertical pass combines
+     * the 5 horizontally reduced rows of every output pixel. The horizontally reduced rows are kept in a ring,
+     * so every source row is filtered once. Taps in front of the image are dropped and taps behind the image
+     * are clamped to the last row or column. Both are handled in prologue and epilogue loops, the interior
+     * runs without branches and is vectorized. The horizontal pass is instantiated with compile time weights for
+     * the common kernels, see #laplacian::kernels::withWeights. Both passes run the kernels of the instruction set
+     * selected at load, see #laplacian::cpuLevel.
+     */
+    class ReduceEngine {
+    private:
+        static const int TAPS = 5;
+
+    public:
+
+        /**
+         * The horizontally reduced source rows of #apply, row r in the slot r % 5. A ring which is passed to
+         * consecutive calls keeps the rows the calls share, so they are filtered once.
+         */
+        struct Ring {
+            std::vector<float> lines;
+            int rows[TAPS] = {-1, -1, -1, -1, -1};
+
+            /**
+             *
+             * Empties the ring for rows of the given amount of values. The lines only grow.
+             *
+             * @param width The amount of values of a horizontally reduced row.
+             */
+            void reset(int width);
+        };
+
+        /**
+         *
+         * Creates an engine for the given generating kernel.
+         *
+         * @param kernel The one dimensional generating kernel "w" with 5 taps.
+         */
+        explicit ReduceEngine(const cv::Mat& kernel);
+
+        /**
+         *
+         * Reduces the given image into the rows [rowBegin, rowEnd) of the given reduced image.
+         * The image has to be CV_32F encoded with one to four interleaved channels. The reduced image has to be
+         * allocated with the expected size and the type of the image.
+         *
+         * @param image The image to reduce.
+         * @param reduced The target of the reduction.
+         * @param rowBegin The first row of the reduced image to compute.
+         * @param rowEnd The row behind the last row of the reduced image to compute.
+         */
+        void apply(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd) const;
+
+        /**
+         *
+         * Reduces like #apply and keeps the horizontally reduced rows in the given ring. The ring has to be reset for
+         * the reduced image before the first call, the calls have to compute the rows in ascending order.
+         *
+         * @param image The image to reduce.
+         * @param reduced The target of the reduction.
+         * @param rowBegin The first row of the reduced image to compute.
+         * @param rowEnd The row behind the last row of the reduced image to compute.
+         * @param ring The horizontally reduced rows of the image.
+         */
+        void apply(const cv::Mat& image, cv::Mat& reduced, int rowBegin, int rowEnd, Ring& ring) const;
+
+        /**
+         *
+         * Filters and decimates one row of pixels horizontally. This is the horizontal pass of #apply.
+         *
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param channels The amount of interleaved channels, one to four.
+         * @param target The horizontally reduced row.
+         * @param cols The length of the reduced row in pixels.
+         */
+        void reduceHorizontally(const float* source, int length, int channels, float* target, int cols) const;
+
+        /**
+         *
+         * Combines the horizontally reduced source rows of one reduced row. This is the vertical pass of #apply.
+         *
+         * @tparam Horizontal A callable of the signature const float*(int).
+         * @param row The row of the reduced image.
+         * @param sourceRows The amount of rows of the source image.
+         * @param horizontal Gets the horizontally reduced source row of the given index.
+         * @param target The reduced row.
+         * @param width The amount of values of the reduced row, its columns times its channels.
+         */
+        template<class Horizontal>
+        void reduceVertically(int row, int sourceRows, const Horizontal& horizontal, float* target, int width) const;
+
+    private:
+        static const int MAX_CHANNELS = 4;
+
+        float _weights[TAPS];
+
+        /**
+         * The kernels selected when the engine is created, see #laplacian::kernels::kernelTable.
+         */
+        const kernels::KernelTable* _kernels;
+    };
+
+    template<class Horizontal>
+    void ReduceEngine::reduceVertically(int row,
+                                        int sourceRows,
+                                        const Horizontal& horizontal,
+                                        float* target,
+                                        int width) const {
+
+        const float* rows[TAPS];
+        float weights[TAPS];
+        int count = 0;
+
+        for (int m = -TAPS / 2; m <= TAPS / 2; m++) {
+
+            const int sourceRow = (row << 1) - m;
+            if (sourceRow >= 0) {
+                rows[count] = horizontal(std::min(sourceRow, sourceRows - 1));
+                weights[count] = _weights[m + TAPS / 2];
+                count++;
+            }
+        }
+
+        const float* base = nullptr;
+        _kernels->combineRows(rows, weights, count, kernels::Accumulation::STORE, base, target, width);
+    }
+}
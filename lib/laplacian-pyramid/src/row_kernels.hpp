@@ -0,0 +1,18 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+namespace laplacian::kernels {
+
+    /**
+     * How a combined row is written to its target.
+     */
+    enum class Accumulation {
+        /** target = sum */
+        STORE,
+        /** target = base + sum */
+        ADD,
+        /** target = base - sum */
+        SUBTRACT
+    };
+}
@@ -0,0 +1,618 @@
+#pragma once
+
+#include "cpu_dispatch.hpp"
+#include "kernel_weights.hpp"
+#include "row_kernels.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * The row kernels of one #laplacian::CpuLevel. This header is compiled once per level by a translation unit which
+ * names the namespace of the level in LAPLACIAN_PYRAMID_ISA and the level in LAPLACIAN_PYRAMID_LEVEL and gets the
+ * flags of its instruction set, see CMakeLists.txt. The x86 levels also get the CV_CPU_COMPILE_* macros and
+ * CV_CPU_DISPATCH_MODE of OpenCV, so the universal intrinsics are as wide as the instruction set and live in their
+ * own namespace. The scalar level defines LAPLACIAN_PYRAMID_SCALAR and runs the plain loops only.
+ *
+ * Every level computes the same expressions in the same order, and the translation units are compiled without
+ * contracting them to fused multiply-adds, so all levels give bitwise equal results.
+ *
+ * An inline function with external linkage, like std::min or the conversion operator of cv::float16_t, would be
+ * compiled with the flags of every instruction set, and the linker could keep the AVX copy for all callers. So the
+ * kernels call only the universal intrinsics, which live in the namespace of the instruction set, and functions of
+ * their own, which have internal linkage.
+ */
+#ifdef LAPLACIAN_PYRAMID_SCALAR
+#define LAPLACIAN_PYRAMID_SIMD 0
+#define LAPLACIAN_PYRAMID_SIMD128 0
+#else
+#define LAPLACIAN_PYRAMID_SIMD CV_SIMD
+#define LAPLACIAN_PYRAMID_SIMD128 CV_SIMD128
+#endif
+
+namespace laplacian::kernels::LAPLACIAN_PYRAMID_ISA {
+    namespace {
+
+        const int TAPS = 5;
+
+        inline int minimum(int a, int b) {
+            return b < a ? b : a;
+        }
+
+        inline int maximum(int a, int b) {
+            return a < b ? b : a;
+        }
+
+        /**
+         *
+         * Converts a half precision value to single precision, which is exact.
+         *
+         * @param half The bits of the half precision value.
+         *
+         * @return The value.
+         */
+        inline float halfToFloat(uint16_t half) {
+
+            const uint32_t sign = static_cast<uint32_t>(half & 0x8000u) << 16;
+            const uint32_t exponent = (half >> 10) & 0x1fu;
+            uint32_t mantissa = half & 0x3ffu;
+
+            uint32_t bits;
+            if (exponent == 0x1fu) {
+                bits = sign | 0x7f800000u | (mantissa << 13);
+            } else if (exponent != 0) {
+                bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+            } else if (mantissa == 0) {
+                bits = sign;
+            } else {
+                // Subnormal halves are normal floats, the mantissa is shifted until its leading one is implicit.
+                uint32_t normalized = 113;
+                while ((mantissa & 0x400u) == 0) {
+                    mantissa <<= 1;
+                    normalized--;
+                }
+                bits = sign | (normalized << 23) | ((mantissa & 0x3ffu) << 13);
+            }
+
+            float value;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+
+        ////////////////////////////////////////
+        // REDUCE
+        ////////////////////////////////////////
+
+        /**
+         *
+         * Computes a single horizontally reduced pixel with dropped and clamped taps.
+         * Used for the columns at the borders of the image.
+         *
+         * @tparam CN The amount of channels.
+         * @tparam W The weights, see #laplacian::kernels::withWeights.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param center The center tap of the kernel in the source row.
+         * @param target The CN channels of the reduced pixel.
+         * @param weights The weights of the generating kernel.
+         */
+        template<int CN, class W>
+        void reduceAt(const float* source, int length, int center, float* target, const W& weights) {
+
+            float value[CN] = {};
+            for (int n = -TAPS / 2; n <= TAPS / 2; n++) {
+
+                const int col = center - n;
+                if (col >= 0) {
+                    const float* tap = source + minimum(col, length - 1) * CN;
+                    for (int k = 0; k < CN; k++) {
+                        value[k] += weights.taps[n + TAPS / 2] * tap[k];
+                    }
+                }
+            }
+
+            for (int k = 0; k < CN; k++) {
+                target[k] = value[k];
+            }
+        }
+
+        /**
+         *
+         * Filters and decimates one source row of pixels with CN interleaved channels.
+         *
+         * @tparam CN The amount of channels.
+         * @tparam W The weights, see #laplacian::kernels::withWeights.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param target The target row.
+         * @param cols The length of the target row in pixels.
+         * @param weights The weights of the generating kernel.
+         */
+        template<int CN, class W>
+        void reduceRow(const float* source, int length, float* target, int cols, const W& weights) {
+
+            const float w0 = weights.taps[0];
+            const float w1 = weights.taps[1];
+            const float w2 = weights.taps[2];
+            const float w3 = weights.taps[3];
+            const float w4 = weights.taps[4];
+
+            // The interior are all columns whose taps 2j - 2 to 2j + 2 lie inside the source row.
+            const int interiorBegin = minimum(1, cols);
+            const int interiorEnd = maximum(interiorBegin, minimum(cols, (length - 1) / 2));
+
+            int j = 0;
+            for (; j < interiorBegin; j++) {
+                reduceAt<CN>(source, length, j << 1, target + j * CN, weights);
+            }
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            if constexpr (CN == 1) {
+
+                const int lanes = cv::v_float32::nlanes;
+                const cv::v_float32 vw0 = cv::vx_setall_f32(w0);
+                const cv::v_float32 vw1 = cv::vx_setall_f32(w1);
+                const cv::v_float32 vw2 = cv::vx_setall_f32(w2);
+                const cv::v_float32 vw3 = cv::vx_setall_f32(w3);
+                const cv::v_float32 vw4 = cv::vx_setall_f32(w4);
+
+                // The last deinterleaving load reads up to 2 * (j + lanes) + 1.
+                for (; j + lanes <= interiorEnd && ((j + lanes) << 1) + 2 <= length; j += lanes) {
+
+                    const float* tap = source + (j << 1) - 2;
+                    cv::v_float32 even0, odd0, even1, odd1, even2, odd2;
+                    cv::v_load_deinterleave(tap, even0, odd0);
+                    cv::v_load_deinterleave(tap + 2, even1, odd1);
+                    cv::v_load_deinterleave(tap + 4, even2, odd2);
+
+                    cv::v_store(target + j, vw0 * even2 + vw1 * odd1 + vw2 * even1 + vw3 * odd0 + vw4 * even0);
+                }
+                cv::vx_cleanup();
+            }
+    #endif
+
+    #if LAPLACIAN_PYRAMID_SIMD128
+            if constexpr (CN == 4) {
+
+                // One pixel with its four channels fills a 128 bit register.
+                const cv::v_float32x4 vw0 = cv::v_setall_f32(w0);
+                const cv::v_float32x4 vw1 = cv::v_setall_f32(w1);
+                const cv::v_float32x4 vw2 = cv::v_setall_f32(w2);
+                const cv::v_float32x4 vw3 = cv::v_setall_f32(w3);
+                const cv::v_float32x4 vw4 = cv::v_setall_f32(w4);
+
+                for (; j < interiorEnd; j++) {
+
+                    const float* tap = source + (j << 1) * CN;
+                    cv::v_store(target + j * CN, vw0 * cv::v_load(tap + 2 * CN) + vw1 * cv::v_load(tap + CN) +
+                                                 vw2 * cv::v_load(tap) + vw3 * cv::v_load(tap - CN) +
+                                                 vw4 * cv::v_load(tap - 2 * CN));
+                }
+            }
+    #endif
+
+            for (; j < interiorEnd; j++) {
+
+                const float* tap = source + (j << 1) * CN;
+                float* pixel = target + j * CN;
+                for (int k = 0; k < CN; k++) {
+                    pixel[k] = w0 * tap[2 * CN + k] + w1 * tap[CN + k] + w2 * tap[k] + w3 * tap[k - CN] +
+                               w4 * tap[k - 2 * CN];
+                }
+            }
+
+            for (; j < cols; j++) {
+                reduceAt<CN>(source, length, j << 1, target + j * CN, weights);
+            }
+        }
+
+        void reduceRow(const float* source, int length, int channels, float* target, int cols, const float* weights) {
+
+            withWeights<1>(weights, [&](const auto& constant) {
+                switch (channels) {
+                    case 1: reduceRow<1>(source, length, target, cols, constant); break;
+                    case 2: reduceRow<2>(source, length, target, cols, constant); break;
+                    case 3: reduceRow<3>(source, length, target, cols, constant); break;
+                    default: reduceRow<4>(source, length, target, cols, constant); break;
+                }
+            });
+        }
+
+        ////////////////////////////////////////
+        // EXPAND
+        ////////////////////////////////////////
+
+        /**
+         *
+         * Computes a single horizontally expanded pixel with dropped and clamped taps.
+         * Used for the columns at the borders of the image.
+         *
+         * @tparam CN The amount of channels.
+         * @tparam W The weights, see #laplacian::kernels::withWeights.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param col The column of the expanded pixel.
+         * @param target The CN channels of the expanded pixel.
+         * @param weights The doubled weights of the generating kernel.
+         */
+        template<int CN, class W>
+        void expandAt(const float* source, int length, int col, float* target, const W& weights) {
+
+            const int q = col >> 1;
+            const int last = length - 1;
+            const float* next = source + minimum(q + 1, last) * CN;
+            const float* center = source + minimum(q, last) * CN;
+
+            if ((col & 1) == 0) {
+
+                const float* previous = q > 0 ? source + minimum(q - 1, last) * CN : nullptr;
+                for (int k = 0; k < CN; k++) {
+                    float value = weights.taps[0] * next[k] + weights.taps[2] * center[k];
+                    if (previous) {
+                        value += weights.taps[4] * previous[k];
+                    }
+                    target[k] = value;
+                }
+                return;
+            }
+
+            for (int k = 0; k < CN; k++) {
+                target[k] = weights.taps[1] * next[k] + weights.taps[3] * center[k];
+            }
+        }
+
+        /**
+         *
+         * Expands one source row of pixels with CN interleaved channels horizontally.
+         *
+         * @tparam CN The amount of channels.
+         * @tparam W The weights, see #laplacian::kernels::withWeights.
+         * @param source The source row.
+         * @param length The length of the source row in pixels.
+         * @param target The target row.
+         * @param cols The length of the target row in pixels.
+         * @param weights The doubled weights of the generating kernel.
+         */
+        template<int CN, class W>
+        void expandRow(const float* source, int length, float* target, int cols, const W& weights) {
+
+            const float w0 = weights.taps[0];
+            const float w1 = weights.taps[1];
+            const float w2 = weights.taps[2];
+            const float w3 = weights.taps[3];
+            const float w4 = weights.taps[4];
+
+            // The interior are all source columns q whose neighbours q - 1 and q + 1 lie inside the source row and
+            // whose odd output column 2q + 1 lies inside the target row.
+            const int interiorBegin = minimum(1, cols / 2);
+            const int interiorEnd = maximum(interiorBegin, minimum(length - 1, cols / 2));
+
+            int j = 0;
+            for (; j < (interiorBegin << 1); j++) {
+                expandAt<CN>(source, length, j, target + j * CN, weights);
+            }
+
+            int q = interiorBegin;
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            if constexpr (CN == 1) {
+
+                const int lanes = cv::v_float32::nlanes;
+                const cv::v_float32 vw0 = cv::vx_setall_f32(w0);
+                const cv::v_float32 vw1 = cv::vx_setall_f32(w1);
+                const cv::v_float32 vw2 = cv::vx_setall_f32(w2);
+                const cv::v_float32 vw3 = cv::vx_setall_f32(w3);
+                const cv::v_float32 vw4 = cv::vx_setall_f32(w4);
+
+                for (; q + lanes <= interiorEnd; q += lanes) {
+
+                    const cv::v_float32 previous = cv::vx_load(source + q - 1);
+                    const cv::v_float32 center = cv::vx_load(source + q);
+                    const cv::v_float32 next = cv::vx_load(source + q + 1);
+
+                    cv::v_store_interleave(target + (q << 1),
+                                           vw0 * next + vw2 * center + vw4 * previous,
+                                           vw1 * next + vw3 * center);
+                }
+                cv::vx_cleanup();
+            }
+    #endif
+
+    #if LAPLACIAN_PYRAMID_SIMD128
+            if constexpr (CN == 4) {
+
+                // One pixel with its four channels fills a 128 bit register.
+                const cv::v_float32x4 vw0 = cv::v_setall_f32(w0);
+                const cv::v_float32x4 vw1 = cv::v_setall_f32(w1);
+                const cv::v_float32x4 vw2 = cv::v_setall_f32(w2);
+                const cv::v_float32x4 vw3 = cv::v_setall_f32(w3);
+                const cv::v_float32x4 vw4 = cv::v_setall_f32(w4);
+
+                for (; q < interiorEnd; q++) {
+
+                    const float* tap = source + q * CN;
+                    const cv::v_float32x4 previous = cv::v_load(tap - CN);
+                    const cv::v_float32x4 center = cv::v_load(tap);
+                    const cv::v_float32x4 next = cv::v_load(tap + CN);
+
+                    cv::v_store(target + (q << 1) * CN, vw0 * next + vw2 * center + vw4 * previous);
+                    cv::v_store(target + ((q << 1) + 1) * CN, vw1 * next + vw3 * center);
+                }
+            }
+    #endif
+
+            for (; q < interiorEnd; q++) {
+
+                const float* tap = source + q * CN;
+                float* even = target + (q << 1) * CN;
+                float* odd = even + CN;
+                for (int k = 0; k < CN; k++) {
+                    even[k] = w0 * tap[CN + k] + w2 * tap[k] + w4 * tap[k - CN];
+                    odd[k] = w1 * tap[CN + k] + w3 * tap[k];
+                }
+            }
+
+            for (j = interiorEnd << 1; j < cols; j++) {
+                expandAt<CN>(source, length, j, target + j * CN, weights);
+            }
+        }
+
+        void expandRow(const float* source, int length, int channels, float* target, int cols, const float* weights) {
+
+            withWeights<2>(weights, [&](const auto& constant) {
+                switch (channels) {
+                    case 1: expandRow<1>(source, length, target, cols, constant); break;
+                    case 2: expandRow<2>(source, length, target, cols, constant); break;
+                    case 3: expandRow<3>(source, length, target, cols, constant); break;
+                    default: expandRow<4>(source, length, target, cols, constant); break;
+                }
+            });
+        }
+
+        ////////////////////////////////////////
+        // COMBINE
+        ////////////////////////////////////////
+
+        inline float load(const float* base, int j) {
+            return base[j];
+        }
+
+        inline float load(const cv::float16_t* base, int j) {
+
+            uint16_t half;
+            std::memcpy(&half, base + j, sizeof(half));
+            return halfToFloat(half);
+        }
+
+    #if LAPLACIAN_PYRAMID_SIMD
+        inline cv::v_float32 vectorLoad(const float* base, int j) {
+            return cv::vx_load(base + j);
+        }
+
+        inline cv::v_float32 vectorLoad(const cv::float16_t* base, int j) {
+            return cv::vx_load_expand(base + j);
+        }
+    #endif
+
+        struct Store {
+
+            template<class Base>
+            static float apply(const Base*, int, float sum) {
+                return sum;
+            }
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            template<class Base>
+            static cv::v_float32 apply(const Base*, int, const cv::v_float32& sum) {
+                return sum;
+            }
+    #endif
+        };
+
+        struct Add {
+
+            template<class Base>
+            static float apply(const Base* base, int j, float sum) {
+                return load(base, j) + sum;
+            }
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            template<class Base>
+            static cv::v_float32 apply(const Base* base, int j, const cv::v_float32& sum) {
+                return vectorLoad(base, j) + sum;
+            }
+    #endif
+        };
+
+        struct Subtract {
+
+            template<class Base>
+            static float apply(const Base* base, int j, float sum) {
+                return load(base, j) - sum;
+            }
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            template<class Base>
+            static cv::v_float32 apply(const Base* base, int j, const cv::v_float32& sum) {
+                return vectorLoad(base, j) - sum;
+            }
+    #endif
+        };
+
+        template<class Output, class Base>
+        void combine(const float* const* rows,
+                     const float* weights,
+                     int count,
+                     const Base* base,
+                     float* target,
+                     int cols) {
+
+            int j = 0;
+
+            if (count == 2) {
+
+                const float* r0 = rows[0];
+                const float* r1 = rows[1];
+
+    #if LAPLACIAN_PYRAMID_SIMD
+                const int lanes = cv::v_float32::nlanes;
+                const cv::v_float32 vw0 = cv::vx_setall_f32(weights[0]);
+                const cv::v_float32 vw1 = cv::vx_setall_f32(weights[1]);
+
+                for (; j + lanes <= cols; j += lanes) {
+                    const cv::v_float32 sum = vw0 * cv::vx_load(r0 + j) + vw1 * cv::vx_load(r1 + j);
+                    cv::v_store(target + j, Output::apply(base, j, sum));
+                }
+                cv::vx_cleanup();
+    #endif
+
+                for (; j < cols; j++) {
+                    target[j] = Output::apply(base, j, weights[0] * r0[j] + weights[1] * r1[j]);
+                }
+                return;
+            }
+
+            if (count == 3) {
+
+                const float* r0 = rows[0];
+                const float* r1 = rows[1];
+                const float* r2 = rows[2];
+
+    #if LAPLACIAN_PYRAMID_SIMD
+                const int lanes = cv::v_float32::nlanes;
+                const cv::v_float32 vw0 = cv::vx_setall_f32(weights[0]);
+                const cv::v_float32 vw1 = cv::vx_setall_f32(weights[1]);
+                const cv::v_float32 vw2 = cv::vx_setall_f32(weights[2]);
+
+                for (; j + lanes <= cols; j += lanes) {
+                    const cv::v_float32 sum = vw0 * cv::vx_load(r0 + j) + vw1 * cv::vx_load(r1 + j) +
+                                              vw2 * cv::vx_load(r2 + j);
+                    cv::v_store(target + j, Output::apply(base, j, sum));
+                }
+                cv::vx_cleanup();
+    #endif
+
+                for (; j < cols; j++) {
+                    target[j] = Output::apply(base, j, weights[0] * r0[j] + weights[1] * r1[j] + weights[2] * r2[j]);
+                }
+                return;
+            }
+
+            if (count == 5) {
+
+                const float* r0 = rows[0];
+                const float* r1 = rows[1];
+                const float* r2 = rows[2];
+                const float* r3 = rows[3];
+                const float* r4 = rows[4];
+
+    #if LAPLACIAN_PYRAMID_SIMD
+                const int lanes = cv::v_float32::nlanes;
+                const cv::v_float32 vw0 = cv::vx_setall_f32(weights[0]);
+                const cv::v_float32 vw1 = cv::vx_setall_f32(weights[1]);
+                const cv::v_float32 vw2 = cv::vx_setall_f32(weights[2]);
+                const cv::v_float32 vw3 = cv::vx_setall_f32(weights[3]);
+                const cv::v_float32 vw4 = cv::vx_setall_f32(weights[4]);
+
+                for (; j + lanes <= cols; j += lanes) {
+                    const cv::v_float32 sum = vw0 * cv::vx_load(r0 + j) + vw1 * cv::vx_load(r1 + j) +
+                                              vw2 * cv::vx_load(r2 + j) + vw3 * cv::vx_load(r3 + j) +
+                                              vw4 * cv::vx_load(r4 + j);
+                    cv::v_store(target + j, Output::apply(base, j, sum));
+                }
+                cv::vx_cleanup();
+    #endif
+
+                for (; j < cols; j++) {
+                    target[j] = Output::apply(base, j, weights[0] * r0[j] + weights[1] * r1[j] + weights[2] * r2[j] +
+                                                       weights[3] * r3[j] + weights[4] * r4[j]);
+                }
+                return;
+            }
+
+            for (; j < cols; j++) {
+
+                float sum = 0.0f;
+                for (int k = 0; k < count; k++) {
+                    sum += weights[k] * rows[k][j];
+                }
+                target[j] = Output::apply(base, j, sum);
+            }
+        }
+
+        template<class Base>
+        void combineAs(const float* const* rows,
+                       const float* weights,
+                       int count,
+                       Accumulation accumulation,
+                       const Base* base,
+                       float* target,
+                       int cols) {
+
+            switch (accumulation) {
+                case Accumulation::STORE:
+                    combine<Store>(rows, weights, count, base, target, cols);
+                    break;
+                case Accumulation::ADD:
+                    combine<Add>(rows, weights, count, base, target, cols);
+                    break;
+                case Accumulation::SUBTRACT:
+                    combine<Subtract>(rows, weights, count, base, target, cols);
+                    break;
+            }
+        }
+
+        void combineRows(const float* const* rows,
+                         const float* weights,
+                         int count,
+                         Accumulation accumulation,
+                         const float* base,
+                         float* target,
+                         int cols) {
+
+            combineAs(rows, weights, count, accumulation, base, target, cols);
+        }
+
+        void combineHalfRows(const float* const* rows,
+                             const float* weights,
+                             int count,
+                             Accumulation accumulation,
+                             const cv::float16_t* base,
+                             float* target,
+                             int cols) {
+
+            combineAs(rows, weights, count, accumulation, base, target, cols);
+        }
+
+        ////////////////////////////////////////
+        // QUANTIZE
+        ////////////////////////////////////////
+
+        void quantizeRow(float* row, int width, float step) {
+
+            int j = 0;
+
+    #if LAPLACIAN_PYRAMID_SIMD
+            // Rounds to the nearest bin like cvRound, ties to even.
+            const int lanes = cv::v_float32::nlanes;
+            const cv::v_float32 steps = cv::vx_setall_f32(step);
+            for (; j + lanes <= width; j += lanes) {
+                const cv::v_float32 value = cv::vx_load(row + j);
+                cv::v_store(row + j, cv::v_cvt_f32(cv::v_round(value / steps)) * steps);
+            }
+            cv::vx_cleanup();
+    #endif
+
+            for (; j < width; j++) {
+                row[j] = static_cast<float>(cvRound(row[j] / step)) * step;
+            }
+        }
+
+        /**
+         * The kernels of this level, constant initialized, so reading them runs no code of the instruction set.
+         */
+        const KernelTable TABLE = {LAPLACIAN_PYRAMID_LEVEL, reduceRow, expandRow, combineRows, combineHalfRows,
+                                   quantizeRow};
+    }
+}
@@ -0,0 +1,8 @@
+#define LAPLACIAN_PYRAMID_ISA avx2
+#define LAPLACIAN_PYRAMID_LEVEL laplacian::CpuLevel::AVX2
+
+#include "simd_kernels.hpp"
+
+const laplacian::kernels::KernelTable& laplacian::kernels::avx2Kernels() {
+    return avx2::TABLE;
+}
@@ -0,0 +1,8 @@
+#define LAPLACIAN_PYRAMID_ISA avx512
+#define LAPLACIAN_PYRAMID_LEVEL laplacian::CpuLevel::AVX512
+
+#include "simd_kernels.hpp"
+
+const laplacian::kernels::KernelTable& laplacian::kernels::avx512Kernels() {
+    return avx512::TABLE;
+}
@@ -0,0 +1,8 @@
+#define LAPLACIAN_PYRAMID_ISA baseline
+#define LAPLACIAN_PYRAMID_LEVEL laplacian::CpuLevel::BASELINE
+
+#include "simd_kernels.hpp"
+
+const laplacian::kernels::KernelTable& laplacian::kernels::baselineKernels() {
+    return baseline::TABLE;
+}
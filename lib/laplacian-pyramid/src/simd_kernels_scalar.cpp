@@ -0,0 +1,9 @@
+#define LAPLACIAN_PYRAMID_ISA scalar
+#define LAPLACIAN_PYRAMID_LEVEL laplacian::CpuLevel::SCALAR
+#define LAPLACIAN_PYRAMID_SCALAR
+
+#include "simd_kernels.hpp"
+
+const laplacian::kernels::KernelTable& laplacian::kernels::scalarKernels() {
+    return scalar::TABLE;
+}
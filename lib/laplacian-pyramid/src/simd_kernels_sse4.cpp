@@ -0,0 +1,8 @@
+#define LAPLACIAN_PYRAMID_ISA sse4
+#define LAPLACIAN_PYRAMID_LEVEL laplacian::CpuLevel::SSE4
+
+#include "simd_kernels.hpp"
+
+const laplacian::kernels::KernelTable& laplacian::kernels::sse4Kernels() {
+    return sse4::TABLE;
+}
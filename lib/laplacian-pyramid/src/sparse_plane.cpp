@@ -0,0 +1,209 @@
+#include "sparse_plane.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+
+std::shared_ptr<const laplacian::SparsePlane> laplacian::SparsePlane::compress(const cv::Mat& plane,
+                                                                              double maxOccupancy) {
+
+    std::shared_ptr<SparsePlane> sparse{new SparsePlane(plane.size(), plane.type())};
+    const size_t blocks = static_cast<size_t>(sparse->_blockRows) * sparse->_blockCols;
+    sparse->_occupancy.assign((blocks + WORD_BITS - 1) / WORD_BITS, 0);
+
+    size_t occupied = 0;
+    for (int blockRow = 0; blockRow < sparse->_blockRows; blockRow++) {
+        for (int blockCol = 0; blockCol < sparse->_blockCols; blockCol++) {
+
+            const cv::Mat area = plane(sparse->bounds(blockRow, blockCol));
+            bool nonZero;
+            switch (plane.depth()) {
+                case CV_32F:
+                    nonZero = hasNonZero<float>(area);
+                    break;
+                case CV_16F:
+                    nonZero = hasNonZero<cv::float16_t>(area);
+                    break;
+                case CV_16S:
+                    nonZero = hasNonZero<short>(area);
+                    break;
+                case CV_32S:
+                    nonZero = hasNonZero<int>(area);
+                    break;
+                default:
+                    throw LaplacianPyramidException{"Only CV_32F, CV_16F, CV_16S and CV_32S planes can be sparse!"};
+            }
+
+            if (nonZero) {
+                const size_t index = static_cast<size_t>(blockRow) * sparse->_blockCols + blockCol;
+                sparse->_occupancy.at(index / WORD_BITS) |= uint64_t{1} << (index % WORD_BITS);
+                occupied++;
+            }
+        }
+    }
+
+    if (static_cast<double>(occupied) > maxOccupancy * static_cast<double>(blocks)) {
+        return nullptr;
+    }
+
+    sparse->_ranks.resize(sparse->_occupancy.size());
+    uint32_t rank = 0;
+    for (size_t word = 0; word < sparse->_occupancy.size(); word++) {
+        sparse->_ranks.at(word) = rank;
+        rank += countBits(sparse->_occupancy.at(word));
+    }
+
+    if (occupied == 0) {
+        return sparse;
+    }
+
+    sparse->_blocks.create(static_cast<int>(occupied) * BLOCK_SIZE, BLOCK_SIZE, plane.type());
+    sparse->_blocks.setTo(cv::Scalar::all(0));
+    for (int blockRow = 0; blockRow < sparse->_blockRows; blockRow++) {
+        for (int blockCol = 0; blockCol < sparse->_blockCols; blockCol++) {
+
+            if (sparse->isOccupied(blockRow, blockCol)) {
+                cv::Mat target = sparse->block(blockRow, blockCol);
+                plane(sparse->bounds(blockRow, blockCol)).copyTo(target);
+            }
+        }
+    }
+    return sparse;
+}
+
+cv::Size laplacian::SparsePlane::size() const {
+
+    return _size;
+}
+
+int laplacian::SparsePlane::type() const {
+
+    return _type;
+}
+
+int laplacian::SparsePlane::blockRows() const {
+
+    return _blockRows;
+}
+
+size_t laplacian::SparsePlane::occupiedBlocks() const {
+
+    return rank(static_cast<size_t>(_blockRows) * _blockCols);
+}
+
+size_t laplacian::SparsePlane::bytes() const {
+
+    return _blocks.total() * _blocks.elemSize() + _occupancy.size() * sizeof(uint64_t) +
+           _ranks.size() * sizeof(uint32_t);
+}
+
+bool laplacian::SparsePlane::isOccupied(int blockRow) const {
+
+    const size_t first = static_cast<size_t>(blockRow) * _blockCols;
+    return rank(first + _blockCols) > rank(first);
+}
+
+void laplacian::SparsePlane::decompress(int blockRow, cv::Mat& rows) const {
+
+    rows.create(bounds(blockRow, 0).height, _size.width, _type);
+
+    for (int blockCol = 0; blockCol < _blockCols; blockCol++) {
+
+        const cv::Rect area = bounds(blockRow, blockCol);
+        cv::Mat target = rows(cv::Rect(area.x, 0, area.width, area.height));
+        if (isOccupied(blockRow, blockCol)) {
+            block(blockRow, blockCol).copyTo(target);
+        } else {
+            target.setTo(cv::Scalar::all(0));
+        }
+    }
+}
+
+cv::Mat laplacian::SparsePlane::region(const cv::Rect& region) const {
+
+    cv::Mat dense(region.size(), _type, cv::Scalar::all(0));
+
+    for (int blockRow = region.y / BLOCK_SIZE; blockRow <= (region.br().y - 1) / BLOCK_SIZE; blockRow++) {
+        for (int blockCol = region.x / BLOCK_SIZE; blockCol <= (region.br().x - 1) / BLOCK_SIZE; blockCol++) {
+
+            if (!isOccupied(blockRow, blockCol)) {
+                continue;
+            }
+
+            const cv::Rect area = bounds(blockRow, blockCol);
+            const cv::Rect overlap = area & region;
+            cv::Mat target = dense(overlap - region.tl());
+            block(blockRow, blockCol)(overlap - area.tl()).copyTo(target);
+        }
+    }
+    return dense;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+laplacian::SparsePlane::SparsePlane(cv::Size size, int type) :
+        _size(size),
+        _type(type),
+        _blockCols((size.width + BLOCK_SIZE - 1) / BLOCK_SIZE),
+        _blockRows((size.height + BLOCK_SIZE - 1) / BLOCK_SIZE),
+        _occupancy(),
+        _ranks(),
+        _blocks() {
+}
+
+bool laplacian::SparsePlane::isOccupied(int blockRow, int blockCol) const {
+
+    const size_t index = static_cast<size_t>(blockRow) * _blockCols + blockCol;
+    return (_occupancy.at(index / WORD_BITS) >> (index % WORD_BITS)) & 1;
+}
+
+size_t laplacian::SparsePlane::rank(size_t index) const {
+
+    const size_t word = index / WORD_BITS;
+    if (word == _occupancy.size()) {
+        return word == 0 ? 0 : _ranks.back() + countBits(_occupancy.back());
+    }
+
+    const uint64_t front = _occupancy.at(word) & ((uint64_t{1} << (index % WORD_BITS)) - 1);
+    return _ranks.at(word) + countBits(front);
+}
+
+cv::Mat laplacian::SparsePlane::block(int blockRow, int blockCol) const {
+
+    const cv::Rect area = bounds(blockRow, blockCol);
+    const int slot = static_cast<int>(rank(static_cast<size_t>(blockRow) * _blockCols + blockCol));
+    return _blocks(cv::Rect(0, slot * BLOCK_SIZE, area.width, area.height));
+}
+
+cv::Rect laplacian::SparsePlane::bounds(int blockRow, int blockCol) const {
+
+    const int x = blockCol * BLOCK_SIZE;
+    const int y = blockRow * BLOCK_SIZE;
+    return {x, y, std::min(BLOCK_SIZE, _size.width - x), std::min(BLOCK_SIZE, _size.height - y)};
+}
+
+template<class T>
+bool laplacian::SparsePlane::hasNonZero(const cv::Mat& area) {
+
+    const int width = area.cols * area.channels();
+    for (int i = 0; i < area.rows; i++) {
+
+        const T* row = area.ptr<T>(i);
+        for (int j = 0; j < width; j++) {
+            if (static_cast<float>(row[j]) != 0.0f) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int laplacian::SparsePlane::countBits(uint64_t word) {
+
+    // Counts the bits of pairs, nibbles and bytes in parallel and sums the bytes with the multiplication.
+    word = word - ((word >> 1) & 0x5555555555555555ull);
+    word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+    word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return static_cast<int>((word * 0x0101010101010101ull) >> 56);
+}
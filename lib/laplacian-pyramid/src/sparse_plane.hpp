@@ -0,0 +1,172 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * A laplacian plane which holds only its blocks with non-zero values.
+     *
+     * The plane is split into square blocks of BLOCK_SIZE pixels, blocks at the right and the bottom border are cut
+     * to the plane. An occupancy bitmap marks the blocks with at least one non-zero value, and only these blocks are
+     * stored, one after another in the order of the bitmap. The position of a stored block is the amount of set bits
+     * in front of it, which is counted with the ranks kept per word of the bitmap.
+     * Quantized planes are mostly zero at the finer levels, so they shrink to a fraction of their dense size.
+     * The plane cannot be changed once it is built and may be shared.
+     */
+    class SparsePlane {
+    public:
+
+        static constexpr int BLOCK_SIZE = 16;
+
+        /**
+         *
+         * Builds the sparse form of the given plane if not more than the given share of its blocks has non-zero
+         * values. Otherwise the dense plane is smaller or about as small, and nothing is built.
+         *
+         * @param plane The plane. It has to be CV_32F, CV_16F, CV_16S or CV_32S encoded with up to four
+         *              channels.
+         * @param maxOccupancy The share of blocks with non-zero values up to which the sparse form is built.
+         *
+         * @return The sparse plane, or nullptr if too many blocks have non-zero values.
+         */
+        [[nodiscard]] static std::shared_ptr<const SparsePlane> compress(const cv::Mat& plane, double maxOccupancy);
+
+        [[nodiscard]] cv::Size size() const;
+        [[nodiscard]] int type() const;
+        [[nodiscard]] int blockRows() const;
+
+        /**
+         *
+         * Gets the amount of stored blocks.
+         *
+         * @return The blocks with non-zero values.
+         */
+        [[nodiscard]] size_t occupiedBlocks() const;
+
+        /**
+         *
+         * Gets the bytes the stored blocks and the bitmap take.
+         *
+         * @return The bytes of the sparse plane.
+         */
+        [[nodiscard]] size_t bytes() const;
+
+        /**
+         *
+         * Checks whether a row of blocks has any non-zero value.
+         *
+         * @param blockRow The row of blocks.
+         *
+         * @return True if at least one block of the row is stored.
+         */
+        [[nodiscard]] bool isOccupied(int blockRow) const;
+
+        /**
+         *
+         * Writes the dense rows of the given row of blocks to the given image, which is allocated with the width of
+         * the plane and the rows of the row of blocks. Empty blocks are written as zeros.
+         *
+         * @param blockRow The row of blocks.
+         * @param rows The dense rows.
+         */
+        void decompress(int blockRow, cv::Mat& rows) const;
+
+        /**
+         *
+         * Gets a region of the dense plane. Only the stored blocks overlapping the region are read.
+         *
+         * @param region The region, which has to lie inside the plane.
+         *
+         * @return The dense region.
+         */
+        [[nodiscard]] cv::Mat region(const cv::Rect& region) const;
+
+    private:
+        static constexpr int WORD_BITS = 64;
+
+        cv::Size _size;
+        int _type;
+        int _blockCols;
+        int _blockRows;
+
+        /**
+         * One bit per block, row by row, set for the stored blocks.
+         */
+        std::vector<uint64_t> _occupancy;
+
+        /**
+         * The amount of set bits in front of every word of the bitmap.
+         */
+        std::vector<uint32_t> _ranks;
+
+        /**
+         * The stored blocks on top of each other, every block BLOCK_SIZE rows high and padded with zeros to
+         * BLOCK_SIZE columns.
+         */
+        cv::Mat _blocks;
+
+        SparsePlane(cv::Size size, int type);
+
+        [[nodiscard]] bool isOccupied(int blockRow, int blockCol) const;
+
+        /**
+         *
+         * Counts the stored blocks in front of the given block, which is the position of the block if it is stored.
+         *
+         * @param index The index of the block, row by row. May be the amount of blocks.
+         *
+         * @return The amount of set bits in front of the index.
+         */
+        [[nodiscard]] size_t rank(size_t index) const;
+
+        /**
+         *
+         * Gets the stored block of the given occupied block.
+         *
+         * @param blockRow The row of the block.
+         * @param blockCol The column of the block.
+         *
+         * @return The block, cut to the plane.
+         */
+        [[nodiscard]] cv::Mat block(int blockRow, int blockCol) const;
+
+        /**
+         *
+         * Gets the area of the plane the given block covers.
+         *
+         * @param blockRow The row of the block.
+         * @param blockCol The column of the block.
+         *
+         * @return The rectangle of the block, cut to the plane.
+         */
+        [[nodiscard]] cv::Rect bounds(int blockRow, int blockCol) const;
+
+        /**
+         *
+         * Checks whether the given part of a plane has any non-zero value.
+         *
+         * @tparam T The depth of the plane.
+         * @param area The part of the plane.
+         *
+         * @return True if a value is not zero.
+         */
+        template<class T>
+        static bool hasNonZero(const cv::Mat& area);
+
+        /**
+         *
+         * Counts the set bits of the given word.
+         *
+         * @param word The word.
+         *
+         * @return The amount of set bits.
+         */
+        static int countBits(uint64_t word);
+    };
+}
@@ -0,0 +1,52 @@
+#include "stage_timer.hpp"
+
+laplacian::StageTimer::StageTimer(Profiler* profiler, Stage stage, uint8_t level) :
+        _profiler(profiler),
+        _stage(stage),
+        _level(level),
+        _start(),
+        _elapsed(0),
+        _running(true) {
+
+    if (_profiler) {
+        _start = std::chrono::steady_clock::now();
+    }
+}
+
+void laplacian::StageTimer::pause() {
+
+    if (!_profiler || !_running) {
+        return;
+    }
+
+    _elapsed += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start);
+    _running = false;
+}
+
+void laplacian::StageTimer::resume() {
+
+    if (!_profiler || _running) {
+        return;
+    }
+
+    _start = std::chrono::steady_clock::now();
+    _running = true;
+}
+
+void laplacian::StageTimer::stop(size_t bytesAllocated, size_t pixels) {
+
+    if (!_profiler) {
+        return;
+    }
+
+    pause();
+    _profiler->record(StageEvent{_stage, _level, _elapsed, bytesAllocated, pixels});
+}
+
+size_t laplacian::StageTimer::allocation(const cv::Mat& target, cv::Size size, int type) {
+
+    if (!target.empty() && target.size() == size && target.type() == type) {
+        return 0;
+    }
+    return static_cast<size_t>(size.area()) * CV_ELEM_SIZE(type);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <laplacian-pyramid/profiler.hpp>
+#include <opencv2/core.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace laplacian {
+
+    /**
+     *
+     * Measures one stage of a pyramid for a #laplacian::Profiler. Without profiler the timer neither reads the clock
+     * nor records anything, so instrumented code costs a null check when profiling is disabled.
+     */
+    class StageTimer {
+    public:
+
+        /**
+         *
+         * Starts measuring the given stage.
+         *
+         * @param profiler The profiler to record to, or nullptr to measure nothing.
+         * @param stage The stage.
+         * @param level The level of the stage.
+         */
+        StageTimer(Profiler* profiler, Stage stage, uint8_t level);
+
+        /**
+         *
+         * Pauses measuring, for a stage which is interleaved with other stages. The time until #resume is not
+         * measured.
+         */
+        void pause();
+
+        /**
+         *
+         * Resumes measuring after #pause.
+         */
+        void resume();
+
+        /**
+         *
+         * Stops measuring and records the stage.
+         *
+         * @param bytesAllocated The bytes of image memory the stage allocated, see #allocation.
+         * @param pixels The pixels the stage wrote.
+         */
+        void stop(size_t bytesAllocated, size_t pixels);
+
+        /**
+         *
+         * Gets the bytes cv::Mat::create allocates for the given target, which is nothing if the target already has
+         * the size and the type. Has to be called before the stage creates the target.
+         *
+         * @param target The target of the stage.
+         * @param size The size the stage creates the target with.
+         * @param type The type the stage creates the target with.
+         *
+         * @return The bytes allocated by the stage.
+         */
+        [[nodiscard]] static size_t allocation(const cv::Mat& target, cv::Size size, int type);
+
+    private:
+        Profiler* _profiler;
+        Stage _stage;
+        uint8_t _level;
+        std::chrono::steady_clock::time_point _start;
+        std::chrono::nanoseconds _elapsed;
+        bool _running;
+    };
+}
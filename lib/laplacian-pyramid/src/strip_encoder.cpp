@@ -0,0 +1,210 @@
+#include <laplacian-pyramid/strip_encoder.hpp>
+#include "expand_engine.hpp"
+#include "pyramid_geometry.hpp"
+#include "reduce_engine.hpp"
+#include <algorithm>
+#include <cstring>
+
+laplacian::StripEncoder::StripEncoder(cv::Size imageSize,
+                                      int type,
+                                      uint8_t compressions,
+                                      Sink sink,
+                                      float quantization) :
+        _geometry(std::make_shared<PyramidGeometry>(imageSize, compressions)),
+        _type(type),
+        _sink(std::move(sink)),
+        _quantization(quantization),
+        _reduceEngine(std::make_unique<ReduceEngine>(LaplacianPyramid::kernel())),
+        _expandEngine(std::make_unique<ExpandEngine>(LaplacianPyramid::kernel())),
+        _levels(_geometry->levels()),
+        _pushed(0) {
+
+    if (CV_MAT_DEPTH(type) != CV_32F || CV_MAT_CN(type) > 4) {
+        throw LaplacianPyramidException{"The strip encoder supports CV_32F encoded images with up to four channels!"};
+    }
+
+    const int channels = CV_MAT_CN(type);
+    for (uint8_t level = 0; level < levels(); level++) {
+
+        Level& state = _levels.at(level);
+        state.size = _geometry->levelSize(level);
+        state.gaussian.create(GAUSSIAN_ROWS, state.size.width, type);
+        state.plane.create(1, state.size.width, type);
+
+        if (level + 1 < levels()) {
+            const cv::Size next = _geometry->levelSize(level + 1);
+            state.reduced.create(REDUCE_ROWS, next.width * channels, CV_32F);
+            state.expanded.create(EXPAND_ROWS, state.size.width * channels, CV_32F);
+        }
+    }
+}
+
+laplacian::StripEncoder::~StripEncoder() = default;
+
+void laplacian::StripEncoder::push(const cv::Mat& strip) {
+
+    const cv::Size imageSize = _geometry->imageSize();
+    if (strip.type() != _type || strip.cols != imageSize.width || _pushed + strip.rows > imageSize.height) {
+        throw LaplacianPyramidException{"The strip does not fit to the image!"};
+    }
+
+    Level& first = _levels.front();
+    const size_t rowBytes = first.size.width * CV_ELEM_SIZE(_type);
+
+    for (int row = 0; row < strip.rows; row++, _pushed++) {
+
+        if (_pushed >= first.size.height) {
+            continue;
+        }
+
+        std::memcpy(first.gaussian.ptr(_pushed % GAUSSIAN_ROWS), strip.ptr(row), rowBytes);
+        first.produced++;
+        advance();
+    }
+}
+
+void laplacian::StripEncoder::encode(const std::function<bool(cv::Mat& strip)>& source) {
+
+    cv::Mat strip;
+    while (source(strip)) {
+        push(strip);
+    }
+    finish();
+}
+
+void laplacian::StripEncoder::finish() {
+
+    if (_pushed != _geometry->imageSize().height) {
+        throw LaplacianPyramidException{"The strips do not cover the whole image!"};
+    }
+
+    for (const Level& level : _levels) {
+        if (level.emitted != level.size.height) {
+            throw LaplacianPyramidException{"The strip encoder did not emit every row of the planes!"};
+        }
+    }
+}
+
+uint8_t laplacian::StripEncoder::levels() const {
+
+    return _geometry->levels();
+}
+
+cv::Size laplacian::StripEncoder::levelSize(uint8_t level) const {
+
+    return _geometry->levelSize(level);
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::StripEncoder::advance() {
+
+    // Row i of the next level needs the rows up to 2i + 2 of a level, row r of a plane needs the gaussian rows up
+    // to r / 2 + 1 of the next level. Both are clamped to the last row. Every level emits before it reduces,
+    // so the rows it still needs stay in its line buffers.
+    bool progress = true;
+    while (progress) {
+
+        progress = false;
+        for (uint8_t level = 0; level < levels(); level++) {
+
+            Level& state = _levels.at(level);
+            const bool top = level + 1 == levels();
+
+            while (state.emitted < state.produced &&
+                   (top || _levels.at(level + 1).produced >
+                           std::min((state.emitted >> 1) + 1, _levels.at(level + 1).size.height - 1))) {
+                emitNextRow(level);
+                progress = true;
+            }
+
+            if (!top) {
+
+                Level& next = _levels.at(level + 1);
+                if (next.produced < next.size.height &&
+                    state.produced > std::min((next.produced << 1) + 2, state.size.height - 1)) {
+                    reduceNextRow(level);
+                    progress = true;
+                }
+            }
+        }
+    }
+}
+
+void laplacian::StripEncoder::reduceNextRow(uint8_t level) {
+
+    Level& state = _levels.at(level);
+    Level& next = _levels.at(level + 1);
+    const int channels = CV_MAT_CN(_type);
+    const int width = next.size.width * channels;
+
+    const auto horizontal = [&](int row) -> const float* {
+
+        const int slot = row % REDUCE_ROWS;
+        float* line = state.reduced.ptr<float>(slot);
+        if (state.reducedRows[slot] != row) {
+            _reduceEngine->reduceHorizontally(gaussianRow(level, row), state.size.width, channels, line,
+                                              next.size.width);
+            state.reducedRows[slot] = row;
+        }
+        return line;
+    };
+
+    const int row = next.produced;
+    _reduceEngine->reduceVertically(row, state.size.height, horizontal,
+                                    next.gaussian.ptr<float>(row % GAUSSIAN_ROWS), width);
+    next.produced++;
+}
+
+void laplacian::StripEncoder::emitNextRow(uint8_t level) {
+
+    Level& state = _levels.at(level);
+    const int channels = CV_MAT_CN(_type);
+    const int width = state.size.width * channels;
+    const int row = state.emitted;
+    float* plane = state.plane.ptr<float>();
+
+    if (level + 1 == levels()) {
+
+        std::memcpy(plane, gaussianRow(level, row), width * sizeof(float));
+
+    } else {
+
+        const uint8_t nextLevel = level + 1;
+        const Level& next = _levels.at(nextLevel);
+
+        const auto horizontal = [&](int sourceRow) -> const float* {
+
+            const int slot = sourceRow % EXPAND_ROWS;
+            float* line = state.expanded.ptr<float>(slot);
+            if (state.expandedRows[slot] != sourceRow) {
+                _expandEngine->expandHorizontally(gaussianRow(nextLevel, sourceRow), next.size.width, channels, line,
+                                                  state.size.width);
+                state.expandedRows[slot] = sourceRow;
+            }
+            return line;
+        };
+
+        _expandEngine->expandVertically(row, next.size.height, horizontal, kernels::Accumulation::SUBTRACT,
+                                        gaussianRow(level, row), plane, width);
+    }
+
+    const float step = LaplacianPyramid::quantizationStep(_quantization, level, levels(), _type);
+    if (step > 0.0f) {
+        LaplacianPyramid::quantizeRow(plane, width, step);
+    }
+
+    _sink(level, row, state.plane);
+    state.emitted++;
+}
+
+float* laplacian::StripEncoder::gaussianRow(uint8_t level, int row) {
+
+    Level& state = _levels.at(level);
+    if (row >= state.produced || row < state.produced - GAUSSIAN_ROWS) {
+        throw LaplacianPyramidException{"The strip encoder does not keep the requested row!"};
+    }
+    return state.gaussian.ptr<float>(row % GAUSSIAN_ROWS);
+}
@@ -0,0 +1,146 @@
+#include <laplacian-pyramid/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+struct laplacian::ThreadPool::Job {
+
+    Job(const std::function<void(int)>& task, int count) : task(task), count(count), next(0), finished(0) {
+    }
+
+    const std::function<void(int)>& task;
+    const int count;
+    std::atomic<int> next;
+    int finished;
+    std::exception_ptr error;
+    std::mutex mutex;
+    std::condition_variable done;
+};
+
+laplacian::ThreadPool::ThreadPool(int threads) :
+        _workers(),
+        _jobs(),
+        _mutex(),
+        _wakeUp(),
+        _stopping(false) {
+
+    try {
+        for (int worker = 1; worker < threads; worker++) {
+            _workers.emplace_back([this]() { work(); });
+        }
+    } catch (...) {
+        // The destructor does not run for a failed constructor, so the started workers are stopped here.
+        stop();
+        throw;
+    }
+}
+
+laplacian::ThreadPool::~ThreadPool() {
+
+    stop();
+}
+
+void laplacian::ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+
+    if (_workers.empty() || count <= 1) {
+
+        for (int index = 0; index < count; index++) {
+            task(index);
+        }
+        return;
+    }
+
+    const auto job = std::make_shared<Job>(task, count);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.push_back(job);
+    }
+    _wakeUp.notify_all();
+
+    while (runNext(*job)) {
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->done.wait(lock, [&job]() { return job->finished == job->count; });
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.erase(std::remove(_jobs.begin(), _jobs.end(), job), _jobs.end());
+    }
+
+    if (job->error) {
+        std::rethrow_exception(job->error);
+    }
+}
+
+int laplacian::ThreadPool::concurrency() const {
+
+    return static_cast<int>(_workers.size()) + 1;
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+void laplacian::ThreadPool::stop() {
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeUp.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void laplacian::ThreadPool::work() {
+
+    while (true) {
+
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeUp.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+
+            if (_jobs.empty()) {
+                return;
+            }
+
+            job = _jobs.front();
+            if (job->next >= job->count) {
+                _jobs.pop_front();
+                continue;
+            }
+        }
+
+        while (runNext(*job)) {
+        }
+    }
+}
+
+bool laplacian::ThreadPool::runNext(Job& job) {
+
+    const int index = job.next++;
+    if (index >= job.count) {
+        return false;
+    }
+
+    std::exception_ptr error;
+    try {
+        job.task(index);
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(job.mutex);
+    if (error && !job.error) {
+        job.error = error;
+    }
+    if (++job.finished == job.count) {
+        job.done.notify_all();
+    }
+    return true;
+}
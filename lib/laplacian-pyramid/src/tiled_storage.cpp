@@ -0,0 +1,272 @@
+#include "tiled_storage.hpp"
+#include "plane_codec.hpp"
+#include "pyramid_types.hpp"
+
+#include <laplacian-pyramid/laplacian_pyramid.hpp>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+laplacian::TiledStorage::TiledStorage(const std::string& path) :
+        _file(path),
+        _a(0.0f),
+        _quantization(0.0f),
+        _tileSize(0),
+        _imageSize(),
+        _levels(),
+        _hasSteps(false) {
+
+    if (_file.size() < FIRST_VERSION_HEADER_SIZE || std::memcmp(_file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        throw LaplacianPyramidException{"The file does not hold a tiled laplacian pyramid!"};
+    }
+
+    // Only the header is read through a stream, the tiles stay in the mapping.
+    const auto headerSize = static_cast<size_t>(std::min<uint64_t>(_file.size(), HEADER_SIZE + UINT8_MAX * LEVEL_ENTRY_SIZE));
+    std::istringstream header(std::string(reinterpret_cast<const char*>(_file.data()), headerSize));
+    header.ignore(sizeof(MAGIC));
+
+    const auto version = PlaneCodec::readValue<uint8_t>(header);
+    if (version == 0 || version > FORMAT_VERSION) {
+        throw LaplacianPyramidException{"The file holds an unknown version of the format!"};
+    }
+
+    const auto levels = PlaneCodec::readValue<uint8_t>(header);
+    static_cast<void>(PlaneCodec::readValue<uint16_t>(header));
+    _a = PlaneCodec::readValue<float>(header);
+    _quantization = PlaneCodec::readValue<float>(header);
+    const auto tileSize = PlaneCodec::readValue<uint32_t>(header);
+    const auto imageRows = version > 1 ? PlaneCodec::readValue<uint32_t>(header) : 0u;
+    const auto imageCols = version > 1 ? PlaneCodec::readValue<uint32_t>(header) : 0u;
+
+    if (levels == 0 || !std::isfinite(_a) || !(std::isfinite(_quantization) && _quantization >= 0.0f) ||
+        tileSize == 0 || tileSize > MAX_TILE_SIZE || imageRows > INT_MAX || imageCols > INT_MAX) {
+        throw LaplacianPyramidException{"The file holds an invalid pyramid!"};
+    }
+    _tileSize = static_cast<int>(tileSize);
+    _imageSize = cv::Size(static_cast<int>(imageCols), static_cast<int>(imageRows));
+
+    for (uint8_t level = 0; level < levels; level++) {
+
+        const auto rows = PlaneCodec::readValue<uint32_t>(header);
+        const auto cols = PlaneCodec::readValue<uint32_t>(header);
+        const auto type = PlaneCodec::readValue<int32_t>(header);
+        const auto offset = PlaneCodec::readValue<uint64_t>(header);
+        const auto step = version > 2 ? PlaneCodec::readValue<float>(header) : 0.0f;
+
+        const bool validType = type >= 0 && types::isSupported(types::imageType(type)) &&
+                               types::planeType(types::imageType(type)) == type;
+        if (!validType || rows == 0 || cols == 0 || rows > INT_MAX / cols / 4 || offset % LEVEL_ALIGNMENT != 0 ||
+            offset > _file.size() ||
+            levelBytes(cv::Size(static_cast<int>(cols), static_cast<int>(rows)), type, _tileSize) >
+            _file.size() - offset || !(std::isfinite(step) && step >= 0.0f)) {
+            throw LaplacianPyramidException{"The file holds an invalid level!"};
+        }
+
+        _levels.push_back(Level{cv::Size(static_cast<int>(cols), static_cast<int>(rows)), type, offset, step});
+    }
+
+    if (version == 1) {
+        _imageSize = _levels.front().size;
+    }
+    _hasSteps = version > 2;
+}
+
+void laplacian::TiledStorage::write(const std::string& path,
+                                    const std::vector<cv::Mat>& planes,
+                                    cv::Size imageSize,
+                                    float a,
+                                    float quantization,
+                                    const std::vector<float>& steps,
+                                    int tileSize) {
+
+    if (tileSize <= 0 || tileSize > MAX_TILE_SIZE) {
+        throw LaplacianPyramidException{"The tile size has to be positive and at most 16384!"};
+    }
+
+    std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+    if (!stream) {
+        throw LaplacianPyramidException{"The file could not be opened!"};
+    }
+
+    stream.write(MAGIC, sizeof(MAGIC));
+    PlaneCodec::writeValue<uint8_t>(stream, FORMAT_VERSION);
+    PlaneCodec::writeValue<uint8_t>(stream, static_cast<uint8_t>(planes.size()));
+    PlaneCodec::writeValue<uint16_t>(stream, 0);
+    PlaneCodec::writeValue<float>(stream, a);
+    PlaneCodec::writeValue<float>(stream, quantization);
+    PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(tileSize));
+    PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(imageSize.height));
+    PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(imageSize.width));
+
+    std::vector<uint64_t> offsets;
+    uint64_t offset = align(HEADER_SIZE + planes.size() * LEVEL_ENTRY_SIZE);
+    for (size_t level = 0; level < planes.size(); level++) {
+
+        const cv::Mat& plane = planes.at(level);
+        PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(plane.rows));
+        PlaneCodec::writeValue<uint32_t>(stream, static_cast<uint32_t>(plane.cols));
+        PlaneCodec::writeValue<int32_t>(stream, plane.type());
+        PlaneCodec::writeValue<uint64_t>(stream, offset);
+        PlaneCodec::writeValue<float>(stream, steps.at(level));
+        offsets.push_back(offset);
+        offset = align(offset + levelBytes(plane.size(), plane.type(), tileSize));
+    }
+
+    const size_t tileRowBytes = static_cast<size_t>(tileSize) * CV_ELEM_SIZE(planes.front().type());
+    const std::vector<char> zeros(std::max<size_t>(tileRowBytes, LEVEL_ALIGNMENT), 0);
+    uint64_t position = HEADER_SIZE + planes.size() * LEVEL_ENTRY_SIZE;
+
+    for (size_t level = 0; level < planes.size(); level++) {
+
+        const cv::Mat& plane = planes.at(level);
+        stream.write(zeros.data(), static_cast<std::streamsize>(offsets.at(level) - position));
+
+        // The values are written as they are in memory, every supported platform is little endian.
+        for (int tileRow = 0; tileRow * tileSize < plane.rows; tileRow++) {
+            for (int tileCol = 0; tileCol * tileSize < plane.cols; tileCol++) {
+
+                const cv::Rect bounds = cv::Rect(tileCol * tileSize, tileRow * tileSize, tileSize, tileSize) &
+                                        cv::Rect(0, 0, plane.cols, plane.rows);
+                const cv::Mat tile = plane(bounds);
+                const size_t bytes = tile.cols * tile.elemSize();
+
+                for (int i = 0; i < tileSize; i++) {
+                    if (i < tile.rows) {
+                        stream.write(reinterpret_cast<const char*>(tile.ptr(i)), static_cast<std::streamsize>(bytes));
+                        stream.write(zeros.data(), static_cast<std::streamsize>(tileRowBytes - bytes));
+                    } else {
+                        stream.write(zeros.data(), static_cast<std::streamsize>(tileRowBytes));
+                    }
+                }
+            }
+        }
+        position = offsets.at(level) + levelBytes(plane.size(), plane.type(), tileSize);
+    }
+
+    if (!stream.flush()) {
+        throw LaplacianPyramidException{"The pyramid could not be written to the file!"};
+    }
+}
+
+uint8_t laplacian::TiledStorage::levels() const {
+
+    return static_cast<uint8_t>(_levels.size());
+}
+
+float laplacian::TiledStorage::a() const {
+
+    return _a;
+}
+
+float laplacian::TiledStorage::quantization() const {
+
+    return _quantization;
+}
+
+int laplacian::TiledStorage::tileSize() const {
+
+    return _tileSize;
+}
+
+cv::Size laplacian::TiledStorage::imageSize() const {
+
+    return _imageSize;
+}
+
+cv::Size laplacian::TiledStorage::levelSize(uint8_t level) const {
+
+    return _levels.at(level).size;
+}
+
+int laplacian::TiledStorage::type(uint8_t level) const {
+
+    return _levels.at(level).type;
+}
+
+std::vector<float> laplacian::TiledStorage::steps() const {
+
+    std::vector<float> steps;
+    if (_hasSteps) {
+        for (const Level& level : _levels) {
+            steps.push_back(level.step);
+        }
+    }
+    return steps;
+}
+
+cv::Mat laplacian::TiledStorage::tile(uint8_t level, int tileRow, int tileCol) const {
+
+    const Level& entry = _levels.at(level);
+    const int tilesPerRow = (entry.size.width + _tileSize - 1) / _tileSize;
+    const size_t tileRowBytes = static_cast<size_t>(_tileSize) * CV_ELEM_SIZE(entry.type);
+    const uint64_t offset = entry.offset +
+                            (static_cast<uint64_t>(tileRow) * tilesPerRow + tileCol) * _tileSize * tileRowBytes;
+
+    const int rows = std::min(_tileSize, entry.size.height - tileRow * _tileSize);
+    const int cols = std::min(_tileSize, entry.size.width - tileCol * _tileSize);
+
+    // The mapping is read only, the tile must not be written.
+    return cv::Mat(rows, cols, entry.type, const_cast<uint8_t*>(_file.data() + offset), tileRowBytes);
+}
+
+cv::Mat laplacian::TiledStorage::region(uint8_t level, const cv::Rect& region) const {
+
+    const Level& entry = _levels.at(level);
+    if (region.empty() || (region & cv::Rect(0, 0, entry.size.width, entry.size.height)) != region) {
+        throw LaplacianPyramidException{"The region does not lie inside the level!"};
+    }
+
+    const int firstRow = region.y / _tileSize;
+    const int lastRow = (region.y + region.height - 1) / _tileSize;
+    const int firstCol = region.x / _tileSize;
+    const int lastCol = (region.x + region.width - 1) / _tileSize;
+
+    if (firstRow == lastRow && firstCol == lastCol) {
+        return tile(level, firstRow, firstCol)(region - cv::Point(firstCol * _tileSize, firstRow * _tileSize));
+    }
+    return copy(level, region);
+}
+
+cv::Mat laplacian::TiledStorage::level(uint8_t level) const {
+
+    return copy(level, cv::Rect(cv::Point(), _levels.at(level).size));
+}
+
+////////////////////////////////////////
+// PRIVATE
+////////////////////////////////////////
+
+cv::Mat laplacian::TiledStorage::copy(uint8_t level, const cv::Rect& region) const {
+
+    const int firstRow = region.y / _tileSize;
+    const int lastRow = (region.y + region.height - 1) / _tileSize;
+    const int firstCol = region.x / _tileSize;
+    const int lastCol = (region.x + region.width - 1) / _tileSize;
+
+    cv::Mat result(region.size(), _levels.at(level).type);
+    for (int tileRow = firstRow; tileRow <= lastRow; tileRow++) {
+        for (int tileCol = firstCol; tileCol <= lastCol; tileCol++) {
+
+            const cv::Point origin(tileCol * _tileSize, tileRow * _tileSize);
+            const cv::Mat source = tile(level, tileRow, tileCol);
+            const cv::Rect overlap = cv::Rect(origin, source.size()) & region;
+            source(overlap - origin).copyTo(result(overlap - region.tl()));
+        }
+    }
+    return result;
+}
+
+uint64_t laplacian::TiledStorage::levelBytes(cv::Size size, int type, int tileSize) {
+
+    const uint64_t tileRows = (static_cast<uint64_t>(size.height) + tileSize - 1) / tileSize;
+    const uint64_t tileCols = (static_cast<uint64_t>(size.width) + tileSize - 1) / tileSize;
+    return tileRows * tileCols * tileSize * tileSize * CV_ELEM_SIZE(type);
+}
+
+uint64_t laplacian::TiledStorage::align(uint64_t offset) {
+
+    return (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "mapped_file.hpp"
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace laplacian {
+
+    /**
+     *
+     * The on-disk format of a laplacian pyramid with random access to its levels and tiles.
+     *
+     * The file starts with a header holding the kernel, the quantization, the tile size, the size of the decoded
+     * image and a table with the size, the type, the offset and the quantization step of every level. Every level
+     * is split into square tiles which are stored raw and row by row in the order of the tiles, every tile padded to
+     * the full tile size. So the position of a tile follows from the table and reading a tile only touches its own
+     * pages. The levels start at page boundaries.
+     * All values are little endian.
+     *
+     * The file is mapped into memory, opening it only reads the header.
+     */
+    class TiledStorage {
+    public:
+
+        /**
+         *
+         * Maps the file at the given path. If it does not hold a valid tiled pyramid,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param path The path of the file.
+         */
+        explicit TiledStorage(const std::string& path);
+
+        /**
+         *
+         * Writes the given laplacian planes as a tiled file. If the file cannot be written,
+         * a #laplacian::LaplacianPyramidException is thrown.
+         *
+         * @param path The path of the file.
+         * @param planes The laplacian planes.
+         * @param imageSize The size of the decoded image.
+         * @param a The value of the kernel the planes were encoded with.
+         * @param quantization The quantization the planes were encoded with.
+         * @param steps The quantization steps of the planes, one per level.
+         * @param tileSize The width and height of the tiles.
+         */
+        static void write(const std::string& path,
+                          const std::vector<cv::Mat>& planes,
+                          cv::Size imageSize,
+                          float a,
+                          float quantization,
+                          const std::vector<float>& steps,
+                          int tileSize);
+
+        [[nodiscard]] uint8_t levels() const;
+        [[nodiscard]] float a() const;
+        [[nodiscard]] float quantization() const;
+        [[nodiscard]] int tileSize() const;
+        [[nodiscard]] cv::Size imageSize() const;
+        [[nodiscard]] cv::Size levelSize(uint8_t level) const;
+        [[nodiscard]] int type(uint8_t level) const;
+
+        /**
+         *
+         * Gets the quantization steps of the levels.
+         *
+         * @return The steps, one per level, or none if the file was written by a version without steps.
+         */
+        [[nodiscard]] std::vector<float> steps() const;
+
+        /**
+         *
+         * Gets a tile of the given level. Tiles at the right and the bottom border are cut to the level.
+         *
+         * @param level The level.
+         * @param tileRow The row of the tile.
+         * @param tileCol The column of the tile.
+         *
+         * @return The tile, sharing the memory of the mapping.
+         */
+        [[nodiscard]] cv::Mat tile(uint8_t level, int tileRow, int tileCol) const;
+
+        /**
+         *
+         * Gets a region of the given level. Only the tiles overlapping the region are read.
+         *
+         * @param level The level.
+         * @param region The region, which has to lie inside the level.
+         *
+         * @return The region. It shares the memory of the mapping if it lies inside a single tile,
+         *         otherwise it is copied out of the tiles.
+         */
+        [[nodiscard]] cv::Mat region(uint8_t level, const cv::Rect& region) const;
+
+        /**
+         *
+         * Reads the given level out of its tiles.
+         *
+         * @param level The level.
+         *
+         * @return The level in its own memory.
+         */
+        [[nodiscard]] cv::Mat level(uint8_t level) const;
+
+    private:
+        static constexpr char MAGIC[4] = {'L', 'P', 'Y', 'T'};
+        static const uint8_t FORMAT_VERSION = 3;
+        static const size_t HEADER_SIZE = 28;
+
+        /**
+         * The first version has no image size.
+         */
+        static const size_t FIRST_VERSION_HEADER_SIZE = 20;
+
+        /**
+         * The levels of the first two versions have no quantization step and take four bytes less.
+         */
+        static const size_t LEVEL_ENTRY_SIZE = 24;
+        static constexpr uint64_t LEVEL_ALIGNMENT = 4096;
+        static const int MAX_TILE_SIZE = 1 << 14;
+
+        struct Level {
+            cv::Size size;
+            int type;
+            uint64_t offset;
+            float step;
+        };
+
+        MappedFile _file;
+        float _a;
+        float _quantization;
+        int _tileSize;
+        cv::Size _imageSize;
+        std::vector<Level> _levels;
+        bool _hasSteps;
+
+        /**
+         *
+         * Copies a region of the given level out of the tiles overlapping it.
+         *
+         * @param level The level.
+         * @param region The region, which has to lie inside the level.
+         *
+         * @return The region in its own memory.
+         */
+        [[nodiscard]] cv::Mat copy(uint8_t level, const cv::Rect& region) const;
+
+        /**
+         *
+         * Gets the amount of bytes a tiled level takes in the file.
+         *
+         * @param size The size of the level.
+         * @param type The type of the level.
+         * @param tileSize The width and height of the tiles.
+         *
+         * @return The amount of bytes.
+         */
+        [[nodiscard]] static uint64_t levelBytes(cv::Size size, int type, int tileSize);
+
+        /**
+         *
+         * Rounds the given offset up to the next level boundary.
+         *
+         * @param offset The offset.
+         *
+         * @return The aligned offset.
+         */
+        [[nodiscard]] static uint64_t align(uint64_t offset);
+    };
+}
@@ -1,13 +1,56 @@
 #include <gtest/gtest.h>
+#include <laplacian-pyramid/cpu_level.hpp>
+#include <laplacian-pyramid/incremental_encoder.hpp>
 #include <laplacian-pyramid/laplacian_pyramid.hpp>
-#include <chrono>
-#include <functional>
+#include <laplacian-pyramid/pyramid_batch.hpp>
+#include <laplacian-pyramid/pyramid_blender.hpp>
+#include <laplacian-pyramid/pyramid_service.hpp>
+#include <laplacian-pyramid/pyramid_stats.hpp>
+#include <laplacian-pyramid/rate_controller.hpp>
+#include <laplacian-pyramid/strip_encoder.hpp>
+#include <laplacian-pyramid/thread_pool.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <utility>
 
 namespace laplacian::test {
 
-    template<class R>
-    R measured(const std::function<R ()>& function, const std::string& step = "");
+    /**
+     *
+     * Builds the laplacian planes with the direct 5x5 convolution of the paper
+     * "The Laplacian Pyramid as a Compact Image Code". Used as reference for the optimized implementation.
+     *
+     * @param image The image to encode.
+     * @param compressions The compression levels.
+     *
+     * @return The laplacian planes.
+     */
+    std::vector<cv::Mat> referencePlanes(const cv::Mat& image, uint8_t compressions);
+
+    cv::Mat referenceKernel(float a = laplacian::DEFAULT_A);
+    cv::Mat referenceReduce(const cv::Mat& image, const cv::Mat& kernel, int rows, int cols);
+    cv::Mat referenceUpsample(const cv::Mat& image, const cv::Mat& kernel, int rows, int cols);
+
+    /**
+     *
+     * Builds a CV_8U image which drives the laplacian plane of the given level at the given pixel to its maximum.
+     * The image is 255 where the laplacian kernel of the pixel over the image is positive and 0 elsewhere, a
+     * checkerboard of the signs of the kernel. The pixel has to be even in both dimensions and its kernel has to lie
+     * inside the image and away from the borders of every level.
+     *
+     * @param size The size of the image.
+     * @param level The level of the laplacian plane.
+     * @param pixel The pixel of the laplacian plane.
+     *
+     * @return The image.
+     */
+    cv::Mat worstCaseImage(cv::Size size, uint8_t level, cv::Point pixel);
+
+    const float REFERENCE_TOLERANCE = 1e-2f;
 }
 
 TEST(LaplacianPyramid, should_display_decoded_image_if_image_is_grayscale) {
@@ -16,12 +59,8 @@ TEST(LaplacianPyramid, should_display_decoded_image_if_image_is_grayscale) {
         cv::Mat image = cv::imread("resources/lena.png", cv::IMREAD_GRAYSCALE);
         image.convertTo(image, CV_32F);
 
-        auto pyramid = laplacian::test::measured<laplacian::LaplacianPyramid>(
-                [&image]() -> laplacian::LaplacianPyramid { return laplacian::LaplacianPyramid{image, 5}; },
-                "Laplace-Pyramid creation");
-
-        auto decoded = laplacian::test::measured<cv::Mat>(
-                [&pyramid]() -> cv::Mat { return pyramid.decode(); }, "Laplace-Pyramid decode");
+        laplacian::LaplacianPyramid pyramid{image, 5};
+        cv::Mat decoded = pyramid.decode();
         decoded.convertTo(decoded, CV_8U);
 
         if (i == 99) {
@@ -41,30 +80,8 @@ TEST(LaplacianPyramid, should_display_decoded_image_if_image_is_color) {
     cv::Mat image = cv::imread("resources/lena.png", cv::IMREAD_COLOR);
     image.convertTo(image, CV_32F);
 
-    cv::Mat bgr[3];
-    cv::split(image, bgr);
-
-    auto bluePyramid = laplacian::test::measured<laplacian::LaplacianPyramid>(
-            [&bgr]() -> laplacian::LaplacianPyramid { return laplacian::LaplacianPyramid{bgr[0], 5}; },
-            "Laplace-Pyramid blue creation");
-    auto greenPyramid = laplacian::test::measured<laplacian::LaplacianPyramid>(
-            [&bgr]() -> laplacian::LaplacianPyramid { return laplacian::LaplacianPyramid{bgr[1], 5}; },
-            "Laplace-Pyramid green creation");
-    auto redPyramid = laplacian::test::measured<laplacian::LaplacianPyramid>(
-            [&bgr]() -> laplacian::LaplacianPyramid { return laplacian::LaplacianPyramid{bgr[2], 5}; },
-            "Laplace-Pyramid red creation");
-
-    auto decodedBlue = laplacian::test::measured<cv::Mat>(
-            [&bluePyramid]() -> cv::Mat { return bluePyramid.decode(); }, "Laplace-Pyramid blue decode");
-    auto decodedGreen = laplacian::test::measured<cv::Mat>(
-            [&greenPyramid]() -> cv::Mat { return greenPyramid.decode(); }, "Laplace-Pyramid green decode");
-    auto decodedRed = laplacian::test::measured<cv::Mat>(
-            [&redPyramid]() -> cv::Mat { return redPyramid.decode(); }, "Laplace-Pyramid red decode");
-    cv::Mat decoded;
-    bgr[0] = decodedBlue;
-    bgr[1] = decodedGreen;
-    bgr[2] = decodedRed;
-    cv::merge(bgr, 3, decoded);
+    laplacian::LaplacianPyramid pyramid{image, 5};
+    cv::Mat decoded = pyramid.decode();
     decoded.convertTo(decoded, CV_8U);
 
     image.convertTo(image, CV_8U);
@@ -76,20 +93,1197 @@ TEST(LaplacianPyramid, should_display_decoded_image_if_image_is_color) {
     cv::waitKey(0);
 }
 
+TEST(LaplacianPyramid, should_match_reference_planes_if_image_is_grayscale) {
+
+    const std::vector<cv::Size> sizes = {cv::Size{512, 512}, cv::Size{217, 300}, cv::Size{253, 125}};
+
+    for (const auto& size : sizes) {
+        cv::Mat image(size, CV_32F);
+        cv::randu(image, 0.0f, 255.0f);
+
+        const auto pyramid = laplacian::LaplacianPyramid{image, 5};
+        const auto expected = laplacian::test::referencePlanes(image, 5);
+
+        ASSERT_EQ(expected.size(), pyramid.levels());
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+            ASSERT_EQ(expected.at(level).size(), pyramid.at(level).size());
+            EXPECT_LE(cv::norm(expected.at(level), pyramid.at(level), cv::NORM_INF),
+                      laplacian::test::REFERENCE_TOLERANCE);
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_match_reference_decode_if_image_is_grayscale) {
+
+    cv::Mat image(cv::Size{217, 300}, CV_32F);
+    cv::randu(image, 0.0f, 255.0f);
+
+    const auto pyramid = laplacian::LaplacianPyramid{image, 5};
+    const auto planes = laplacian::test::referencePlanes(image, 5);
+
+    const cv::Mat kernel = laplacian::test::referenceKernel();
+
+    cv::Mat expected = planes.back();
+    for (int level = static_cast<int>(planes.size()) - 2; level >= 0; level--) {
+        const auto& plane = planes.at(level);
+        expected = plane + laplacian::test::referenceUpsample(expected, kernel, plane.rows, plane.cols);
+    }
+
+    const auto decoded = pyramid.decode();
+    ASSERT_EQ(expected.size(), decoded.size());
+    EXPECT_LE(cv::norm(expected, decoded, cv::NORM_INF), laplacian::test::REFERENCE_TOLERANCE);
+}
+
+TEST(LaplacianPyramid, should_match_serial_result_if_executor_is_given) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_32F);
+    cv::randu(image, 0.0f, 255.0f);
+
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+    const auto serial = laplacian::LaplacianPyramid{image, 5};
+    const auto parallel = laplacian::LaplacianPyramid{image, 5, laplacian::DEFAULT_QUANTIZATION, executor};
+
+    ASSERT_EQ(serial.levels(), parallel.levels());
+    for (uint8_t level = 0; level < serial.levels(); level++) {
+        EXPECT_EQ(0.0, cv::norm(serial.at(level), parallel.at(level), cv::NORM_INF));
+    }
+    EXPECT_EQ(0.0, cv::norm(serial.decode(), parallel.decode(), cv::NORM_INF));
+}
+
+TEST(LaplacianPyramid, should_reuse_workspace_memory_if_workspace_is_given) {
+
+    cv::Mat first(cv::Size{509, 317}, CV_32F);
+    cv::Mat second(cv::Size{509, 317}, CV_32F);
+    cv::randu(first, 0.0f, 255.0f);
+    cv::randu(second, 0.0f, 255.0f);
+
+    laplacian::PyramidWorkspace workspace{first.size(), 5};
+    auto pyramid = laplacian::LaplacianPyramid{first, workspace};
+    const auto firstDecoded = pyramid.decode(workspace);
+    const auto* planeMemory = pyramid.at(0).data;
+    const auto* decodedMemory = firstDecoded.data;
+
+    pyramid.encode(second, workspace);
+    const auto expected = laplacian::LaplacianPyramid{second, 5};
+
+    ASSERT_EQ(expected.levels(), pyramid.levels());
+    EXPECT_EQ(planeMemory, pyramid.at(0).data);
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+        EXPECT_EQ(0.0, cv::norm(expected.at(level), pyramid.at(level), cv::NORM_INF));
+    }
+
+    const auto decoded = pyramid.decode(workspace);
+    EXPECT_EQ(decodedMemory, decoded.data);
+    EXPECT_EQ(0.0, cv::norm(expected.decode(), decoded, cv::NORM_INF));
+}
+
+TEST(LaplacianPyramid, should_match_channel_pyramids_if_image_is_multi_channeled) {
+
+    for (int channels : {3, 4}) {
+
+        cv::Mat image(cv::Size{253, 189}, CV_32FC(channels));
+        cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+
+        std::vector<cv::Mat> channelImages;
+        cv::split(image, channelImages);
+
+        const auto pyramid = laplacian::LaplacianPyramid{image, 4};
+        const auto decoded = pyramid.decode();
+        ASSERT_EQ(image.type(), decoded.type());
+
+        std::vector<cv::Mat> decodedChannels;
+        cv::split(decoded, decodedChannels);
+
+        for (int channel = 0; channel < channels; channel++) {
+
+            const auto expected = laplacian::LaplacianPyramid{channelImages.at(channel), 4};
+            ASSERT_EQ(expected.levels(), pyramid.levels());
+
+            for (uint8_t level = 0; level < pyramid.levels(); level++) {
+                cv::Mat plane;
+                cv::extractChannel(pyramid.at(level), plane, channel);
+                EXPECT_LT(cv::norm(expected.at(level), plane, cv::NORM_INF), 1e-3);
+            }
+            EXPECT_LT(cv::norm(expected.decode(), decodedChannels.at(channel), cv::NORM_INF), 1e-3);
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_throw_exception_if_image_type_is_not_supported) {
+
+    cv::Mat image(cv::Size{253, 189}, CV_64F, cv::Scalar::all(0));
+
+    EXPECT_THROW(laplacian::LaplacianPyramid(image, 4), laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_decode_losslessly_if_image_is_integer) {
+
+    for (int type : {CV_8UC1, CV_8UC3, CV_16UC1}) {
+
+        cv::Mat image(cv::Size{253, 189}, type);
+        cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(CV_MAT_DEPTH(type) == CV_8U ? 256.0 : 65536.0));
+
+        const auto pyramid = laplacian::LaplacianPyramid{image, 4};
+        const int planeDepth = CV_MAT_DEPTH(type) == CV_8U ? CV_16S : CV_32S;
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+            EXPECT_EQ(CV_MAKETYPE(planeDepth, image.channels()), pyramid.at(level).type());
+        }
+
+        const auto decoded = pyramid.decode();
+        const auto scaled = image(cv::Rect{0, 0, decoded.cols, decoded.rows});
+        ASSERT_EQ(type, decoded.type());
+        EXPECT_EQ(0.0, cv::norm(scaled, decoded, cv::NORM_INF));
+    }
+}
+
+TEST(LaplacianPyramid, should_match_float_planes_if_image_is_integer) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_8U);
+    cv::randu(image, 0.0, 256.0);
+    cv::Mat floatImage;
+    image.convertTo(floatImage, CV_32F);
+
+    const auto pyramid = laplacian::LaplacianPyramid{image, 5};
+    const auto expected = laplacian::LaplacianPyramid{floatImage, 5};
+
+    // Every gaussian is rounded to integers. EXPAND amplifies the rounding by up to 3 per pass with the default
+    // kernel, so noise planes differ by a few units.
+    ASSERT_EQ(expected.levels(), pyramid.levels());
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+        cv::Mat plane;
+        pyramid.at(level).convertTo(plane, CV_32F);
+        EXPECT_LE(cv::norm(expected.at(level), plane, cv::NORM_INF), 16.0);
+    }
+}
+
 TEST(LaplacianPyramid, shold_display_decoded_image_if_image_is_quantized) {
 
-    // TODO: Implement
+    cv::Mat image = cv::imread("resources/lena.png", cv::IMREAD_GRAYSCALE);
+    image.convertTo(image, CV_32F);
+
+    laplacian::LaplacianPyramid pyramid{image, 5, 2.0f};
+
+    std::stringstream stream;
+    pyramid.serialize(stream);
+    RecordProperty("serializedBytes", std::to_string(stream.str().size()));
+
+    cv::Mat decoded = pyramid.decode();
+    decoded.convertTo(decoded, CV_8U);
+
+    image.convertTo(image, CV_8U);
+    cv::resize(decoded, decoded, cv::Size{image.rows, image.cols});
+    cv::Mat difference = image - decoded;
+    cv::imshow("Original", image);
+    cv::imshow("Decoded", decoded);
+    cv::imshow("Difference", difference);
+    cv::waitKey(0);
+}
+
+TEST(LaplacianPyramid, should_quantize_planes_to_bin_centers_if_quantization_is_given) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_32F);
+    cv::randu(image, 0.0f, 255.0f);
+
+    const auto pyramid = laplacian::LaplacianPyramid{image, 5, 1.5f};
+    const auto expected = laplacian::LaplacianPyramid{image, 5};
+
+    ASSERT_EQ(expected.levels(), pyramid.levels());
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+
+        const float step = 1.5f * static_cast<float>(1 << std::max(0, pyramid.levels() - 2 - level));
+        const cv::Mat plane = pyramid.at(level);
+        for (int row = 0; row < plane.rows; row++) {
+            for (int col = 0; col < plane.cols; col++) {
+                const float value = plane.at<float>(row, col);
+                const float bin = std::round(value / step);
+                EXPECT_NEAR(bin * step, value, 1e-3f);
+                EXPECT_LE(std::abs(expected.at(level).at<float>(row, col) - value), step / 2 + 1e-3f);
+            }
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_restore_pyramid_if_pyramid_is_serialized) {
+
+    cv::Mat floatImage(cv::Size{253, 189}, CV_32FC3);
+    cv::randu(floatImage, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+    cv::Mat integerImage(cv::Size{253, 189}, CV_8U);
+    cv::randu(integerImage, 0.0, 256.0);
+
+    const std::vector<laplacian::LaplacianPyramid> pyramids = {
+            laplacian::LaplacianPyramid{floatImage, 4},
+            laplacian::LaplacianPyramid{floatImage, 4, 2.0f},
+            laplacian::LaplacianPyramid{integerImage, 4},
+            laplacian::LaplacianPyramid{integerImage, 4, 3.0f}};
+
+    for (const auto& pyramid : pyramids) {
+
+        std::stringstream stream;
+        pyramid.serialize(stream);
+        const auto restored = laplacian::LaplacianPyramid::deserialize(stream);
+
+        ASSERT_EQ(pyramid.levels(), restored.levels());
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+            ASSERT_EQ(pyramid.at(level).type(), restored.at(level).type());
+            EXPECT_EQ(0.0, cv::norm(pyramid.at(level), restored.at(level), cv::NORM_INF));
+        }
+        EXPECT_EQ(0.0, cv::norm(pyramid.decode(), restored.decode(), cv::NORM_INF));
+    }
+}
+
+TEST(LaplacianPyramid, should_be_smaller_than_image_if_pyramid_is_quantized) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_32F);
+    for (int row = 0; row < image.rows; row++) {
+        for (int col = 0; col < image.cols; col++) {
+            image.at<float>(row, col) = 127.5f + 100.0f * std::sin(row / 20.0f) * std::cos(col / 30.0f);
+        }
+    }
+
+    std::stringstream stream;
+    laplacian::LaplacianPyramid{image, 5, 1.0f}.serialize(stream);
+
+    EXPECT_LT(stream.str().size(), image.total() / 4);
+}
+
+TEST(LaplacianPyramid, should_throw_exception_if_stream_is_corrupt) {
+
+    cv::Mat image(cv::Size{253, 189}, CV_8U);
+    cv::randu(image, 0.0, 256.0);
+
+    std::stringstream stream;
+    laplacian::LaplacianPyramid{image, 4}.serialize(stream);
+    const std::string bytes = stream.str();
+
+    std::stringstream truncated{bytes.substr(0, bytes.size() / 2)};
+    EXPECT_THROW(laplacian::LaplacianPyramid::deserialize(truncated), laplacian::LaplacianPyramidException);
+
+    std::stringstream foreign{"not a pyramid"};
+    EXPECT_THROW(laplacian::LaplacianPyramid::deserialize(foreign), laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_match_pyramid_planes_if_image_is_encoded_in_strips) {
+
+    cv::Mat grayImage(cv::Size{509, 317}, CV_32F);
+    cv::randu(grayImage, 0.0, 255.0);
+    cv::Mat colorImage(cv::Size{253, 125}, CV_32FC3);
+    cv::randu(colorImage, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+
+    for (const cv::Mat& image : {grayImage, colorImage}) {
+        for (const float quantization : {0.0f, 2.0f}) {
+            for (const int stripRows : {1, 7, 64}) {
+
+                const laplacian::LaplacianPyramid pyramid{image, 4, quantization};
+
+                std::vector<cv::Mat> planes;
+                std::vector<int> nextRows;
+                const auto sink = [&](uint8_t level, int row, const cv::Mat& planeRow) {
+                    ASSERT_EQ(nextRows.at(level)++, row);
+                    planeRow.copyTo(planes.at(level).row(row));
+                };
+                laplacian::StripEncoder encoder{image.size(), image.type(), 4, sink, quantization};
+
+                for (uint8_t level = 0; level < encoder.levels(); level++) {
+                    planes.emplace_back(encoder.levelSize(level), image.type());
+                    nextRows.push_back(0);
+                }
+
+                int row = 0;
+                encoder.encode([&](cv::Mat& strip) {
+                    if (row >= image.rows) {
+                        return false;
+                    }
+                    const int end = std::min(row + stripRows, image.rows);
+                    strip = image.rowRange(row, end);
+                    row = end;
+                    return true;
+                });
+
+                ASSERT_EQ(pyramid.levels(), encoder.levels());
+                for (uint8_t level = 0; level < pyramid.levels(); level++) {
+                    EXPECT_EQ(0.0, cv::norm(pyramid.at(level), planes.at(level), cv::NORM_INF));
+                }
+            }
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_throw_exception_if_strips_do_not_fit_to_image) {
+
+    cv::Mat image(cv::Size{253, 125}, CV_32F);
+    cv::randu(image, 0.0, 255.0);
+    laplacian::StripEncoder encoder{image.size(), image.type(), 4, [](uint8_t, int, const cv::Mat&) {}};
+
+    encoder.push(image.rowRange(0, 100));
+    EXPECT_THROW(encoder.finish(), laplacian::LaplacianPyramidException);
+    EXPECT_THROW(encoder.push(image), laplacian::LaplacianPyramidException);
+    encoder.push(image.rowRange(100, 125));
+    encoder.finish();
+}
+
+TEST(LaplacianPyramid, should_read_levels_and_regions_if_pyramid_is_opened) {
+
+    cv::Mat floatImage(cv::Size{253, 189}, CV_32FC3);
+    cv::randu(floatImage, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+    cv::Mat integerImage(cv::Size{509, 317}, CV_8U);
+    cv::randu(integerImage, 0.0, 256.0);
+
+    const std::string path = "tiled_pyramid.lpyt";
+    const std::vector<std::pair<laplacian::LaplacianPyramid, int>> pyramids = {
+            {laplacian::LaplacianPyramid{floatImage, 4}, 64},
+            {laplacian::LaplacianPyramid{integerImage, 4, 3.0f}, 100}};
+
+    for (const auto& [pyramid, tileSize] : pyramids) {
+
+        pyramid.save(path, tileSize);
+        auto opened = laplacian::LaplacianPyramid::open(path);
+
+        ASSERT_EQ(pyramid.levels(), opened.levels());
+        EXPECT_EQ(tileSize, opened.tileSize());
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+            ASSERT_EQ(pyramid.at(level).type(), opened.at(level).type());
+            EXPECT_EQ(0.0, cv::norm(pyramid.at(level), opened.at(level), cv::NORM_INF));
+        }
+        EXPECT_EQ(0.0, cv::norm(pyramid.decode(), opened.decode(), cv::NORM_INF));
+
+        // One region inside a tile and one across four tiles.
+        for (const cv::Rect& region : {cv::Rect(3, 5, 40, 30), cv::Rect(tileSize - 7, tileSize - 9, 20, 30)}) {
+            EXPECT_EQ(0.0, cv::norm(pyramid.at(0, region), opened.at(0, region), cv::NORM_INF));
+        }
+        EXPECT_THROW(static_cast<void>(opened.at(1, cv::Rect(0, 0, 1000, 1))), laplacian::LaplacianPyramidException);
+
+        // A level taken by reference is read into memory and can be changed.
+        opened.at(0).setTo(cv::Scalar::all(0));
+        EXPECT_EQ(0.0, cv::norm(opened.at(0), cv::NORM_INF));
+    }
+
+    std::remove(path.c_str());
+}
+
+TEST(LaplacianPyramid, should_throw_exception_if_file_is_not_a_pyramid) {
+
+    const std::string path = "not_a_pyramid.lpyt";
+    std::ofstream(path, std::ios::binary) << "LPYT but not a pyramid";
+
+    EXPECT_THROW(static_cast<void>(laplacian::LaplacianPyramid::open(path)), laplacian::LaplacianPyramidException);
+    EXPECT_THROW(static_cast<void>(laplacian::LaplacianPyramid::open("missing.lpyt")),
+                 laplacian::LaplacianPyramidException);
+
+    std::remove(path.c_str());
+}
+
+TEST(LaplacianPyramid, should_match_full_decode_if_level_or_region_is_decoded) {
+
+    cv::Mat floatImage(cv::Size{509, 317}, CV_32F);
+    cv::randu(floatImage, 0.0, 255.0);
+    cv::Mat integerImage(cv::Size{253, 189}, CV_8UC3);
+    cv::randu(integerImage, cv::Scalar::all(0.0), cv::Scalar::all(256.0));
+
+    const std::vector<laplacian::LaplacianPyramid> pyramids = {
+            laplacian::LaplacianPyramid{floatImage, 4},
+            laplacian::LaplacianPyramid{integerImage, 4, 3.0f}};
+
+    for (const auto& pyramid : pyramids) {
+
+        EXPECT_EQ(0.0, cv::norm(pyramid.decode(), pyramid.decode(0), cv::NORM_INF));
+
+        for (uint8_t level = 0; level < pyramid.levels(); level++) {
+
+            const cv::Mat reconstruction = pyramid.decode(level);
+            ASSERT_EQ(pyramid.at(level).size(), reconstruction.size());
+            ASSERT_EQ(pyramid.decode().type(), reconstruction.type());
+
+            const cv::Size size = reconstruction.size();
+            for (const cv::Rect& region : {cv::Rect(0, 0, size.width, size.height),
+                                           cv::Rect(size.width / 3, size.height / 4, size.width / 2, size.height / 3),
+                                           cv::Rect(size.width - 5, size.height - 3, 5, 3),
+                                           cv::Rect(1, size.height / 2, 1, 1)}) {
+
+                const cv::Mat decoded = pyramid.decode(region, level);
+                ASSERT_EQ(region.size(), decoded.size());
+                EXPECT_GE(1e-3, cv::norm(reconstruction(region), decoded, cv::NORM_INF));
+            }
+        }
+
+        EXPECT_THROW(static_cast<void>(pyramid.decode(pyramid.levels())), laplacian::LaplacianPyramidException);
+        EXPECT_THROW(static_cast<void>(pyramid.decode(cv::Rect(-1, 0, 2, 2))), laplacian::LaplacianPyramidException);
+    }
+}
+
+TEST(LaplacianPyramid, should_match_single_pyramids_if_images_are_encoded_in_batch) {
+
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+
+    for (const int type : {CV_32F, CV_8UC3}) {
+        for (const int count : {2, 9}) {
+
+            std::vector<cv::Mat> images;
+            for (int index = 0; index < count; index++) {
+                images.emplace_back(cv::Size{125, 93}, type);
+                cv::randu(images.back(), cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+            }
+
+            const laplacian::PyramidBatch batch{images.front().size(), type, 3, 2.0f, executor};
+            const auto pyramids = batch.encode(images);
+            const auto decoded = batch.decode(pyramids);
+
+            ASSERT_EQ(images.size(), pyramids.size());
+            ASSERT_EQ(images.size(), decoded.size());
+            for (int index = 0; index < count; index++) {
+
+                const laplacian::LaplacianPyramid single{images.at(index), 3, 2.0f};
+                ASSERT_EQ(single.levels(), pyramids.at(index).levels());
+                for (uint8_t level = 0; level < single.levels(); level++) {
+                    EXPECT_EQ(0.0, cv::norm(single.at(level), pyramids.at(index).at(level), cv::NORM_INF));
+                }
+                EXPECT_EQ(0.0, cv::norm(single.decode(), decoded.at(index), cv::NORM_INF));
+            }
+        }
+    }
+
+    const laplacian::PyramidBatch batch{cv::Size{125, 93}, CV_32F, 3};
+    EXPECT_THROW(static_cast<void>(batch.encode({cv::Mat(cv::Size{125, 93}, CV_8U)})),
+                 laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_match_pyramid_of_frame_if_frame_is_updated_incrementally) {
+
+    for (const int type : {CV_32FC3, CV_8U}) {
+        for (const float quantization : {0.0f, 3.0f}) {
+
+            cv::Mat frame(cv::Size{509, 317}, type);
+            cv::randu(frame, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+            laplacian::IncrementalEncoder encoder{frame, 4, quantization};
+
+            // Changes inside the image, at its borders and in the part which is cut by the valid scaling.
+            const std::vector<cv::Rect> changes = {cv::Rect(100, 50, 20, 30), cv::Rect(0, 0, 7, 3),
+                                                   cv::Rect(480, 290, 29, 27), cv::Rect(200, 310, 40, 7)};
+            for (size_t frames = 0; frames < changes.size(); frames++) {
+
+                cv::Mat next = frame.clone();
+                cv::randu(next(changes.at(frames)), cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+                if (frames % 2 == 0) {
+                    encoder.update(next);
+                } else {
+                    encoder.update(next, {changes.at(frames)});
+                }
+                frame = next;
+
+                const laplacian::LaplacianPyramid expected{frame, 4, quantization};
+                ASSERT_EQ(expected.levels(), encoder.pyramid().levels());
+                for (uint8_t level = 0; level < expected.levels(); level++) {
+                    EXPECT_EQ(0.0, cv::norm(expected.at(level), encoder.pyramid().at(level), cv::NORM_INF));
+                }
+            }
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_measure_every_stage_per_level_if_profiler_is_given) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_32F);
+    cv::randu(image, 0.0f, 255.0f);
+
+    auto stats = std::make_shared<laplacian::PyramidStats>();
+    auto pyramid = laplacian::LaplacianPyramid{image, 4, 2.0f, nullptr, stats};
+
+    ASSERT_EQ(4, stats->levels());
+    EXPECT_EQ(pyramid.at(0).total(), stats->stage(laplacian::Stage::VALID_SCALING, 0).pixels);
+    for (uint8_t level = 0; level < pyramid.levels(); level++) {
+
+        const size_t pixels = pyramid.at(level).total();
+        EXPECT_EQ(level == 0 ? 0 : 1, stats->stage(laplacian::Stage::REDUCE, level).calls);
+        EXPECT_EQ(level == 0 ? 0 : pixels, stats->stage(laplacian::Stage::REDUCE, level).pixels);
+        EXPECT_EQ(level + 1 < pyramid.levels() ? pixels : 0,
+                  stats->stage(laplacian::Stage::LAPLACIAN_PLANE, level).pixels);
+        EXPECT_EQ(pixels, stats->stage(laplacian::Stage::QUANTIZE, level).pixels);
+    }
+    EXPECT_LT(0u, stats->stage(laplacian::Stage::REDUCE).bytesAllocated);
+    EXPECT_EQ(0u, stats->stage(laplacian::Stage::RECONSTRUCT).calls);
+
+    // A workspace holds the images already, so encoding into it does not allocate.
+    laplacian::PyramidWorkspace workspace{image.size(), 4};
+    stats->reset();
+    pyramid.encode(image, workspace);
+    EXPECT_EQ(3u, stats->stage(laplacian::Stage::REDUCE).calls);
+    EXPECT_EQ(0u, stats->stage(laplacian::Stage::REDUCE).bytesAllocated);
+    EXPECT_EQ(0u, stats->stage(laplacian::Stage::LAPLACIAN_PLANE).bytesAllocated);
+
+    stats->reset();
+    const cv::Mat decoded = pyramid.decode();
+    EXPECT_EQ(3u, stats->stage(laplacian::Stage::RECONSTRUCT).calls);
+    EXPECT_EQ(decoded.total(), stats->stage(laplacian::Stage::RECONSTRUCT, 0).pixels);
+    EXPECT_EQ(decoded.total() * decoded.elemSize(), stats->stage(laplacian::Stage::RECONSTRUCT, 0).bytesAllocated);
+    EXPECT_LE(stats->stage(laplacian::Stage::RECONSTRUCT).duration, stats->total());
+
+    pyramid.setProfiler(nullptr);
+    stats->reset();
+    static_cast<void>(pyramid.decode());
+    EXPECT_EQ(0, stats->levels());
+}
+
+TEST(LaplacianPyramid, should_match_reference_decode_if_kernel_is_not_default) {
+
+    cv::Mat image(cv::Size{125, 93}, CV_32F);
+    cv::randu(image, 0.0f, 255.0f);
+    const laplacian::LaplacianPyramid pyramid{image, 3};
+
+    std::stringstream stream;
+    pyramid.serialize(stream);
+
+    // 0.375 and 0.4 run with compile time weights, 0.3 with the runtime weights.
+    for (const float a : {0.375f, 0.4f, 0.3f}) {
+
+        // The kernel is stored as "a" behind the magic, the version and the levels.
+        std::string bytes = stream.str();
+        uint32_t bits;
+        std::memcpy(&bits, &a, sizeof(bits));
+        for (size_t i = 0; i < sizeof(bits); i++) {
+            bytes[6 + i] = static_cast<char>(bits >> (8 * i));
+        }
+        std::stringstream patched{bytes};
+        const auto decoded = laplacian::LaplacianPyramid::deserialize(patched).decode();
+
+        const cv::Mat kernel = laplacian::test::referenceKernel(a);
+        cv::Mat expected = pyramid.at(pyramid.levels() - 1);
+        for (int level = pyramid.levels() - 2; level >= 0; level--) {
+            const cv::Mat& plane = pyramid.at(level);
+            expected = plane + laplacian::test::referenceUpsample(expected, kernel, plane.rows, plane.cols);
+        }
+        EXPECT_LE(cv::norm(expected, decoded, cv::NORM_INF), laplacian::test::REFERENCE_TOLERANCE);
+    }
+}
+
+TEST(LaplacianPyramid, should_decode_to_image_size_if_image_is_padded) {
+
+    cv::Mat integerImage(cv::Size{509, 330}, CV_8U);
+    cv::randu(integerImage, 0.0, 256.0);
+    cv::Mat floatImage(cv::Size{100, 61}, CV_32FC3);
+    cv::randu(floatImage, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+
+    for (const cv::Mat& image : {integerImage, floatImage}) {
+
+        const laplacian::LaplacianPyramid cropped{image, 4};
+        const laplacian::LaplacianPyramid padded{image, 4, laplacian::Scaling::PAD};
+
+        EXPECT_GT(image.size().area(), cropped.imageSize().area());
+        EXPECT_EQ(image.size(), padded.imageSize());
+        EXPECT_LE(image.cols, padded.at(0).cols);
+        EXPECT_LE(image.rows, padded.at(0).rows);
+
+        const cv::Mat decoded = padded.decode();
+        ASSERT_EQ(image.size(), decoded.size());
+        ASSERT_EQ(image.type(), decoded.type());
+        EXPECT_LE(cv::norm(image, decoded, cv::NORM_INF), image.depth() == CV_8U ? 0.0 : 1e-3);
+        EXPECT_EQ(image.size(), padded.decode(0).size());
+
+        std::stringstream stream;
+        padded.serialize(stream);
+        const auto restored = laplacian::LaplacianPyramid::deserialize(stream);
+        EXPECT_EQ(image.size(), restored.imageSize());
+        EXPECT_EQ(0.0, cv::norm(decoded, restored.decode(), cv::NORM_INF));
+
+        const std::string path = "padded_pyramid.lpyt";
+        padded.save(path, 64);
+        const auto opened = laplacian::LaplacianPyramid::open(path);
+        EXPECT_EQ(image.size(), opened.imageSize());
+        EXPECT_EQ(0.0, cv::norm(decoded, opened.decode(), cv::NORM_INF));
+        std::remove(path.c_str());
+    }
+
+    // An image of a valid size is neither cropped nor padded.
+    const cv::Mat valid = integerImage(cv::Rect(0, 0, 509, 301));
+    const laplacian::LaplacianPyramid padded{valid, 4, laplacian::Scaling::PAD};
+    EXPECT_EQ(valid.size(), padded.at(0).size());
+    EXPECT_EQ(0.0, cv::norm(valid, padded.decode(), cv::NORM_INF));
+
+    // The workspace keeps the padded image, so encoding into it reuses the memory.
+    laplacian::PyramidWorkspace workspace{integerImage.size(), 4, CV_8U, laplacian::Scaling::PAD};
+    auto pyramid = laplacian::LaplacianPyramid{integerImage, workspace};
+    const auto* planeMemory = pyramid.at(0).data;
+    cv::Mat second(integerImage.size(), CV_8U);
+    cv::randu(second, 0.0, 256.0);
+    pyramid.encode(second, workspace);
+    EXPECT_EQ(planeMemory, pyramid.at(0).data);
+    EXPECT_EQ(0.0, cv::norm(second, pyramid.decode(workspace), cv::NORM_INF));
+}
+
+TEST(LaplacianPyramid, should_weight_levels_with_mask_gaussians_if_pyramids_are_blended) {
+
+    cv::Mat left(cv::Size{125, 93}, CV_32F);
+    cv::Mat right(cv::Size{125, 93}, CV_32F);
+    cv::randu(left, 0.0f, 255.0f);
+    cv::randu(right, 0.0f, 255.0f);
+    cv::Mat mask(left.size(), CV_32F, cv::Scalar::all(0.0));
+    mask(cv::Rect(0, 0, 60, 93)).setTo(1.0);
+
+    const laplacian::LaplacianPyramid first{left, 4};
+    const laplacian::LaplacianPyramid second{right, 4};
+    laplacian::PyramidBlender blender;
+    const auto blended = blender.blend(first, second, mask);
+
+    // The mask is reduced like an image, every level is weighted with the gaussian of the mask at that level.
+    const cv::Mat kernel = laplacian::test::referenceKernel();
+    cv::Mat gaussian = mask;
+    ASSERT_EQ(first.levels(), blended.levels());
+    for (uint8_t level = 0; level < blended.levels(); level++) {
+
+        const cv::Mat plane = blended.at(level);
+        if (level > 0) {
+            gaussian = laplacian::test::referenceReduce(gaussian, kernel, plane.rows, plane.cols);
+        }
+
+        cv::Mat expected(plane.size(), CV_32F);
+        for (int i = 0; i < plane.rows; i++) {
+            for (int j = 0; j < plane.cols; j++) {
+                const float weight = gaussian.at<float>(i, j);
+                expected.at<float>(i, j) = weight * first.at(level).at<float>(i, j) +
+                                           (1.0f - weight) * second.at(level).at<float>(i, j);
+            }
+        }
+        EXPECT_LE(cv::norm(expected, plane, cv::NORM_INF), laplacian::test::REFERENCE_TOLERANCE);
+    }
+
+    // Fusing with the mask and its complement is blending.
+    cv::Mat complement(mask.size(), CV_32F);
+    for (int i = 0; i < mask.rows; i++) {
+        for (int j = 0; j < mask.cols; j++) {
+            complement.at<float>(i, j) = 1.0f - mask.at<float>(i, j);
+        }
+    }
+    const auto fused = blender.fuse({first, second}, {mask, complement});
+    EXPECT_LE(cv::norm(blended.decode(), fused.decode(), cv::NORM_INF), laplacian::test::REFERENCE_TOLERANCE);
+
+    EXPECT_THROW(static_cast<void>(blender.blend(first, laplacian::LaplacianPyramid{right, 3}, mask)),
+                 laplacian::LaplacianPyramidException);
+    EXPECT_THROW(static_cast<void>(blender.blend(first, second, mask(cv::Rect(0, 0, 100, 93)))),
+                 laplacian::LaplacianPyramidException);
+    EXPECT_THROW(static_cast<void>(blender.fuse({first, second}, {mask})), laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_keep_images_if_weights_select_one_pyramid) {
+
+    cv::Mat under(cv::Size{509, 330}, CV_8UC3);
+    cv::Mat over(cv::Size{509, 330}, CV_8UC3);
+    cv::randu(under, cv::Scalar::all(0.0), cv::Scalar::all(128.0));
+    cv::randu(over, cv::Scalar::all(128.0), cv::Scalar::all(256.0));
+    const cv::Mat ones(under.size(), CV_32F, cv::Scalar::all(1.0));
+    const cv::Mat zeros(under.size(), CV_32F, cv::Scalar::all(0.0));
+
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+    const std::vector<laplacian::LaplacianPyramid> pyramids = {
+            laplacian::LaplacianPyramid{under, 4, laplacian::Scaling::PAD},
+            laplacian::LaplacianPyramid{over, 4, laplacian::Scaling::PAD}};
+    laplacian::PyramidBlender blender{executor};
+
+    // Integer planes are rounded after weighting, so selecting one pyramid keeps its image losslessly.
+    auto result = blender.blend(pyramids.at(0), pyramids.at(1), ones);
+    EXPECT_EQ(under.size(), result.imageSize());
+    EXPECT_EQ(0.0, cv::norm(under, result.decode(), cv::NORM_INF));
+
+    // Blending into the same result again reuses its planes.
+    const auto* planeMemory = result.at(0).data;
+    blender.blend(pyramids.at(0), pyramids.at(1), zeros, result);
+    EXPECT_EQ(planeMemory, result.at(0).data);
+    EXPECT_EQ(0.0, cv::norm(over, result.decode(), cv::NORM_INF));
+
+    // Pixels without any weight take the mean of the pyramids, which is the same for equal pyramids.
+    const auto fused = blender.fuse({pyramids.at(1), pyramids.at(1)}, {zeros, zeros});
+    EXPECT_EQ(0.0, cv::norm(over, fused.decode(), cv::NORM_INF));
+    blender.fuse({pyramids.at(0), pyramids.at(1)}, {ones, zeros}, result);
+    EXPECT_EQ(0.0, cv::norm(under, result.decode(), cv::NORM_INF));
 }
 
-template<class R>
-R laplacian::test::measured(const std::function<R ()>& function, const std::string& step) {
+TEST(LaplacianPyramid, should_stay_close_to_full_precision_if_planes_are_half_precision) {
+
+    // Gradients with mild noise, like photographs. The planes of pure noise are so large that the expansion with
+    // the default kernel amplifies their rounding to several gray values.
+    cv::Mat image(cv::Size{509, 317}, CV_32FC3);
+    cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(16.0));
+    for (int i = 0; i < image.rows; i++) {
+        for (int j = 0; j < image.cols * 3; j++) {
+            image.ptr<float>(i)[j] += static_cast<float>(i / 3 + j / 12 + (j % 3) * 20);
+        }
+    }
+
+    const laplacian::LaplacianPyramid full{image, 5};
+    laplacian::LaplacianPyramid half = full;
+    half.setPrecision(laplacian::Precision::HALF);
+
+    size_t fullBytes = 0;
+    size_t halfBytes = 0;
+    for (uint8_t level = 0; level < half.levels(); level++) {
+        EXPECT_EQ(level + 1 < half.levels() ? CV_16FC3 : CV_32FC3, half.at(level).type());
+        fullBytes += full.at(level).total() * full.at(level).elemSize();
+        halfBytes += half.at(level).total() * half.at(level).elemSize();
+    }
+    EXPECT_LT(halfBytes, fullBytes * 0.51);
+
+    // The error of a plane is at most 2^-11 of its values. The expansion with the default kernel amplifies it at the
+    // few pixels with large details, so the mean error stays far below the maximum.
+    const cv::Mat expected = full.decode();
+    const cv::Mat decoded = half.decode();
+    ASSERT_EQ(expected.type(), decoded.type());
+    const double maxError = cv::norm(expected, decoded, cv::NORM_INF);
+    const double meanError = cv::norm(expected, decoded, cv::NORM_L1) / static_cast<double>(expected.total() * 3);
+    RecordProperty("maxError", std::to_string(maxError));
+    RecordProperty("meanError", std::to_string(meanError));
+    EXPECT_LE(maxError, 2.0);
+    EXPECT_LE(meanError, 0.01);
+
+    const cv::Rect region(100, 50, 64, 48);
+    EXPECT_EQ(0.0, cv::norm(decoded(region), half.decode(region), cv::NORM_INF));
+
+    // A workspace keeps encoding into the half precision planes.
+    laplacian::PyramidWorkspace workspace{image.size(), 5, CV_32FC3};
+    laplacian::LaplacianPyramid encoded{image, workspace};
+    encoded.setPrecision(laplacian::Precision::HALF);
+    const auto* planeMemory = encoded.at(0).data;
+    encoded.encode(image, workspace);
+    EXPECT_EQ(planeMemory, encoded.at(0).data);
+    EXPECT_EQ(0.0, cv::norm(decoded, encoded.decode(workspace), cv::NORM_INF));
+
+    // The stream holds full precision planes.
+    std::stringstream stream;
+    half.serialize(stream);
+    const auto restored = laplacian::LaplacianPyramid::deserialize(stream);
+    EXPECT_EQ(laplacian::Precision::FULL, restored.precision());
+    EXPECT_EQ(0.0, cv::norm(decoded, restored.decode(), cv::NORM_INF));
+
+    half.setPrecision(laplacian::Precision::FULL);
+    EXPECT_EQ(CV_32FC3, half.at(0).type());
+}
+
+TEST(LaplacianPyramid, should_match_dense_decode_if_quantized_planes_are_sparse) {
+
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+
+    for (const int type : {CV_8UC1, CV_32FC3}) {
+
+        // A flat image with a textured patch, so the quantized planes are zero apart from the patch and the border.
+        cv::Mat image(cv::Size{509, 317}, type, cv::Scalar::all(100.0));
+        cv::Mat patch = image(cv::Rect(200, 90, 70, 50));
+        cv::randu(patch, cv::Scalar::all(0.0), cv::Scalar::all(200.0));
+
+        const laplacian::LaplacianPyramid sparse{image, 5, 4.0f, executor};
+
+        // Taking a level by reference makes it dense.
+        laplacian::LaplacianPyramid dense = sparse;
+        for (uint8_t level = 0; level < dense.levels(); level++) {
+            EXPECT_EQ(0.0, cv::norm(sparse.at(level), dense[level], cv::NORM_INF));
+        }
+
+        const cv::Mat expected = dense.decode();
+        EXPECT_EQ(0.0, cv::norm(expected, sparse.decode(), cv::NORM_INF));
+
+        const cv::Rect region(190, 80, 64, 48);
+        EXPECT_EQ(0.0, cv::norm(expected(region), sparse.decode(region), cv::NORM_INF));
+        const cv::Rect window(90, 40, 32, 24);
+        EXPECT_EQ(0.0, cv::norm(dense.at(1, window), sparse.at(1, window), cv::NORM_INF));
+
+        laplacian::PyramidWorkspace workspace{image.size(), 5, type};
+        EXPECT_EQ(0.0, cv::norm(expected, sparse.decode(workspace), cv::NORM_INF));
+
+        std::stringstream stream;
+        sparse.serialize(stream);
+        const auto restored = laplacian::LaplacianPyramid::deserialize(stream);
+        EXPECT_EQ(0.0, cv::norm(expected, restored.decode(), cv::NORM_INF));
+
+        laplacian::LaplacianPyramid half = sparse;
+        half.setPrecision(laplacian::Precision::HALF);
+        EXPECT_LE(cv::norm(expected, half.decode(), cv::NORM_INF), 2.0);
+    }
+}
+
+TEST(LaplacianPyramid, should_match_synchronous_results_if_frames_are_submitted_to_service) {
+
+    std::vector<cv::Mat> frames(12);
+    for (cv::Mat& frame : frames) {
+        frame.create(cv::Size{257, 161}, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+    }
+
+    // A queue of one request makes every submission wait for a worker.
+    std::vector<std::future<cv::Mat>> decoded;
+    {
+        laplacian::PyramidService service{2, 1};
+        std::vector<std::future<laplacian::LaplacianPyramid>> encoded;
+        for (const cv::Mat& frame : frames) {
+            encoded.push_back(service.submitEncode(frame, 4, 2.0f));
+        }
+
+        for (size_t index = 0; index < frames.size(); index++) {
+
+            const laplacian::LaplacianPyramid pyramid = encoded.at(index).get();
+            const laplacian::LaplacianPyramid expected{frames.at(index), 4, 2.0f};
+            ASSERT_EQ(expected.levels(), pyramid.levels());
+            for (uint8_t level = 0; level < pyramid.levels(); level++) {
+                EXPECT_EQ(0.0, cv::norm(expected.at(level), pyramid.at(level), cv::NORM_INF));
+            }
+            decoded.push_back(service.submitDecode(pyramid));
+        }
+
+        auto failed = service.submitEncode(cv::Mat(cv::Size{64, 64}, CV_64F), 2);
+        EXPECT_THROW(failed.get(), laplacian::LaplacianPyramidException);
+    }
+
+    // The service finishes the queued requests before it stops.
+    for (size_t index = 0; index < frames.size(); index++) {
+        EXPECT_EQ(0.0, cv::norm(laplacian::LaplacianPyramid{frames.at(index), 4, 2.0f}.decode(),
+                                decoded.at(index).get(), cv::NORM_INF));
+    }
+
+    EXPECT_THROW(laplacian::PyramidService(0), laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_compute_only_needed_levels_if_pyramid_is_lazy) {
+
+    cv::Mat image(cv::Size{509, 317}, CV_8UC3);
+    cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+    const laplacian::LaplacianPyramid eager{image, 5, laplacian::Scaling::PAD, 2.0f};
+
+    auto stats = std::make_shared<laplacian::PyramidStats>();
+    const laplacian::LaplacianPyramid lazy = laplacian::LaplacianPyramid::lazy(image, 5, laplacian::Scaling::PAD,
+                                                                                2.0f);
+    laplacian::LaplacianPyramid copy = lazy;
+    copy.setProfiler(stats);
+    ASSERT_EQ(eager.levels(), lazy.levels());
+    EXPECT_EQ(eager.imageSize(), lazy.imageSize());
 
-    auto start = std::chrono::high_resolution_clock::now();
-    auto result = function();
-    auto stop = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stop - start);
+    // Level 1 needs the gaussians up to level 2 and no other laplacian plane.
+    EXPECT_EQ(0.0, cv::norm(eager.at(1), copy.at(1), cv::NORM_INF));
+    EXPECT_EQ(2u, stats->stage(laplacian::Stage::REDUCE).calls);
+    EXPECT_EQ(1u, stats->stage(laplacian::Stage::LAPLACIAN_PLANE, 1).calls);
+    EXPECT_EQ(1u, stats->stage(laplacian::Stage::LAPLACIAN_PLANE).calls);
 
-    std::cout << (step.empty() ? "Measured step" : step) << " took " << std::to_string(duration.count()) << " ms" << std::endl;
+    // The copies share the computed levels, the top level only reduces the missing gaussians.
+    stats->reset();
+    EXPECT_EQ(0.0, cv::norm(eager.at(1), lazy.at(1), cv::NORM_INF));
+    EXPECT_EQ(0.0, cv::norm(eager.at(4), copy.at(4), cv::NORM_INF));
+    EXPECT_EQ(2u, stats->stage(laplacian::Stage::REDUCE).calls);
+    EXPECT_EQ(0u, stats->stage(laplacian::Stage::LAPLACIAN_PLANE).calls);
 
-    return result;
-}
\ No newline at end of file
+    // Threads accessing the levels at once get the levels of the eager pyramid.
+    const laplacian::LaplacianPyramid shared = laplacian::LaplacianPyramid::lazy(image, 5, laplacian::Scaling::PAD,
+                                                                                  2.0f);
+    std::vector<std::thread> threads;
+    std::vector<double> errors(8);
+    for (size_t index = 0; index < errors.size(); index++) {
+        threads.emplace_back([&, index]() {
+            const auto level = static_cast<uint8_t>(index % shared.levels());
+            errors.at(index) = cv::norm(eager.at(level), shared.at(level), cv::NORM_INF);
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (const double error : errors) {
+        EXPECT_EQ(0.0, error);
+    }
+
+    EXPECT_EQ(0.0, cv::norm(eager.decode(), lazy.decode(), cv::NORM_INF));
+    const cv::Rect region(100, 50, 64, 48);
+    EXPECT_EQ(0.0, cv::norm(eager.at(0, region), laplacian::LaplacianPyramid::lazy(image, 5, laplacian::Scaling::PAD,
+                                                                                  2.0f).at(0, region), cv::NORM_INF));
+}
+
+TEST(LaplacianPyramid, should_meet_budget_and_quality_if_steps_are_rate_controlled) {
+
+    // A smooth image with a noisy patch, so the levels need different steps.
+    cv::Mat integerImage(cv::Size{509, 317}, CV_8UC3);
+    for (int i = 0; i < integerImage.rows; i++) {
+        for (int j = 0; j < integerImage.cols * 3; j++) {
+            integerImage.ptr<uint8_t>(i)[j] = cv::saturate_cast<uint8_t>(128.0 + 80.0 * std::sin(j / 41.0) *
+                                                                                   std::cos(i / 29.0));
+        }
+    }
+    cv::Mat patch = integerImage(cv::Rect(300, 100, 90, 60));
+    cv::randu(patch, cv::Scalar::all(0.0), cv::Scalar::all(256.0));
+    cv::Mat floatImage;
+    integerImage.convertTo(floatImage, CV_32FC3);
+
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+    const auto psnr = [](const cv::Mat& image, const cv::Mat& reference) {
+        const double error = cv::norm(image, reference, cv::NORM_L2SQR) / (reference.total() * reference.channels());
+        return 10.0 * std::log10(255.0 * 255.0 / error);
+    };
+
+    for (const cv::Mat& image : {integerImage, floatImage}) {
+
+        const laplacian::LaplacianPyramid pyramid{image, 5, 0.0f, executor};
+        const laplacian::RateController controller{pyramid};
+
+        const size_t budget = image.total();
+        const laplacian::LaplacianPyramid fitted = controller.fitSize(budget);
+        std::stringstream stream;
+        fitted.serialize(stream);
+        EXPECT_LE(stream.str().size(), budget);
+        EXPECT_GE(stream.str().size(), budget * 3 / 4);
+
+        // The steps of the levels are written with the planes.
+        const auto restored = laplacian::LaplacianPyramid::deserialize(stream);
+        EXPECT_EQ(fitted.quantizationSteps(), restored.quantizationSteps());
+        EXPECT_EQ(0.0, cv::norm(fitted.decode(), restored.decode(), cv::NORM_INF));
+
+        const std::string path = "controlled_pyramid.lpyt";
+        fitted.save(path, 64);
+        const auto opened = laplacian::LaplacianPyramid::open(path);
+        EXPECT_EQ(fitted.quantizationSteps(), opened.quantizationSteps());
+        EXPECT_EQ(0.0, cv::norm(fitted.decode(), opened.decode(), cv::NORM_INF));
+        std::remove(path.c_str());
+
+        const cv::Mat reference = pyramid.decode();
+        const laplacian::LaplacianPyramid coarse = controller.fitPsnr(32.0);
+        const laplacian::LaplacianPyramid fine = controller.fitPsnr(42.0);
+        EXPECT_GE(psnr(coarse.decode(), reference), 32.0);
+        EXPECT_GE(psnr(fine.decode(), reference), 42.0);
+
+        std::stringstream coarseStream;
+        coarse.serialize(coarseStream);
+        std::stringstream fineStream;
+        fine.serialize(fineStream);
+        EXPECT_LT(coarseStream.str().size(), fineStream.str().size());
+
+        // Steps given by hand are applied like the steps of a quantization.
+        const laplacian::LaplacianPyramid uniform{image, 5, 2.0f};
+        EXPECT_EQ(0.0, cv::norm(uniform.decode(), controller.quantize(uniform.quantizationSteps()).decode(),
+                                cv::NORM_INF));
+    }
+
+    EXPECT_THROW(laplacian::RateController{laplacian::LaplacianPyramid(integerImage, 5, 2.0f)},
+                 laplacian::LaplacianPyramidException);
+}
+
+TEST(LaplacianPyramid, should_match_level_by_level_reduction_if_levels_are_reduced_in_tiles) {
+
+    // Wide rows make tiles of few rows, so the halos between the tiles are crossed at every level.
+    const auto executor = std::make_shared<laplacian::ThreadPool>(4);
+    for (const auto& [size, type] : {std::pair{cv::Size{2053, 611}, CV_32FC3},
+                                     std::pair{cv::Size{4099, 203}, CV_32FC4},
+                                     std::pair{cv::Size{777, 1029}, CV_32F}}) {
+
+        cv::Mat image(size, type);
+        cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+
+        const auto cascaded = laplacian::LaplacianPyramid{image, 6, 0.0f};
+        const auto levelByLevel = laplacian::LaplacianPyramid{image, 6, 0.0f, executor};
+
+        ASSERT_EQ(cascaded.levels(), levelByLevel.levels());
+        for (uint8_t level = 0; level < cascaded.levels(); level++) {
+            EXPECT_EQ(0.0, cv::norm(cascaded.at(level), levelByLevel.at(level), cv::NORM_INF));
+        }
+    }
+}
+
+TEST(LaplacianPyramid, should_match_scalar_result_if_cpu_level_is_forced) {
+
+    const laplacian::CpuLevel selected = laplacian::cpuLevel();
+    const laplacian::CpuLevel supported = laplacian::supportedCpuLevel();
+    EXPECT_LE(selected, supported);
+
+    // Odd sizes leave tails behind the vectorized loops at every level.
+    std::vector<cv::Mat> images;
+    for (const int type : {CV_32F, CV_32FC3, CV_32FC4}) {
+        cv::Mat image(cv::Size{509, 317}, type);
+        cv::randu(image, cv::Scalar::all(0.0), cv::Scalar::all(255.0));
+        images.push_back(image);
+    }
+
+    const auto encode = [&images]() {
+
+        std::vector<cv::Mat> results;
+        for (const auto& image : images) {
+
+            const laplacian::LaplacianPyramid full{image, 5};
+            const laplacian::LaplacianPyramid quantized{image, 5, 1.5f};
+            laplacian::LaplacianPyramid half = full;
+            half.setPrecision(laplacian::Precision::HALF);
+
+            for (uint8_t level = 0; level < full.levels(); level++) {
+                results.push_back(full.at(level));
+                results.push_back(quantized.at(level));
+            }
+            results.push_back(full.decode());
+            results.push_back(quantized.decode());
+            results.push_back(half.decode());
+        }
+        return results;
+    };
+
+    laplacian::setCpuLevel(laplacian::CpuLevel::SCALAR);
+    EXPECT_EQ(laplacian::CpuLevel::SCALAR, laplacian::cpuLevel());
+    const auto expected = encode();
+
+    for (auto level = laplacian::CpuLevel::BASELINE; level <= supported;
+         level = static_cast<laplacian::CpuLevel>(static_cast<int>(level) + 1)) {
+
+        laplacian::setCpuLevel(level);
+        const auto results = encode();
+
+        ASSERT_EQ(expected.size(), results.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            EXPECT_EQ(0.0, cv::norm(expected[i], results[i], cv::NORM_INF)) << "level " << static_cast<int>(level);
+        }
+    }
+
+    if (supported != laplacian::CpuLevel::AVX512) {
+        EXPECT_THROW(laplacian::setCpuLevel(laplacian::CpuLevel::AVX512), laplacian::LaplacianPyramidException);
+    }
+
+    laplacian::setCpuLevel(selected);
+    EXPECT_EQ(selected, laplacian::cpuLevel());
+}
+
+TEST(LaplacianPyramid, should_decode_losslessly_if_integer_image_is_worst_case) {
+
+    // The laplacian plane of the level above the top plane is the largest plane of the deepest supported
+    // compression. At level 7 the kernel of a pixel reaches 766 pixels into the image and its expansion needs the
+    // pixels of level 8 around it, so the pixel is placed in the middle of an image of 6 pixels at level 8.
+    const uint8_t level = laplacian::MAX_8U_COMPRESSIONS - 2;
+    const cv::Point pixel{8, 8};
+    const cv::Mat image = laplacian::test::worstCaseImage(cv::Size{2557, 2557}, level, pixel);
+
+    const laplacian::LaplacianPyramid pyramid{image, laplacian::MAX_8U_COMPRESSIONS};
+    ASSERT_EQ(image.size(), pyramid.levelSize(0));
+    EXPECT_GT(pyramid.at(level).at<short>(pixel), 30000);
+    EXPECT_EQ(0.0, cv::norm(image, pyramid.decode(), cv::NORM_INF));
+
+    // One more compression is refused for CV_8U images of a size which allows it, but not for CV_16U images.
+    const cv::Size deeper{3069, 3069};
+    EXPECT_THROW(laplacian::LaplacianPyramid(cv::Mat(deeper, CV_8U, cv::Scalar::all(0.0)),
+                                             laplacian::MAX_8U_COMPRESSIONS + 1),
+                 laplacian::LaplacianPyramidException);
+    EXPECT_THROW(laplacian::PyramidWorkspace(deeper, laplacian::MAX_8U_COMPRESSIONS + 1, CV_8U),
+                 laplacian::LaplacianPyramidException);
+    EXPECT_NO_THROW(laplacian::LaplacianPyramid(cv::Mat(deeper, CV_16U, cv::Scalar::all(0.0)),
+                                                laplacian::MAX_8U_COMPRESSIONS + 1));
+}
+
+std::vector<cv::Mat> laplacian::test::referencePlanes(const cv::Mat& image, uint8_t compressions) {
+
+    const auto isValid = [compressions](int dimension) {
+        return (dimension + 3) % (1 << compressions) == 0;
+    };
+
+    cv::Mat scaled = image;
+    while (!isValid(scaled.cols) || !isValid(scaled.rows)) {
+        scaled = scaled(cv::Rect{0, 0, scaled.cols - (isValid(scaled.cols) ? 0 : 1),
+                                 scaled.rows - (isValid(scaled.rows) ? 0 : 1)});
+    }
+
+    const cv::Mat kernel = laplacian::test::referenceKernel();
+
+    std::vector<cv::Mat> gaussians{scaled};
+    const double Mc = (static_cast<float>(scaled.cols) - 1.0f) / std::pow(2.0f, compressions);
+    const double Mr = (static_cast<float>(scaled.rows) - 1.0f) / std::pow(2.0f, compressions);
+    for (uint8_t level = 1; level < compressions; level++) {
+        gaussians.push_back(referenceReduce(gaussians.back(), kernel,
+                                            static_cast<int>(Mr * std::pow(2, compressions - level) - 3),
+                                            static_cast<int>(Mc * std::pow(2, compressions - level) - 3)));
+    }
+
+    std::vector<cv::Mat> planes;
+    for (uint8_t level = 0; level + 1 < gaussians.size(); level++) {
+        const auto& gaussian = gaussians.at(level);
+        planes.emplace_back(gaussian - referenceUpsample(gaussians.at(level + 1), kernel, gaussian.rows, gaussian.cols));
+    }
+    planes.push_back(gaussians.back());
+
+    return planes;
+}
+
+cv::Mat laplacian::test::referenceKernel(float a) {
+
+    cv::Mat w(5, 1, CV_32F);
+    w.at<float>(0) = w.at<float>(4) = 0.25f - a / 2.0f;
+    w.at<float>(1) = w.at<float>(3) = 0.25f;
+    w.at<float>(2) = a;
+
+    return w * w.t();
+}
+
+cv::Mat laplacian::test::referenceReduce(const cv::Mat& image, const cv::Mat& kernel, int rows, int cols) {
+
+    cv::Mat reduced(rows, cols, CV_32F);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float value = 0.0f;
+            for (int m = -2; m <= 2; m++) {
+                for (int n = -2; n <= 2; n++) {
+                    const int row = 2 * i - m;
+                    const int col = 2 * j - n;
+                    if (row >= 0 && col >= 0) {
+                        value += kernel.at<float>(m + 2, n + 2) *
+                                 image.at<float>(std::min(row, image.rows - 1), std::min(col, image.cols - 1));
+                    }
+                }
+            }
+            reduced.at<float>(i, j) = value;
+        }
+    }
+    return reduced;
+}
+
+cv::Mat laplacian::test::referenceUpsample(const cv::Mat& image, const cv::Mat& kernel, int rows, int cols) {
+
+    cv::Mat upsampled(rows, cols, CV_32F);
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            float value = 0.0f;
+            for (int m = -2; m <= 2; m++) {
+                for (int n = -2; n <= 2; n++) {
+                    const int row = i - m;
+                    const int col = j - n;
+                    if (row >= 0 && col >= 0 && row % 2 == 0 && col % 2 == 0) {
+                        value += kernel.at<float>(m + 2, n + 2) *
+                                 image.at<float>(std::min(row / 2, image.rows - 1), std::min(col / 2, image.cols - 1));
+                    }
+                }
+            }
+            upsampled.at<float>(i, j) = 4 * value;
+        }
+    }
+    return upsampled;
+}
+
+cv::Mat laplacian::test::worstCaseImage(cv::Size size, uint8_t level, cv::Point pixel) {
+
+    const double a = laplacian::DEFAULT_A;
+    const double w[] = {0.25 - a / 2.0, 0.25, a, 0.25, 0.25 - a / 2.0};
+
+    // One dimensional kernels over the image, centered at the radius. Every reduction spreads the kernel with the
+    // taps of "w" at the spacing of its level, the expansion of an even pixel with the even taps doubled.
+    const int radius = 8 << level;
+    const auto spread = [&w](const std::vector<double>& kernel, int spacing, bool expands) {
+
+        std::vector<double> spread(kernel.size(), 0.0);
+        for (int x = 0; x < static_cast<int>(kernel.size()); x++) {
+            for (int m = -2; m <= 2; m++) {
+                const int target = x + m * spacing;
+                if (kernel[x] != 0.0 && (!expands || m % 2 == 0) && target >= 0 &&
+                    target < static_cast<int>(kernel.size())) {
+                    spread[target] += (expands ? 2.0 : 1.0) * w[m + 2] * kernel[x];
+                }
+            }
+        }
+        return spread;
+    };
+
+    std::vector<double> gaussian(2 * radius + 1, 0.0);
+    gaussian[radius] = 1.0;
+    for (uint8_t reduction = 0; reduction < level; reduction++) {
+        gaussian = spread(gaussian, 1 << reduction, false);
+    }
+    const std::vector<double> expanded = spread(spread(gaussian, 1 << level, false), 1 << level, true);
+
+    cv::Mat image(size, CV_8U, cv::Scalar::all(0.0));
+    const cv::Point center = pixel * (1 << level);
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            if (gaussian[y + radius] * gaussian[x + radius] - expanded[y + radius] * expanded[x + radius] > 0.0) {
+                image.at<uchar>(center.y + y, center.x + x) = 255;
+            }
+        }
+    }
+    return image;
+}